@@ -0,0 +1,184 @@
+#include "evloop.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include "common.hh"
+#include "thread.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Main loop scheduler
+// The main thread sleeps on a timerfd armed for the earliest task deadline
+// and an eventfd raised by evloop_notify(). It only takes lvgl_mutex when a
+// task is due or lv_timer_handler asked to run again.
+#define EV_LATE_MS		20		//a task run later than this missed its deadline
+#define EV_LV_MAX_SLEEP	1000	//lv_timer_handler returns LV_NO_TIMER_READY when idle
+#define EV_REPORT_MS	1000	//at most one miss report per task per second
+
+typedef struct {
+	const char *name;
+	ev_task_fn_t fn;
+	uint32_t period;	//0: notify only
+	uint64_t next;
+	uint32_t missed;
+	uint32_t worst;
+	uint64_t reported;
+} ev_task_t;
+
+static ev_task_t tasks[EV_TASK_NUM];
+static atomic_uint pending;
+static int tfd = -1;
+static int efd = -1;
+
+static uint64_t ev_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void ev_arm(uint64_t ms)
+{
+	struct itimerspec it;
+
+	memset(&it, 0, sizeof(it));
+	it.it_value.tv_sec = ms / 1000;
+	it.it_value.tv_nsec = (ms % 1000) * 1000000;
+	timerfd_settime(tfd, TFD_TIMER_ABSTIME, &it, NULL);
+}
+
+static void ev_check_late(ev_task_t *t, uint64_t now)
+{
+	uint32_t late = now - t->next;
+
+	if(late <= EV_LATE_MS)
+		return;
+
+	t->missed++;
+	if(late > t->worst)
+		t->worst = late;
+
+	if(now - t->reported >= EV_REPORT_MS) {
+		Printf("evloop: %s missed %d deadline(s), worst %dms late\n",
+				t->name, (int)t->missed, (int)t->worst);
+		t->missed = 0;
+		t->worst = 0;
+		t->reported = now;
+	}
+}
+
+int evloop_init(void)
+{
+	tasks[EV_TASK_LVGL].name = "lvgl";
+
+	tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if(tfd < 0 || efd < 0) {
+		perror("evloop_init");
+		return -1;
+	}
+	return 0;
+}
+
+void evloop_register(ev_task_id_t id, const char *name, ev_task_fn_t fn, uint32_t period_ms)
+{
+	ev_task_t *t = &tasks[id];
+
+	t->name = name;
+	t->fn = fn;
+	t->period = period_ms;
+	t->next = ev_now() + period_ms;
+}
+
+// Safe from any thread, with or without lvgl_mutex held
+void evloop_notify(ev_task_id_t id)
+{
+	uint64_t one = 1;
+
+	if(atomic_fetch_or(&pending, 1u << id) == 0 && efd >= 0)
+		write(efd, &one, sizeof(one));
+}
+
+void evloop_run(void)
+{
+	struct pollfd fds[2];
+	ev_task_t *lv = &tasks[EV_TASK_LVGL];
+	uint64_t now, wake, cnt;
+	uint32_t due, sleep_ms;
+
+	fds[0].fd = tfd;
+	fds[0].events = POLLIN;
+	fds[1].fd = efd;
+	fds[1].events = POLLIN;
+	lv->next = ev_now();
+
+	for(;;)
+	{
+		//drain the eventfd before taking the pending set, so a notify that
+		//lands in between still leaves the eventfd raised
+		read(efd, &cnt, sizeof(cnt));
+		due = atomic_exchange(&pending, 0);
+		now = ev_now();
+
+		for(int i=0; i<EV_TASK_NUM; i++)
+		{
+			ev_task_t *t = &tasks[i];
+
+			if(i == EV_TASK_LVGL) {
+				if(now >= t->next) {
+					ev_check_late(t, now);
+					due |= 1u << i;
+				}
+				continue;
+			}
+			if(!t->fn || !t->period || now < t->next)
+				continue;
+
+			ev_check_late(t, now);
+			due |= 1u << i;
+			t->next += t->period;
+			if(t->next <= now)
+				t->next = now + t->period;
+		}
+
+		if(due) {
+			thread_loop_begin();
+			pthread_mutex_lock(&lvgl_mutex);
+			for(int i=0; i<EV_TASK_NUM; i++)
+			{
+				if((due & (1u << i)) && tasks[i].fn)
+					tasks[i].fn();
+			}
+			sleep_ms = lv_timer_handler();
+			pthread_mutex_unlock(&lvgl_mutex);
+			thread_loop_end();
+
+			if(sleep_ms > EV_LV_MAX_SLEEP)
+				sleep_ms = EV_LV_MAX_SLEEP;
+			lv->next = ev_now() + sleep_ms;
+		}
+
+		wake = lv->next;
+		for(int i=0; i<EV_TASK_NUM; i++)
+		{
+			if(tasks[i].fn && tasks[i].period && tasks[i].next < wake)
+				wake = tasks[i].next;
+		}
+		ev_arm(wake);
+
+		if(poll(fds, 2, -1) < 0) {
+			if(errno != EINTR)
+				perror("evloop poll");
+			continue;
+		}
+		if(fds[0].revents & POLLIN)
+			read(tfd, &cnt, sizeof(cnt));
+	}
+}
@@ -0,0 +1,24 @@
+#ifndef _EVLOOP_H
+#define _EVLOOP_H
+
+#include <stdint.h>
+
+// Main loop tasks. Each one runs under lvgl_mutex on the main thread, either
+// every period_ms or right after evloop_notify() from any thread.
+typedef enum {
+	EV_TASK_LVGL,		//no handler, only wakes lv_timer_handler
+	EV_TASK_STATUSBAR,
+	EV_TASK_OSD_HDZERO,
+	EV_TASK_IMS,
+	EV_TASK_SOURCE,
+	EV_TASK_NUM
+} ev_task_id_t;
+
+typedef void (*ev_task_fn_t)(void);
+
+int  evloop_init(void);
+void evloop_register(ev_task_id_t id, const char *name, ev_task_fn_t fn, uint32_t period_ms);
+void evloop_notify(ev_task_id_t id);
+void evloop_run(void);
+
+#endif
@@ -0,0 +1,135 @@
+#include "icons.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.hh"
+#include "../page/page_common.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Icon registry
+// Every OSD status icon is decoded into an lv_img_dsc_t at startup, so the
+// update loop only swaps pointers. An icon that fails to decode falls back
+// to its file path and LVGL reads it from flash as before.
+typedef struct {
+	lv_img_dsc_t dsc;
+	bool loaded;
+	char path[64];
+} icon_t;
+
+static const struct {
+	icon_id_t first;
+	uint8_t count;		//0: fmt is a plain file name
+	const char *fmt;
+} icon_files[] = {
+	{ICON_FAN1,      6, "fan%d.bmp"},
+	{ICON_VTXTEMP1,  8, "VtxTemp%d.bmp"},
+	{ICON_ANT1,      6, "ant%d.bmp"},
+	{ICON_VLQ1,      9, "VLQ%d.bmp"},
+	{ICON_BLANK,     0, blank_bmp},
+	{ICON_LLOCK,     0, LLOCK_bmp},
+	{ICON_RECORDING, 0, recording_bmp},
+	{ICON_NOSDCARD,  0, noSdcard_bmp},
+};
+
+static icon_t icons[ICON_NUM];
+
+static int icon_load(icon_t *icon)
+{
+	lv_img_decoder_dsc_t dsc;
+	uint32_t px_size, line;
+	uint8_t *data;
+
+	if(lv_img_decoder_open(&dsc, icon->path, lv_color_black(), 0) != LV_RES_OK)
+		return -1;
+
+	if(dsc.header.cf == LV_IMG_CF_TRUE_COLOR_ALPHA)
+		px_size = LV_IMG_PX_SIZE_ALPHA_BYTE;
+	else if(dsc.header.cf == LV_IMG_CF_TRUE_COLOR)
+		px_size = LV_COLOR_SIZE / 8;
+	else {
+		lv_img_decoder_close(&dsc);
+		return -2;
+	}
+
+	line = dsc.header.w * px_size;
+	data = (uint8_t *)malloc(line * dsc.header.h);
+	if(!data) {
+		lv_img_decoder_close(&dsc);
+		return -3;
+	}
+
+	if(dsc.img_data)
+		memcpy(data, dsc.img_data, line * dsc.header.h);
+	else {
+		for(lv_coord_t y=0; y<dsc.header.h; y++)
+		{
+			if(lv_img_decoder_read_line(&dsc, 0, y, dsc.header.w, data + y * line) != LV_RES_OK) {
+				free(data);
+				lv_img_decoder_close(&dsc);
+				return -4;
+			}
+		}
+	}
+
+	icon->dsc.header = dsc.header;
+	icon->dsc.data_size = line * dsc.header.h;
+	icon->dsc.data = data;
+	icon->loaded = true;
+	lv_img_decoder_close(&dsc);
+	return 0;
+}
+
+void icon_init(void)
+{
+	char name[32];
+	int i, n, ret;
+
+	for(i=0; i<sizeof(icon_files)/sizeof(icon_files[0]); i++)
+	{
+		if(!icon_files[i].count) {
+			sprintf(icons[icon_files[i].first].path, "%s%s", RESOURCE_PATH, icon_files[i].fmt);
+			continue;
+		}
+		for(n=0; n<icon_files[i].count; n++)
+		{
+			sprintf(name, icon_files[i].fmt, n + 1);
+			sprintf(icons[icon_files[i].first + n].path, "%s%s", RESOURCE_PATH, name);
+		}
+	}
+
+	for(i=0; i<ICON_NUM; i++)
+	{
+		ret = icon_load(&icons[i]);
+		if(ret)
+			Printf("icon %s not preloaded (%d)\n", icons[i].path, ret);
+	}
+}
+
+const void *icon_src(icon_id_t id)
+{
+	if(id >= ICON_NUM)
+		id = ICON_BLANK;
+	if(icons[id].loaded)
+		return &icons[id].dsc;
+	return icons[id].path;
+}
+
+// lv_img_set_src re-reads file sources and invalidates the object even when
+// the source is unchanged, so only call it when the image really changes.
+void img_set_src_changed(lv_obj_t *img, const void *src)
+{
+	const void *cur = lv_img_get_src(img);
+
+	if(cur == src)
+		return;
+	if(cur && lv_img_src_get_type(cur) == LV_IMG_SRC_FILE && lv_img_src_get_type(src) == LV_IMG_SRC_FILE &&
+	   strcmp(cur, src) == 0)
+		return;
+	lv_img_set_src(img, src);
+}
+
+void icon_set(lv_obj_t *img, icon_id_t id)
+{
+	img_set_src_changed(img, icon_src(id));
+}
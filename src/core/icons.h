@@ -0,0 +1,33 @@
+#ifndef _ICONS_H
+#define _ICONS_H
+
+#include "lvgl/lvgl.h"
+
+// OSD status icons, decoded from RESOURCE_PATH once by icon_init()
+typedef enum {
+	ICON_FAN1,
+	ICON_FAN6 = ICON_FAN1 + 5,
+	ICON_VTXTEMP1,
+	ICON_VTXTEMP8 = ICON_VTXTEMP1 + 7,
+	ICON_ANT1,
+	ICON_ANT6 = ICON_ANT1 + 5,
+	ICON_VLQ1,
+	ICON_VLQ9 = ICON_VLQ1 + 8,
+	ICON_BLANK,
+	ICON_LLOCK,
+	ICON_RECORDING,
+	ICON_NOSDCARD,
+	ICON_NUM
+} icon_id_t;
+
+#define ICON_FAN(n)     (ICON_FAN1 + (n) - 1)       //n = 1..6
+#define ICON_VTXTEMP(n) (ICON_VTXTEMP1 + (n) - 1)   //n = 1..8
+#define ICON_ANT(n)     (ICON_ANT1 + (n) - 1)       //n = 1..6
+#define ICON_VLQ(n)     (ICON_VLQ1 + (n) - 1)       //n = 1..9
+
+void icon_init(void);
+const void *icon_src(icon_id_t id);
+void icon_set(lv_obj_t *img, icon_id_t id);
+void img_set_src_changed(lv_obj_t *img, const void *src);
+
+#endif
@@ -6,6 +6,7 @@
 #include "../minIni/minIni.h"
 #include "hardware.h"
 #include "common.hh"
+#include "evloop.h"
 ///////////////////////////////////////////////////////////////////////////////
 // locals
 static lv_obj_t *canvas_ims;
@@ -168,6 +169,9 @@ void ims_init(void)
     Set_Brightness(defs[1]);
     Set_Saturation(defs[2]);
     Set_Contrast(defs[3]);
+
+    evloop_register(EV_TASK_IMS, "ims", ims_update, 0);
+    evloop_notify(EV_TASK_IMS);
 }
 
 void save_ims()
@@ -294,6 +298,7 @@ uint8_t ims_key(uint8_t key)
                     break;
         }
     }
+    evloop_notify(EV_TASK_IMS);
     return ret;
 }
 
@@ -4,7 +4,7 @@
 #include <stdlib.h>
 #include <sys/stat.h>
 #include <linux/input.h>
-#include <sys/epoll.h>
+#include <fcntl.h>
 #include <assert.h>
 #include <errno.h>
 #include "defines.h"
@@ -18,6 +18,10 @@
 #include "osd.h"
 #include "imagesetting.h"
 #include "common.hh"
+#include "evloop.h"
+#include "input_queue.h"
+#include "thread.h"
+#include "sdcard.h"
 #include "../page/page_scannow.h"
 #include "../page/page_common.h"
 #include "../page/page_fans.h"
@@ -147,7 +151,7 @@ static void switch_to_menumode()
 	g_bShowIMS = false;
 	main_menu_show(true);
 	HDZero_Close(); 
-	g_sdcard_det_req = 1;
+	sdcard_refresh();
 }
 
 static void btn_press(void) //long press left key
@@ -304,143 +308,69 @@ static void roller_down(void)
 	pthread_mutex_unlock(&lvgl_mutex);
 }
 
-static void get_event(int fd)
+// Right button, forwarded by the DM5680 that reads it
+static void rbtn_key(uint8_t key)
 {
-    struct input_event event;
-	static int roller_value = 0;
-	static int event_type_last = 0;
-	static int btn_value = 0;
-	static int btn_press_time = 0;
-
-    read(fd, &event, sizeof(event));
-
-    switch (event.type) {
-        case EV_SYN:
-            if (event.code == SYN_REPORT) {
-
-				if(event_type_last == EV_REL)
-				{
-					if(roller_value == 1)
-					{
-						roller_up();
-						g_key = DIAL_KEY_UP;
-					}else{
-						roller_down();
-						g_key = DIAL_KEY_DOWN;
-					}
-				}
-				else if(event_type_last == EV_KEY)
-				{
-					if(btn_value)
-					{
-						if(btn_press_time == 10)
-						{
-							btn_press();
-							g_key = DIAL_KEY_PRESS;
-						}
-						btn_press_time++;
-						//printf("btn down\n");
-					}else{
-						if(btn_press_time < 10){
-							btn_click();
-							g_key = DIAL_KEY_CLICK;
-						}
-						//else if(btn_press_time > 200){
-						//	btn_super_press();
-						//}
-						btn_press_time = 0;
-					}
-				}
-				else
-				{
-
-				}
-                //printf("------------ syn report ----------\n");
-            } else if (event.code == SYN_MT_REPORT) {
-                //printf("----------- syn mt report ------------\n");
-            }
-            break;
-        case EV_KEY:
-            //printf("key code%d is %s!\n", event.code, event.value?"down":"up");
-			btn_value = event.value;
-			event_type_last = EV_KEY;
-            break;
-        case EV_ABS:
-            if ((event.code == ABS_X) ||
-                 (event.code == ABS_MT_POSITION_X)) {
-                //printf("abs,x = %d\n", event.value);
-            } else if ((event.code == ABS_Y) ||
-                 (event.code == ABS_MT_POSITION_Y)) {
-                //printf("abs,y = %d\n", event.value);
-            } else if ((event.code == ABS_PRESSURE) ||
-                (event.code == ABS_MT_PRESSURE)) {
-                //printf("pressure value: %d\n", event.value);
-            }
-            break;
-        case EV_REL:
-            if (event.code == REL_X) {
-                //printf("x = %d\n", event.value);
-            } else if (event.code == REL_Y) {
-				roller_value = event.value;
-                //printf("y = %d\n", event.value);
-            }
-			event_type_last = EV_REL;
-            break;
-        default:
-            //printf("unknown [type=%d, code=%d value=%d]\n", event.type, event.code, event.value);
-            break;
-    }
+	g_key = key;
+	if((g_source_info.source != 1) && (g_menu_op == OPLEVEL_VIDEO)) //no record feature for HDMI in or non-Video mode
+		rbtn_click(key == RIGHT_KEY_CLICK, 0);
 }
 
-static void add_to_epfd(int epfd, int fd)
+// Runs the key handlers off the reactor: they take lvgl_mutex, retune the
+// receivers, start the recorder and fork helpers.
+void *thread_input(void *ptr)
 {
-    int ret;
-    struct epoll_event event = {
-        .events = EPOLLIN,
-        .data    = {
-            .fd = fd,
-        },
-    };
-
-    ret = epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &event);
-    assert(ret == 0);
+	int key;
+
+	for(;;)
+	{
+		key = input_queue_get(-1);
+		if(key < 0)
+			continue;
+
+		thread_loop_begin();
+		switch(key) {
+			case DIAL_KEY_UP:
+				roller_up();
+				break;
+			case DIAL_KEY_DOWN:
+				roller_down();
+				break;
+			case DIAL_KEY_CLICK:
+				btn_click();
+				break;
+			case DIAL_KEY_PRESS:
+				btn_press();
+				break;
+			case RIGHT_KEY_CLICK:
+			case RIGHT_KEY_PRESS:
+				rbtn_key(key);
+				break;
+		}
+		if(key < RIGHT_KEY_CLICK)
+			g_key = key;
+		evloop_notify(EV_TASK_LVGL);
+		thread_loop_end();
+	}
+	return NULL;
 }
 
 #define ID_LEN 64
 #define ID_CNT 4
-static int epfd;
-static struct epoll_event events[ID_CNT];
 int input_device_open(void)
 {
     char buf[ID_LEN];
     int fd;
     int i;
     int nFrom=0, nCount=ID_CNT;
-    epfd = epoll_create(ID_CNT);
-    assert(epfd > 0);
 
     for (i = nFrom; i < nFrom+nCount; i++) {
         snprintf(buf, ID_LEN, "/dev/input/event%d", i);
-        fd = open(buf, O_RDONLY);
+        fd = open(buf, O_RDONLY | O_NONBLOCK);
         if (fd >= 0) {
-            add_to_epfd(epfd, fd);
+            input_queue_add(fd);
             printf("opened %s\n", buf);
         }
     }
 	return 0;
 }
-
-void input_device_loop(void)
-{
-	int ret = epoll_wait(epfd, events, ID_CNT, -1);
-	if (ret < 0) {
-		perror("epoll_wait");
-		return;
-	}
-
-	for (int i = 0; i < ret; i++) {
-		if (events[i].events&EPOLLIN) {
-			get_event(events[i].data.fd);
-		}
-	}
-}
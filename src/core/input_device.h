@@ -2,7 +2,7 @@
 #define _INPUT_DEVICE_H
 
 int input_device_open(void);
-void input_device_loop(void);
 void tune_channel_timer();
+void *thread_input(void *ptr);
 
 #endif
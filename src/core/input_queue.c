@@ -0,0 +1,119 @@
+#include "input_queue.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <linux/input.h>
+#include "common.hh"
+#include "reactor.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Input key queue
+// Only the decoding runs on the reactor. Each key is one byte in a pipe,
+// written without blocking, so a busy input thread costs dropped keys
+// rather than a stalled UART.
+#define INPUT_LONG_PRESS	10		//SYN reports with the dial held down
+
+static int key_pipe[2] = {-1, -1};
+
+int input_queue_init(void)
+{
+	if(key_pipe[0] >= 0)
+		return 0;
+	if(pipe(key_pipe) < 0) {
+		perror("input_queue_init");
+		return -1;
+	}
+	fcntl(key_pipe[0], F_SETFD, FD_CLOEXEC);
+	fcntl(key_pipe[1], F_SETFD, FD_CLOEXEC);
+	fcntl(key_pipe[1], F_SETFL, O_NONBLOCK);
+	return 0;
+}
+
+// Safe from any thread
+void input_queue_put(uint8_t key)
+{
+	if(write(key_pipe[1], &key, 1) != 1)
+		Printf("input: key %d dropped\n", key);
+}
+
+// Next key, or -1 after timeout_ms (-1 waits for ever)
+int input_queue_get(int timeout_ms)
+{
+	struct pollfd pfd = {.fd = key_pipe[0], .events = POLLIN};
+	uint8_t key;
+
+	for(;;)
+	{
+		if(poll(&pfd, 1, timeout_ms) <= 0) {
+			if(timeout_ms < 0 && errno == EINTR)
+				continue;
+			return -1;
+		}
+		if(read(key_pipe[0], &key, 1) == 1)
+			return key;
+	}
+}
+
+static int input_decode(int fd)
+{
+	struct input_event event;
+	static int roller_value = 0;
+	static int event_type_last = 0;
+	static int btn_value = 0;
+	static int btn_press_time = 0;
+
+	if(read(fd, &event, sizeof(event)) != sizeof(event))
+		return -1;
+
+	switch(event.type) {
+		case EV_SYN:
+			if(event.code != SYN_REPORT)
+				break;
+			if(event_type_last == EV_REL)
+				input_queue_put(roller_value == 1 ? DIAL_KEY_UP : DIAL_KEY_DOWN);
+			else if(event_type_last == EV_KEY) {
+				if(btn_value) {
+					if(btn_press_time == INPUT_LONG_PRESS)
+						input_queue_put(DIAL_KEY_PRESS);
+					btn_press_time++;
+				}
+				else {
+					if(btn_press_time < INPUT_LONG_PRESS)
+						input_queue_put(DIAL_KEY_CLICK);
+					btn_press_time = 0;
+				}
+			}
+			break;
+
+		case EV_KEY:
+			btn_value = event.value;
+			event_type_last = EV_KEY;
+			break;
+
+		case EV_REL:
+			if(event.code == REL_Y)
+				roller_value = event.value;
+			event_type_last = EV_REL;
+			break;
+
+		default:
+			break;
+	}
+	return 0;
+}
+
+// Reactor handler: decode every queued event of one device
+static void input_queue_event(int fd, void *arg)
+{
+	while(input_decode(fd) == 0);
+}
+
+// Registers an input device (or any fd carrying struct input_event) with
+// the reactor
+int input_queue_add(int fd)
+{
+	return reactor_add(fd, input_queue_event, NULL);
+}
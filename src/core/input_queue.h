@@ -0,0 +1,13 @@
+#ifndef _INPUT_QUEUE_H
+#define _INPUT_QUEUE_H
+
+#include <stdint.h>
+
+// Dial and right button presses. The reactor decodes them and queues
+// DIAL_KEY_* / RIGHT_KEY_* codes; thread_input runs their handlers.
+int  input_queue_init(void);
+int  input_queue_add(int fd);
+void input_queue_put(uint8_t key);
+int  input_queue_get(int timeout_ms);
+
+#endif
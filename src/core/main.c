@@ -14,6 +14,11 @@
 #include "input_device.h"
 #include "osd.h"
 #include "thread.h"
+#include "evloop.h"
+#include "reactor.h"
+#include "input_queue.h"
+#include "recorder.h"
+#include "sdcard.h"
 #include "imagesetting.h"
 #include "ht.h"
 #include "../driver/hardware.h"
@@ -141,6 +146,7 @@ static void *thread_autoscan(void *ptr)
 		g_menu_op = OPLEVEL_SUBMENU;
 		submenu_enter();
 		pthread_mutex_unlock(&lvgl_mutex);
+		evloop_notify(EV_TASK_LVGL);
 
 		if(g_autoscan_exit)
 			goto a_exit;
@@ -163,9 +169,9 @@ void start_running(void)
 		g_source_info.source = 0;
 		HDZero_open();
 		if(g_setting.autoscan.status) {//autoscan =1
-			pthread_t pid;
+			static const thread_desc_t autoscan = {"autoscan", thread_autoscan, THREAD_PRIO_NORMAL, THREAD_CPU_ANY};
 			g_autoscan_exit = false;
-			pthread_create(&pid,NULL,thread_autoscan,NULL);
+			thread_spawn(&autoscan, NULL, NULL);
 		}
 		else{ //auto scan disabled, go directly to last saved channel
 			g_menu_op = OPLEVEL_VIDEO;
@@ -227,7 +233,18 @@ void lvgl_init()
 
 int main(int argc, char* argv[])
 {
-	pthread_mutex_init(&lvgl_mutex, NULL);
+	pthread_mutexattr_t attr;
+
+	//no real-time thread takes lvgl_mutex; if one ever does, it boosts the
+	//holder to its SCHED_FIFO priority instead of waiting behind it
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+	pthread_mutex_init(&lvgl_mutex, &attr);
+	pthread_mutexattr_destroy(&attr);
+	thread_register_self("main");
+	evloop_init();
+	reactor_init();
+	input_queue_init();
 
 	gpio_init();
 	lvgl_init();
@@ -247,20 +264,12 @@ int main(int argc, char* argv[])
 
 	osd_init(); 
 	ims_init();
+	rec_init();
+	sdcard_init();
 	
 	start_running(); //start to run from saved settings
     create_threads();
 
-	for(;;)
-	{
-		pthread_mutex_lock(&lvgl_mutex);
-		statubar_update();
-		osd_hdzero_update();
-		ims_update();
-		lv_timer_handler();
-		source_status_timer();
-		pthread_mutex_unlock(&lvgl_mutex);
-		usleep(5000); 
-	}
+	evloop_run();
 	return 0;
 }
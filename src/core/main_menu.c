@@ -22,6 +22,7 @@
 #include "../driver/oled.h"
 #include "imagesetting.h"
 #include "playback.h"
+#include "evloop.h"
 
 lv_obj_t * menu;
 lv_obj_t * root_page;
@@ -183,6 +184,7 @@ void submenu_enter(void)
 	}
 	else if(pp == &pp_source) {
 		in_sourcepage = true;
+		evloop_notify(EV_TASK_SOURCE);
 	}
 	else if(pp == &pp_version) {
 		version_update_title();
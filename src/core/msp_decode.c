@@ -0,0 +1,194 @@
+#include "msp_decode.h"
+#include <string.h>
+
+static const uint8_t crc8tab[256] = {
+    0x00, 0xD5, 0x7F, 0xAA, 0xFE, 0x2B, 0x81, 0x54, 0x29, 0xFC, 0x56, 0x83, 0xD7, 0x02, 0xA8, 0x7D,
+    0x52, 0x87, 0x2D, 0xF8, 0xAC, 0x79, 0xD3, 0x06, 0x7B, 0xAE, 0x04, 0xD1, 0x85, 0x50, 0xFA, 0x2F,
+    0xA4, 0x71, 0xDB, 0x0E, 0x5A, 0x8F, 0x25, 0xF0, 0x8D, 0x58, 0xF2, 0x27, 0x73, 0xA6, 0x0C, 0xD9,
+    0xF6, 0x23, 0x89, 0x5C, 0x08, 0xDD, 0x77, 0xA2, 0xDF, 0x0A, 0xA0, 0x75, 0x21, 0xF4, 0x5E, 0x8B,
+    0x9D, 0x48, 0xE2, 0x37, 0x63, 0xB6, 0x1C, 0xC9, 0xB4, 0x61, 0xCB, 0x1E, 0x4A, 0x9F, 0x35, 0xE0,
+    0xCF, 0x1A, 0xB0, 0x65, 0x31, 0xE4, 0x4E, 0x9B, 0xE6, 0x33, 0x99, 0x4C, 0x18, 0xCD, 0x67, 0xB2,
+    0x39, 0xEC, 0x46, 0x93, 0xC7, 0x12, 0xB8, 0x6D, 0x10, 0xC5, 0x6F, 0xBA, 0xEE, 0x3B, 0x91, 0x44,
+    0x6B, 0xBE, 0x14, 0xC1, 0x95, 0x40, 0xEA, 0x3F, 0x42, 0x97, 0x3D, 0xE8, 0xBC, 0x69, 0xC3, 0x16,
+    0xEF, 0x3A, 0x90, 0x45, 0x11, 0xC4, 0x6E, 0xBB, 0xC6, 0x13, 0xB9, 0x6C, 0x38, 0xED, 0x47, 0x92,
+    0xBD, 0x68, 0xC2, 0x17, 0x43, 0x96, 0x3C, 0xE9, 0x94, 0x41, 0xEB, 0x3E, 0x6A, 0xBF, 0x15, 0xC0,
+    0x4B, 0x9E, 0x34, 0xE1, 0xB5, 0x60, 0xCA, 0x1F, 0x62, 0xB7, 0x1D, 0xC8, 0x9C, 0x49, 0xE3, 0x36,
+    0x19, 0xCC, 0x66, 0xB3, 0xE7, 0x32, 0x98, 0x4D, 0x30, 0xE5, 0x4F, 0x9A, 0xCE, 0x1B, 0xB1, 0x64,
+    0x72, 0xA7, 0x0D, 0xD8, 0x8C, 0x59, 0xF3, 0x26, 0x5B, 0x8E, 0x24, 0xF1, 0xA5, 0x70, 0xDA, 0x0F,
+    0x20, 0xF5, 0x5F, 0x8A, 0xDE, 0x0B, 0xA1, 0x74, 0x09, 0xDC, 0x76, 0xA3, 0xF7, 0x22, 0x88, 0x5D,
+    0xD6, 0x03, 0xA9, 0x7C, 0x28, 0xFD, 0x57, 0x82, 0xFF, 0x2A, 0x80, 0x55, 0x01, 0xD4, 0x7E, 0xAB,
+    0x84, 0x51, 0xFB, 0x2E, 0x7A, 0xAF, 0x05, 0xD0, 0xAD, 0x78, 0xD2, 0x07, 0x53, 0x86, 0x2C, 0xF9
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// CRC
+// The table is linear, so crc8_t[k] = crc8tab applied k+1 times gives the
+// contribution of a byte followed by k more; four bytes then take four
+// independent lookups instead of a chain of four.
+static uint8_t crc8_t[4][256];
+static bool    crc8_ready = false;
+
+static void crc8_init(void)
+{
+	memcpy(crc8_t[0], crc8tab, 256);
+	for(int k=1; k<4; k++)
+		for(int i=0; i<256; i++)
+			crc8_t[k][i] = crc8tab[crc8_t[k-1][i]];
+	crc8_ready = true;
+}
+
+uint8_t msp_crc8(uint8_t crc, const uint8_t *p, uint32_t len)
+{
+	if(!crc8_ready)
+		crc8_init();
+
+	while(len >= 4) {
+		crc = crc8_t[3][crc ^ p[0]] ^ crc8_t[2][p[1]] ^ crc8_t[1][p[2]] ^ crc8_t[0][p[3]];
+		p += 4;
+		len -= 4;
+	}
+	while(len--)
+		crc = crc8_t[0][crc ^ *p++];
+	return crc;
+}
+
+static uint8_t msp_xor(const uint8_t *p, uint32_t len)
+{
+	uint32_t w, acc = 0;
+	uint8_t x;
+
+	for(; len >= 4; p += 4, len -= 4) {
+		memcpy(&w, p, 4);
+		acc ^= w;
+	}
+	x = acc ^ (acc >> 8) ^ (acc >> 16) ^ (acc >> 24);
+	while(len--)
+		x ^= *p++;
+	return x;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Framing
+// Input is appended to dec->buf and scanned with memchr for the header. A
+// frame is handed out in place; the cheap xor check runs first so garbage
+// rarely reaches the CRC. A partial frame stays buffered for the next call.
+static void msp_scan(msp_decoder_t *dec, msp_frame_fn_t fn, void *arg)
+{
+	uint8_t *p = dec->buf;
+	uint8_t *end = dec->buf + dec->len;
+	uint8_t *h;
+	uint32_t n;
+
+	while(p < end)
+	{
+		h = memchr(p, HEADER0, end - p);
+		if(!h) {
+			dec->skipped += end - p;
+			p = end;
+			break;
+		}
+		dec->skipped += h - p;
+		p = h;
+
+		if(end - p < 4)
+			break;
+		if(p[1] != HEADER1 || p[3] >= RXBUF_SIZE) {
+			dec->skipped++;
+			p++;
+			continue;
+		}
+
+		n = 4 + p[3];
+		if(end - p < n + 2)
+			break;
+		if(msp_xor(p, n) != p[n] || msp_crc8(0, p, n) != p[n+1]) {
+			dec->crc_err++;
+			p++;
+			continue;
+		}
+
+		dec->frames++;
+		fn(p[2] == 0xff, p[2], &p[3], arg);
+		p += n + 2;
+	}
+
+	dec->len = end - p;
+	memmove(dec->buf, p, dec->len);
+}
+
+void msp_decode(msp_decoder_t *dec, const uint8_t *data, uint32_t len, msp_frame_fn_t fn, void *arg)
+{
+	uint32_t n;
+
+	while(len)
+	{
+		n = MSP_DEC_BUF - dec->len;
+		if(n > len)
+			n = len;
+		memcpy(&dec->buf[dec->len], data, n);
+		dec->len += n;
+		data += n;
+		len -= n;
+		msp_scan(dec, fn, arg);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// OSD row
+// rx_buf: [0]=len, [1..]=column mask (7 bytes HD, 4 SD), SD only: 4 bytes of
+// location bits, then one byte per set mask bit and the page bits.
+static uint64_t load_le(const uint8_t *p, int n)
+{
+	uint64_t v = 0;
+
+	while(n--)
+		v = (v << 8) | p[n];
+	return v;
+}
+
+/*
+    scaler from hmax30 to hmax53
+*/
+static uint8_t msp_scaler(uint8_t iX)
+{
+	return ((uint16_t)iX * 904) >> 9;
+}
+
+void msp_osd_line(const uint8_t *rx_buf, bool hd, uint16_t *line_buf)
+{
+	uint8_t hmax = hd ? HD_HMAX : SD_HMAX;
+	const uint8_t *chars = &rx_buf[hd ? 8 : 9];
+	uint64_t mask = load_le(&rx_buf[1], hd ? 7 : 4) & ((1ULL << hmax) - 1);
+	uint32_t loc = hd ? 0 : load_le(&rx_buf[5], 4);
+	int num = __builtin_popcountll(mask);
+	// The page bit index only advances on a set bit, so exactly the leading
+	// run of ones puts characters on the second page.
+	int paged = __builtin_ctzll(~load_le(&chars[num], (num + 7) >> 3));
+	uint8_t waddr = 0;
+	int n = 0;
+
+	for(int i=0; i<SD_HMAX_EXT; i++)
+		line_buf[i] = 0x20;
+
+	if(!loc) {
+		// column i lands on i+1, so only the set bits need visiting
+		for(; mask; mask &= mask - 1, n++)
+			line_buf[__builtin_ctzll(mask) + 1] = chars[n] + (n < paged ? 256 : 0);
+		return;
+	}
+
+	for(int i=0; i<hmax; i++)
+	{
+		if((loc >> i) & 1)
+			waddr = msp_scaler(i);
+		else
+			waddr++;
+
+		if((mask >> i) & 1) {
+			line_buf[waddr] = chars[n] + (n < paged ? 256 : 0);
+			n++;
+		}
+		else
+			line_buf[waddr] = 0x20;
+	}
+}
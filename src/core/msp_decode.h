@@ -0,0 +1,28 @@
+#ifndef __MSP_DECODE_H
+#define __MSP_DECODE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "msp_displayport.h"
+
+// Displayport frames from the VTX: 56 80 <index> <len> <data[len]> <xor> <crc8>,
+// both checks covering header to data. index 0xFF is the config frame,
+// anything else an OSD row. len is below RXBUF_SIZE.
+#define MSP_DEC_BUF		512
+
+// rx_buf[0] = len, rx_buf[1..len] = data; valid during the call only
+typedef void (*msp_frame_fn_t)(uint8_t function, uint8_t index, uint8_t *rx_buf, void *arg);
+
+typedef struct {
+	uint8_t  buf[MSP_DEC_BUF + RXBUF_SIZE];	//parsers may read RXBUF_SIZE past rx_buf
+	uint16_t len;
+	uint32_t frames;
+	uint32_t crc_err;
+	uint32_t skipped;	//bytes outside any frame
+} msp_decoder_t;
+
+void    msp_decode(msp_decoder_t *dec, const uint8_t *data, uint32_t len, msp_frame_fn_t fn, void *arg);
+uint8_t msp_crc8(uint8_t crc, const uint8_t *p, uint32_t len);
+void    msp_osd_line(const uint8_t *rx_buf, bool hd, uint16_t *line_buf);
+
+#endif
@@ -5,8 +5,10 @@
 //#include "cmd_struct.h"
 #include <string.h>
 #include <stdio.h>
+#include <pthread.h>
 #include "msp_displayport.h"
-#include "osd.h"
+#include "msp_decode.h"
+#include "telemetry.h"
 //#include "i2c_device.h"
 //#include "isr.h"
 //#include "hardware.h"
@@ -14,25 +16,6 @@
 
 int seconds = 0;
 
-uint8_t crc8tab[256] = {
-    0x00, 0xD5, 0x7F, 0xAA, 0xFE, 0x2B, 0x81, 0x54, 0x29, 0xFC, 0x56, 0x83, 0xD7, 0x02, 0xA8, 0x7D,
-    0x52, 0x87, 0x2D, 0xF8, 0xAC, 0x79, 0xD3, 0x06, 0x7B, 0xAE, 0x04, 0xD1, 0x85, 0x50, 0xFA, 0x2F,
-    0xA4, 0x71, 0xDB, 0x0E, 0x5A, 0x8F, 0x25, 0xF0, 0x8D, 0x58, 0xF2, 0x27, 0x73, 0xA6, 0x0C, 0xD9,
-    0xF6, 0x23, 0x89, 0x5C, 0x08, 0xDD, 0x77, 0xA2, 0xDF, 0x0A, 0xA0, 0x75, 0x21, 0xF4, 0x5E, 0x8B,
-    0x9D, 0x48, 0xE2, 0x37, 0x63, 0xB6, 0x1C, 0xC9, 0xB4, 0x61, 0xCB, 0x1E, 0x4A, 0x9F, 0x35, 0xE0,
-    0xCF, 0x1A, 0xB0, 0x65, 0x31, 0xE4, 0x4E, 0x9B, 0xE6, 0x33, 0x99, 0x4C, 0x18, 0xCD, 0x67, 0xB2,
-    0x39, 0xEC, 0x46, 0x93, 0xC7, 0x12, 0xB8, 0x6D, 0x10, 0xC5, 0x6F, 0xBA, 0xEE, 0x3B, 0x91, 0x44,
-    0x6B, 0xBE, 0x14, 0xC1, 0x95, 0x40, 0xEA, 0x3F, 0x42, 0x97, 0x3D, 0xE8, 0xBC, 0x69, 0xC3, 0x16,
-    0xEF, 0x3A, 0x90, 0x45, 0x11, 0xC4, 0x6E, 0xBB, 0xC6, 0x13, 0xB9, 0x6C, 0x38, 0xED, 0x47, 0x92,
-    0xBD, 0x68, 0xC2, 0x17, 0x43, 0x96, 0x3C, 0xE9, 0x94, 0x41, 0xEB, 0x3E, 0x6A, 0xBF, 0x15, 0xC0,
-    0x4B, 0x9E, 0x34, 0xE1, 0xB5, 0x60, 0xCA, 0x1F, 0x62, 0xB7, 0x1D, 0xC8, 0x9C, 0x49, 0xE3, 0x36,
-    0x19, 0xCC, 0x66, 0xB3, 0xE7, 0x32, 0x98, 0x4D, 0x30, 0xE5, 0x4F, 0x9A, 0xCE, 0x1B, 0xB1, 0x64,
-    0x72, 0xA7, 0x0D, 0xD8, 0x8C, 0x59, 0xF3, 0x26, 0x5B, 0x8E, 0x24, 0xF1, 0xA5, 0x70, 0xDA, 0x0F,
-    0x20, 0xF5, 0x5F, 0x8A, 0xDE, 0x0B, 0xA1, 0x74, 0x09, 0xDC, 0x76, 0xA3, 0xF7, 0x22, 0x88, 0x5D,
-    0xD6, 0x03, 0xA9, 0x7C, 0x28, 0xFD, 0x57, 0x82, 0xFF, 0x2A, 0x80, 0x55, 0x01, 0xD4, 0x7E, 0xAB,
-    0x84, 0x51, 0xFB, 0x2E, 0x7A, 0xAF, 0x05, 0xD0, 0xAD, 0x78, 0xD2, 0x07, 0x53, 0x86, 0x2C, 0xF9
-};
-
 video_resolution_t CAM_MODE = VR_720P60; 
 uint8_t fc_variant[4] = {"BTFL"}; // 4 char ASCII from FC
 uint8_t link_quality = 0;   // bit[7:0]: LQ(8~0)
@@ -54,7 +37,7 @@ static osd_resolution_t resolution_last = HD_5018;
 uint8_t lq_err_cnt = 0;
 uint8_t lq_rcv_cnt = 0;
 
-uint16_t osd_buf[HD_VMAX][SD_HMAX_EXT];
+uint16_t osd_buf[HD_VMAX][SD_HMAX_EXT];	//back: rows as the parser receives them
 uint16_t osd_buf_shadow[HD_VMAX][SD_HMAX_EXT];
 uint8_t osd_init_done = 0;
 uint8_t fc_init_done = 0;
@@ -62,6 +45,17 @@ uint8_t fc_init_done = 0;
 uint16_t last_rcv_seconds0 = 0;
 uint16_t last_rcv_seconds1 = 0;
 
+// Front grid: the last complete OSD frame, the only one the compositor sees
+static uint16_t        osd_front[HD_VMAX][SD_HMAX_EXT];
+static uint32_t        osd_back_rows = 0;	//rows received since the last commit
+static uint32_t        osd_back_dirty = 0;	//rows changed since the last commit
+static pthread_mutex_t osd_grid_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// bit[n]: row n of osd_front changed since the compositor last looked at it
+static uint32_t        osd_dirty_rows = 0;
+static pthread_mutex_t osd_dirty_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  osd_dirty_cond = PTHREAD_COND_INITIALIZER;
+
 /*
 void fc_msp_displayport()
 {
@@ -76,150 +70,46 @@ void fc_msp_displayport()
     }
 }
 */
+static void link_publish(void)
+{
+    tlm_link_t link;
+
+    memset(&link, 0, sizeof(link));
+    link.cam_mode = CAM_MODE;
+    link.link_quality = link_quality;
+    link.vtx_temp = vtxTempInfo;
+    tlm_publish(TLM_LINK, &link);
+}
+
 void fc_init()
 {
 	clear_screen();
     vtxType = 0;
     vtxTempInfo = 0;
+    link_publish();
+}
+
+static void msp_frame(uint8_t function, uint8_t index, uint8_t *rx_buf, void *arg)
+{
+    parser_rx(function, index, rx_buf);
+    last_rcv_seconds0 = seconds;
 }
 
 void recive_one_frame(uint8_t* uart_buf,uint8_t uart_buf_len)
 {
-    static uint8_t rx_buf[RXBUF_SIZE];
-    static uint8_t rx_state = RX_HEADER0;
-    static uint8_t length = 0;
-    static uint8_t ptr = 0;
-    static uint8_t function = 0;// 0:osd;  1:config
-    static uint8_t index = 0;
-    static uint8_t crc0;
-    static uint8_t crc1;
-	uint8_t rx;
-     
-    uint8_t uart_buf_ptr;
-    //while(RS_ready1())
-    for(uart_buf_ptr=0; uart_buf_ptr<uart_buf_len; uart_buf_ptr++)
-    {
-        //rx = RS_rx1();
-        rx = uart_buf[uart_buf_ptr];
+    static msp_decoder_t dec;
 
+    if(uart_buf_len)
         last_rcv_seconds1 = seconds;
-        #if(0)
-        _outchar(rx);
-        #endif
-        switch(rx_state)
-        {
-		
-            case RX_HEADER0:
-			crc0 = 0;
-            crc1 = 0;
-            crc0 ^= rx;
-            crc1 = crc8tab[crc1 ^ rx];
-			if(rx == HEADER0)
-				rx_state = RX_HEADER1;
-
-			break;
-
-            case RX_HEADER1:
-            crc0 ^= rx;
-            crc1 = crc8tab[crc1 ^ rx];
-			if(rx == HEADER1)
-				rx_state = RX_INDEX;
-			else
-				rx_state = RX_HEADER0;
-				
-			break;
-	
-
-            case RX_INDEX:
-                crc0 ^= rx;
-                crc1 = crc8tab[crc1 ^ rx];
-                index = rx;
-                if(index == 0xff)
-                    function = 1;
-                else
-                    function = 0;
-                //_outchar(index);
-                rx_state = RX_LENGTH;
-                break;
-            
-            case RX_LENGTH:
-                crc0 ^= rx;
-                crc1 = crc8tab[crc1 ^ rx];
-                length = rx;
-                if(length >= 64)
-                    rx_state = RX_HEADER0;
-                else if(length == 0)
-                    rx_state = RX_CRC0;
-                else{
-                    if(function)
-                        rx_state = RX_CONFIG;
-                    else
-                        rx_state = RX_OSD;
-                }
-                ptr = 0;
-                rx_buf[ptr] = length;
-                ptr ++;
-                break;
-            
-            case RX_CONFIG:
-                crc0 ^= rx;
-                crc1 = crc8tab[crc1 ^ rx];
-                rx_buf[ptr] = rx;
-                ptr ++;
-                length --;
-                if(length == 0)
-                    rx_state = RX_CRC0;
-                break;
-            
-            case RX_OSD:
-                crc0 ^= rx;
-                crc1 = crc8tab[crc1 ^ rx];
-                rx_buf[ptr] = rx;
-                ptr ++;
-                length --;
-                if(length == 0)
-                    rx_state = RX_CRC0;
-                break;
-
-            case RX_CRC0:
-                if(rx == crc0)
-				{
-                    rx_state = RX_CRC1;
-				}
-                else
-				{
-                    rx_state = RX_HEADER0;
-#if 0
-					for(int i=0; i<10;i++)
-					{
-						printf("%02X ", rx_buf[i]);
-					}
-					printf("\n");
-#endif
-			//		printf("crc0 err\n");
-				}
-                break;
-
-            case RX_CRC1:
-                if(rx == crc1){
-                    parser_rx(function, index, rx_buf);
-                    last_rcv_seconds0 = seconds;
-                }
-                rx_state = RX_HEADER0;
-                break;
-
-            default:
-                rx_state = RX_HEADER0;
-                break;
-
-        }// switch(rx_state)
-    }// while(RS_ready1())
+    msp_decode(&dec, uart_buf, uart_buf_len, msp_frame, NULL);
 }
 
 void parser_rx(uint8_t function, uint8_t index, uint8_t* rx_buf)
 {
-    if(function)
+    if(function) {
         parser_config(rx_buf);
+        osd_commit();  //the VTX sends config once per refresh
+    }
     else
         parser_osd(index, rx_buf);
 }
@@ -261,8 +151,10 @@ void camTypeDetect(uint8_t rData)
                 cur_cam = VR_540P90_CROP;
                 break;
     }
-    if(cur_cam == last_cam)
+    if(cur_cam == last_cam) {
         CAM_MODE = cur_cam;
+        link_publish();
+    }
 
     //printf("\nCam:%d\n",CAM_MODE);
 }
@@ -273,6 +165,13 @@ void fcTypeDetect(uint8_t* rData)
     
     for(i=0;i<4;i++)
         fc_variant[i] = rData[i];
+
+    if(!memcmp(fc_variant, "INAV", 4))
+        osd_font_select(INAV);
+    else if(!memcmp(fc_variant, "ARDU", 4))
+        osd_font_select(ARDU);
+    else
+        osd_font_select(BTFL);
     #if(0)
     //printf("\r\nfc:");
     _outchar(fc_variant[0]);
@@ -318,12 +217,14 @@ void lqStatistics()
         last_sec = seconds;
         lq_rcv_cnt = 0;
         lq_err_cnt = 0;
+        link_publish();
     }
 }
 
 void vtxTempDetect(uint8_t rData)
 {
     vtxTempInfo = rData;
+    link_publish();
     //printf("\r\ntemp:%bx",vtxTempInfo);
 }
 
@@ -368,32 +269,9 @@ void parser_config(uint8_t *rx_buf)
     vtxCamRatioDetect(rx_buf[12]);
 }
 
-/*
-    scaler from hmax30 to hmax53
-*/
-uint8_t scalerX(uint8_t iX)
-{
-    uint16_t iX_u16 = (uint16_t)iX;
-    uint16_t oX_u16;
-    
-    oX_u16 = (iX_u16 * 904) >> 9;
-    
-    return (uint8_t)oX_u16;
-}
-
-
 void parser_osd(uint8_t row, uint8_t *rx_buf)
 {
-    uint16_t ch;
-    uint8_t i,j,ptr;
-    uint8_t mask[7] = {0};
     uint16_t line_buf[SD_HMAX_EXT];
-    uint8_t hmax;
-    uint8_t len_mask;
-    uint32_t loc_buf = 0;
-    uint8_t page_buf[7];
-    uint8_t chNum = 0;
-    uint8_t pageNum = 0;
     static uint8_t row_last = 0;
 
     //detect resolution
@@ -404,105 +282,140 @@ void parser_osd(uint8_t row, uint8_t *rx_buf)
 
     
     if(resolution != resolution_last)
-        clear_screen();
+        osd_back_clear();  //the front keeps the old frame until the new one is complete
     
     resolution_last = resolution;
     row_last = row;
     
     row &= 0x1f;
-    
-    if(resolution == HD_5018){
-        hmax = HD_HMAX;
-        len_mask = 7;
-        ptr = 8;
-    }else{
-        ptr = 9;
-        len_mask = 4;
-        hmax = SD_HMAX;
-    }
-    
-    //init line_buf
-    for(i=0;i<SD_HMAX_EXT;i++)
-        line_buf[i] = 0x20;
-
-    //parse mask
-    for(i=0;i<len_mask;i++){
-        mask[i] = rx_buf[i+1];
-    }
 
-    //parse loc
-    if(resolution == SD_3016){
-        loc_buf = (uint32_t)rx_buf[5] << 0;
-        loc_buf += (uint32_t)rx_buf[6] << 8;
-        loc_buf += (uint32_t)rx_buf[7] << 16;
-        loc_buf += (uint32_t)rx_buf[8] << 24;
-    }
-    
-    //parse page
-    chNum = 0;
-    for(i=0;i<hmax;i++)
-        chNum += (mask[i>>3]>>(i&7))&1;
-    pageNum = chNum + 7;
-    pageNum = pageNum >> 3;
-    
-    for(i=0;i<pageNum;i++)
-        page_buf[i] = rx_buf[ptr+chNum+i];
-
-    //parse one line osd to line_buf
-    uint8_t waddr = 0;
-    j = 0;
-    for(i=0;i<hmax;i++){
-        //parse ch
-        if((mask[i>>3]>>(i&7))&0x01)
-		{
-            ch = rx_buf[ptr++];
-            if((page_buf[j>>3] >> (j&0x07)) & 1){
-                ch += 256;
-                j++;
-            }
-		}
-        else
-		{
-            ch = 0x20;
-		}
-        //parse waddr
-        if((loc_buf >> i) & 1)
-            waddr = scalerX(i);
-        else
-            waddr++;
-        
-        line_buf[waddr] = ch;
-    }
+    msp_osd_line(rx_buf, resolution == HD_5018, line_buf);
     update_osd(line_buf, row);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Double-buffered grid
+// Rows land in osd_buf and reach osd_front together once a refresh is
+// complete: every row of the current resolution seen, a row seen twice (the
+// next refresh has begun) or a config frame. The compositor never sees half
+// of a refresh.
+
+// osd_grid_mutex must be held
+static void osd_commit_locked(void)
+{
+	uint32_t dirty = osd_back_dirty;
+
+	for(int i=0; i<HD_VMAX; i++)
+		if(dirty & (1 << i))
+			memcpy(osd_front[i], osd_buf[i], sizeof(osd_front[i]));
+	osd_back_rows = 0;
+	osd_back_dirty = 0;
+	if(dirty)
+		osd_mark_dirty(dirty);
+}
+
+void osd_commit(void)
+{
+	pthread_mutex_lock(&osd_grid_mutex);
+	osd_commit_locked();
+	pthread_mutex_unlock(&osd_grid_mutex);
+}
+
+void osd_back_clear(void)
+{
+	pthread_mutex_lock(&osd_grid_mutex);
+	for(int i=0; i<HD_VMAX; i++)
+		for(int j=0; j<SD_HMAX_EXT; j++)
+			osd_buf[i][j] = 0x20;
+	osd_back_rows = 0;
+	osd_back_dirty = OSD_ALL_ROWS;
+	pthread_mutex_unlock(&osd_grid_mutex);
+}
+
+// Clears both grids at once, for the UI
 void clear_screen()
 {
+	pthread_mutex_lock(&osd_grid_mutex);
 	for(int i=0; i<HD_VMAX; i++)
 	{
 		for(int j=0; j<SD_HMAX_EXT; j++)
 		{
 			osd_buf[i][j] = 0x20;
+			osd_front[i][j] = 0x20;
 		}
 	}
+	osd_back_rows = 0;
+	osd_back_dirty = 0;
+	pthread_mutex_unlock(&osd_grid_mutex);
+	osd_mark_dirty(OSD_ALL_ROWS);
 //	draw_osd_on_console();
 //	draw_osd_on_screen();
 }
 
 void update_osd(uint16_t* line_buf, uint8_t row)
 {
-    uint8_t i;
+    uint32_t all = (resolution == HD_5018) ? (1 << HD_VMAX) - 1 : (1 << SD_VMAX) - 1;
 
-    for(i=0;i<SD_HMAX_EXT;i++)
-	{
-		if(osd_buf[row][i] != line_buf[i])
-		{
-        	osd_buf[row][i] = line_buf[i];
-			///draw_osd_on_screen(row, i);
-		}
+    if(row >= HD_VMAX)
+        return;
 
-	}
-//	draw_osd_on_console();
-//	draw_osd_on_screen();
+    pthread_mutex_lock(&osd_grid_mutex);
+    if(osd_back_rows & (1 << row))
+        osd_commit_locked();
+
+    if(memcmp(osd_buf[row], line_buf, sizeof(osd_buf[row]))) {
+        memcpy(osd_buf[row], line_buf, sizeof(osd_buf[row]));
+        osd_back_dirty |= 1 << row;
+    }
+    osd_back_rows |= 1 << row;
+
+    if((osd_back_rows & all) == all)
+        osd_commit_locked();
+    pthread_mutex_unlock(&osd_grid_mutex);
+}
+
+// Copies the given rows of the front grid into dst
+void osd_front_read(uint16_t (*dst)[SD_HMAX_EXT], uint32_t rows)
+{
+	pthread_mutex_lock(&osd_grid_mutex);
+	for(int i=0; i<HD_VMAX; i++)
+		if(rows & (1 << i))
+			memcpy(dst[i], osd_front[i], sizeof(osd_front[i]));
+	pthread_mutex_unlock(&osd_grid_mutex);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Dirty rows of osd_front, handed from the parser to the OSD compositor
+void osd_mark_dirty(uint32_t rows)
+{
+	pthread_mutex_lock(&osd_dirty_mutex);
+	osd_dirty_rows |= rows;
+	pthread_cond_signal(&osd_dirty_cond);
+	pthread_mutex_unlock(&osd_dirty_mutex);
+}
+
+// Blocks until some rows are dirty, then returns and clears them.
+uint32_t osd_wait_dirty(void)
+{
+	uint32_t rows;
+
+	pthread_mutex_lock(&osd_dirty_mutex);
+	while(!osd_dirty_rows)
+		pthread_cond_wait(&osd_dirty_cond, &osd_dirty_mutex);
+	rows = osd_dirty_rows;
+	osd_dirty_rows = 0;
+	pthread_mutex_unlock(&osd_dirty_mutex);
+	return rows;
+}
+
+// Same without blocking; 0 if nothing changed.
+uint32_t osd_take_dirty(void)
+{
+	uint32_t rows;
 
+	pthread_mutex_lock(&osd_dirty_mutex);
+	rows = osd_dirty_rows;
+	osd_dirty_rows = 0;
+	pthread_mutex_unlock(&osd_dirty_mutex);
+	return rows;
 }
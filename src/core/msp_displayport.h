@@ -2,6 +2,7 @@
 #define __MSP_DISPLAYPORT_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #define SD_HMAX     30
 #define SD_HMAX_EXT 53
@@ -10,6 +11,8 @@
 #define HD_VMAX     18
 #define RXBUF_SIZE  64
 
+#define OSD_ALL_ROWS ((1 << HD_VMAX) - 1)
+
 //#define DEBUG_DISPLAYPORT
 
 #define HEADER0 0x56
@@ -32,17 +35,6 @@ typedef enum{
     VR_540P90_CROP = 6
 } video_resolution_t;
 
-typedef enum{
-    RX_HEADER0,
-    RX_HEADER1,
-    RX_INDEX,
-    RX_LENGTH,
-    RX_CONFIG,
-    RX_OSD,
-    RX_CRC0,
-    RX_CRC1
-}rx_state_e;
-
 typedef enum{
     BTFL,
     INAV,
@@ -61,6 +53,15 @@ void parser_osd(uint8_t raw, uint8_t* rx_buf);
 void clear_screen();
 void write_string(uint8_t ch, uint8_t* line_buf, uint8_t col);
 void update_osd(uint16_t* line_buf, uint8_t raw);
+void osd_mark_dirty(uint32_t rows);
+uint32_t osd_wait_dirty(void);
+uint32_t osd_take_dirty(void);
+void osd_commit(void);
+void osd_back_clear(void);
+void osd_front_read(uint16_t (*dst)[SD_HMAX_EXT], uint32_t rows);
+
+// Implemented by the OSD compositor (osd.c)
+void osd_font_select(uint8_t variant);
 
 void camTypeDetect(uint8_t rData);
 void fcTypeDetect(uint8_t* rData);
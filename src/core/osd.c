@@ -9,6 +9,7 @@
 #include <stdlib.h>
 #include <pthread.h>
 #include <sys/time.h>
+#include <stdatomic.h>
 #include "common.hh"
 #include "lvgl/lvgl.h"
 #include "msp_displayport.h"
@@ -22,6 +23,12 @@
 #include "../minIni/minIni.h"
 #include "../driver/fans.h"
 #include "../core/imagesetting.h"
+#include "icons.h"
+#include "evloop.h"
+#include "telemetry.h"
+#include "thread.h"
+#include "recorder.h"
+#include "sdcard.h"
 
 //////////////////////////////////////////////////////////////////
 //Global
@@ -32,22 +39,6 @@ extern pthread_mutex_t lvgl_mutex;
 
 
 ///////////////////////////////////////////////////////////////////
-bool 	confirm_recording()
-{
-	bool ret;
-	FILE   *stream;  
-	char   buf[10]; 
-	memset( buf, '\0', sizeof(buf) );
-	stream = popen( "cat /tmp/record.dat" , "r" );
-	fread( buf, sizeof(char), sizeof(buf),  stream);  
-	pclose( stream ); 
-	ret = (strcmp(buf, "1") == 0);
-	if(!ret) {
-		Printf("rec_start failed: %s.\n",buf);
-	}
-	return ret;
-}
-
 void enable_line_out(bool bEnable)
 {
 	char buf[128];
@@ -79,39 +70,30 @@ void sel_audio_source(uint8_t source)
 	system(buf);
 }
 
-void update_record_conf()
+// Recording parameters for the current source
+static void record_param(RecordMsgParam_t *param)
 {
-	if(g_setting.record.format_ts)
-		ini_puts("record", "type", "ts", REC_CONF);
-	else
-		ini_puts("record", "type", "mp4", REC_CONF);
+	param->format_ts = g_setting.record.format_ts;
+	param->audio = g_setting.record.audio;
+	param->kbps = 24000;
+	param->h265 = 1;
+	param->vi_fps = 60;
+	param->venc_fps = 60;
 
 	if(g_source_info.source == 0) {
-		if(CAM_MODE == VR_540P90 || CAM_MODE == VR_540P90_CROP) {  //90fps
-			ini_putl("venc", "fps", 90,    REC_CONF);
-			ini_putl("venc", "kbps",34000, REC_CONF);
-			ini_putl("venc", "h265",0,     REC_CONF);
-			ini_putl("vi",   "fps", 90,    REC_CONF);
-		}
-		else {
-			ini_putl("venc", "fps", 60,    REC_CONF);
-			ini_putl("venc", "kbps",24000, REC_CONF);
-			ini_putl("venc", "h265", 1,    REC_CONF);
-			ini_putl("vi",   "fps", 60,    REC_CONF);
+		tlm_link_t link;
+		tlm_read(TLM_LINK, &link);
+		if(link.cam_mode == VR_540P90 || link.cam_mode == VR_540P90_CROP) {  //90fps
+			param->venc_fps = 90;
+			param->kbps = 34000;
+			param->h265 = 0;
+			param->vi_fps = 90;
 		}
 	}
 	else { //AV -- HDMI no record
-		ini_putl("venc", "kbps",24000, REC_CONF);
-		ini_putl("venc", "h265", 1,    REC_CONF);
-		ini_putl("vi",   "fps", 60,    REC_CONF);
 		if(g_hw_stat.av_pal)
-			ini_putl("venc", "fps", 50,    REC_CONF);
-		else	
-			ini_putl("venc", "fps", 60,    REC_CONF);
+			param->venc_fps = 50;
 	}
-
-	ini_putl("record", "audio", g_setting.record.audio, REC_CONF);
-	sel_audio_source(g_setting.record.audio_source);
 }
 
 //////////////////////////////////////////////////////////////////
@@ -126,11 +108,13 @@ static pthread_mutex_t dvr_mutex;
 void rbtn_click(bool is_short, int mode)
 {
 	bool start_rec;
-	
-	Printf("rbtn_click: sdcard=%d, recording=%d, mode=%d\n",g_sdcard_enable,is_recording,mode);
+	tlm_sdcard_t sd;
+
+	tlm_read(TLM_SDCARD, &sd);
+	Printf("rbtn_click: sdcard=%d, recording=%d, mode=%d\n",sd.present,is_recording,mode);
 
 	if(is_short) { // short press right button
-		if(!g_sdcard_enable) return;
+		if(!sd.present) return;
 
 		pthread_mutex_lock(&dvr_mutex);
 		if(mode == 1)
@@ -143,17 +127,16 @@ void rbtn_click(bool is_short, int mode)
 		if(!start_rec){
 			if(is_recording) {
 				osd_rec_update(false);
-				system(REC_STOP);
-				usleep(200000); //200ms
+				rec_stop();
 			}
 		}
 		else{	
 			if(!is_recording) {
-				update_record_conf();
+				RecordMsgParam_t param;
+				record_param(&param);
+				sel_audio_source(g_setting.record.audio_source);
 				osd_rec_update(true);
-				system(REC_START);
-				sleep(2); //wait for record process 
-				if(!confirm_recording()){
+				if(!rec_start(&param)){
 					osd_rec_update(false);
 				}	
 			}
@@ -168,29 +151,34 @@ void rbtn_click(bool is_short, int mode)
 ///////////////////////////////////////////////////////////////////////////////
 // these are local for OSD controlling
 static osd_hdzero_t g_osd_hdzero;
-static lv_obj_t *img_arr[HD_VMAX][HD_HMAX];
+static lv_obj_t *osd_layer;
 static lv_obj_t *scr_main; 
 static lv_obj_t *scr_osd;
-static uint32_t   osdFont[OSD_VNUM][OSD_HNUM][OSD_HEIGHT][OSD_WIDTH] ; //0x00bbggrr
-static osd_font_t osd_font;
+static osd_font_t osd_fonts[FC_END];		//user fonts from the SD card
+static osd_font_t osd_font_builtin;			//OSD_FILE, the only font that ships
+static const osd_font_t *_Atomic osd_font_active;
+static atomic_bool osd_font_swapped;
+
+// telemetry snapshots, refreshed once per osd_hdzero_update
+static tlm_rx_t osd_rx;
+static tlm_power_t osd_power;
+static tlm_link_t osd_link;
 
 void osd_rec_update(bool enable)
 {
 	is_recording = enable;
+	sdcard_recording(enable);
 }
 
 void osd_llock_show(bool bShow)
 {
-	char buf[128];
-
 	if(!bShow) {
 		lv_obj_add_flag(g_osd_hdzero.latency_lock, LV_OBJ_FLAG_HIDDEN);
 		return;
 	}
 	
 	if(g_latency_locked) {
-		sprintf(buf,"%s%s",RESOURCE_PATH,LLOCK_bmp);
-    	lv_img_set_src(g_osd_hdzero.latency_lock, buf);
+		icon_set(g_osd_hdzero.latency_lock, ICON_LLOCK);
 		lv_obj_clear_flag(g_osd_hdzero.latency_lock, LV_OBJ_FLAG_HIDDEN);
 	}
 	else 
@@ -199,22 +187,21 @@ void osd_llock_show(bool bShow)
 
 void osd_rec_show(bool bShow)
 {
-	char buf[128];
+	tlm_sdcard_t sd;
 
 	if(!bShow) {
 		lv_obj_add_flag(g_osd_hdzero.sd_rec, LV_OBJ_FLAG_HIDDEN);
 		return;
 	}
 	
-	if(!g_sdcard_enable) {
-		sprintf(buf,"%s%s",RESOURCE_PATH,noSdcard_bmp);
-    	lv_img_set_src(g_osd_hdzero.sd_rec, buf);
+	tlm_read(TLM_SDCARD, &sd);
+	if(!sd.present) {
+		icon_set(g_osd_hdzero.sd_rec, ICON_NOSDCARD);
 		lv_obj_clear_flag(g_osd_hdzero.sd_rec, LV_OBJ_FLAG_HIDDEN);
 	}
 	else {
 		if(is_recording) {
-			sprintf(buf,"%s%s",RESOURCE_PATH,recording_bmp);
-			lv_img_set_src(g_osd_hdzero.sd_rec, buf);
+			icon_set(g_osd_hdzero.sd_rec, ICON_RECORDING);
 			lv_obj_clear_flag(g_osd_hdzero.sd_rec, LV_OBJ_FLAG_HIDDEN);
 		}
 		else
@@ -229,7 +216,7 @@ void osd_battery_show()
 		return;
 	}
 
-	int vol_sigle = g_battery.voltage/g_battery.type;
+	int vol_sigle = osd_power.battery.voltage/osd_power.battery.type;
 	if(vol_sigle  <  g_setting.power.voltage * 100)
 		lv_obj_clear_flag(g_osd_hdzero.battery, LV_OBJ_FLAG_HIDDEN);
 	else
@@ -238,21 +225,19 @@ void osd_battery_show()
 
 void osd_topfan_show(bool bShow)
 {
-	char buf[128];
 	if(!bShow) {
 		lv_obj_add_flag(g_osd_hdzero.topfan_speed, LV_OBJ_FLAG_HIDDEN);
 		return;
 	}
 
 	if(g_setting.fans.top_speed>5) return;
-	sprintf(buf,"%sfan%d.bmp",RESOURCE_PATH,fan_speeds[2]+1);
-    lv_img_set_src(g_osd_hdzero.topfan_speed, buf);
+	icon_set(g_osd_hdzero.topfan_speed, ICON_FAN(fan_speeds[2]+1));
 	lv_obj_clear_flag(g_osd_hdzero.topfan_speed, LV_OBJ_FLAG_HIDDEN);
 }
 
 void osd_vrxtemp_show(bool bShow)
 {
-	if(g_temperature.is_rescuing)			
+	if(osd_power.temperature.is_rescuing)			
 		lv_obj_clear_flag(g_osd_hdzero.vrx_temp, LV_OBJ_FLAG_HIDDEN);
 	else
 		lv_obj_add_flag(g_osd_hdzero.vrx_temp, LV_OBJ_FLAG_HIDDEN);
@@ -260,19 +245,16 @@ void osd_vrxtemp_show(bool bShow)
 
 void osd_vlq_show(bool bShow)
 {
-	char buf[128];
 	if(!bShow) {
 		lv_obj_add_flag(g_osd_hdzero.vlq, LV_OBJ_FLAG_HIDDEN);
 		return;
 	}
 
-	if(link_quality > 8) return;
-	if(rx_status[0].rx_valid || rx_status[1].rx_valid) 
-		sprintf(buf,"%sVLQ%d.bmp",RESOURCE_PATH,link_quality+1); //VLQ7.bmp
+	if(osd_link.link_quality > 8) return;
+	if(osd_rx.rx[0].rx_valid || osd_rx.rx[1].rx_valid) 
+		icon_set(g_osd_hdzero.vlq, ICON_VLQ(osd_link.link_quality+1)); //VLQ7.bmp
 	else 	
-		sprintf(buf,"%sVLQ1.bmp",RESOURCE_PATH); //VLQ1.bmp
-
-    lv_img_set_src(g_osd_hdzero.vlq, buf);
+		icon_set(g_osd_hdzero.vlq, ICON_VLQ1);
 	lv_obj_clear_flag(g_osd_hdzero.vlq, LV_OBJ_FLAG_HIDDEN);
 }
 
@@ -326,6 +308,173 @@ void osd_channel_show(bool bShow)
 		lv_obj_add_flag(g_osd_hdzero.ch, LV_OBJ_FLAG_HIDDEN);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Glyph cache
+// Fonts are kept as palette indices; the glyphs on screen are expanded to
+// lv_color_t on first use and kept in a small LRU. Only touched from the
+// draw callback, so lvgl_mutex covers it.
+#define OSD_GLYPH_CACHE 64
+
+typedef struct {
+	uint16_t index;
+	uint32_t stamp;
+	lv_color_t px[OSD_HEIGHT * OSD_WIDTH];
+} osd_glyph_t;
+
+static osd_glyph_t glyph_cache[OSD_GLYPH_CACHE];
+static int16_t glyph_slot[OSD_GLYPH_NUM];
+static const osd_font_t *glyph_font;
+static uint32_t glyph_clock;
+
+static void osd_glyph_flush(const osd_font_t *font)
+{
+	glyph_font = font;
+	glyph_clock = 0;
+	memset(glyph_slot, 0xFF, sizeof(glyph_slot));
+	for(int i=0; i<OSD_GLYPH_CACHE; i++)
+	{
+		glyph_cache[i].index = OSD_GLYPH_NUM;
+		glyph_cache[i].stamp = 0;
+	}
+}
+
+static void osd_glyph_expand(const osd_font_t *font, uint16_t index, lv_color_t *px)
+{
+	const uint8_t *g = font->glyph + index * OSD_GLYPH_BYTES(font->bpp);
+	int i;
+
+	if(font->bpp == 8)
+	{
+		for(i=0; i<OSD_HEIGHT*OSD_WIDTH; i++)
+			px[i] = font->palette[g[i]];
+	}
+	else
+	{
+		for(i=0; i<OSD_HEIGHT*OSD_WIDTH; i+=2)
+		{
+			px[i] = font->palette[g[i>>1] >> 4];
+			px[i+1] = font->palette[g[i>>1] & 0x0F];
+		}
+	}
+}
+
+static const lv_color_t *osd_glyph_get(const osd_font_t *font, uint16_t index)
+{
+	osd_glyph_t *slot;
+	int i, lru;
+
+	if(font != glyph_font)
+		osd_glyph_flush(font);
+
+	if(glyph_slot[index] >= 0)
+	{
+		slot = &glyph_cache[glyph_slot[index]];
+		slot->stamp = ++glyph_clock;
+		return slot->px;
+	}
+
+	lru = 0;
+	for(i=1; i<OSD_GLYPH_CACHE; i++)
+	{
+		if(glyph_cache[i].stamp < glyph_cache[lru].stamp)
+			lru = i;
+	}
+
+	slot = &glyph_cache[lru];
+	if(slot->index < OSD_GLYPH_NUM)
+		glyph_slot[slot->index] = -1;
+	osd_glyph_expand(font, index, slot->px);
+	slot->index = index;
+	slot->stamp = ++glyph_clock;
+	glyph_slot[index] = lru;
+	return slot->px;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// OSD layer
+// One object draws the whole FC character grid. Changed cells are invalidated
+// as rectangles and the draw callback copies the glyph rows of every cell in
+// the refreshed area straight from the font into the draw buffer, instead of
+// going through one lv_img object per cell.
+static void osd_layer_draw_cb(lv_event_t *e)
+{
+	lv_obj_t *obj = lv_event_get_target(e);
+	lv_draw_ctx_t *draw_ctx = lv_event_get_draw_ctx(e);
+	lv_color_t *buf = draw_ctx->buf;
+	lv_coord_t stride = lv_area_get_width(draw_ctx->buf_area);
+	const osd_font_t *font = atomic_load(&osd_font_active);
+	lv_area_t coords, clip, cell, area;
+	int row, col, row0, row1, col0, col1;
+
+	if(!font) //still loading
+		return;
+
+	lv_obj_get_coords(obj, &coords);
+	if(!_lv_area_intersect(&clip, draw_ctx->clip_area, &coords))
+		return;
+
+	row0 = (clip.y1 - coords.y1) / OSD_HEIGHT;
+	row1 = (clip.y2 - coords.y1) / OSD_HEIGHT;
+	col0 = (clip.x1 - coords.x1) / OSD_WIDTH;
+	col1 = (clip.x2 - coords.x1) / OSD_WIDTH;
+
+	for(row=row0; row<=row1 && row<HD_VMAX; row++)
+	{
+		for(col=col0; col<=col1 && col<HD_HMAX; col++)
+		{
+			uint16_t index = osd_buf_shadow[row][col];
+			if(index >= OSD_GLYPH_NUM) //not drawn yet
+				continue;
+
+			cell.x1 = coords.x1 + col * OSD_WIDTH;
+			cell.y1 = coords.y1 + row * OSD_HEIGHT;
+			cell.x2 = cell.x1 + OSD_WIDTH - 1;
+			cell.y2 = cell.y1 + OSD_HEIGHT - 1;
+			if(!_lv_area_intersect(&area, &clip, &cell))
+				continue;
+
+			const lv_color_t *src = osd_glyph_get(font, index);
+			src += (area.y1 - cell.y1) * OSD_WIDTH + (area.x1 - cell.x1);
+			lv_color_t *dst = buf + (area.y1 - draw_ctx->buf_area->y1) * stride + (area.x1 - draw_ctx->buf_area->x1);
+			size_t len = lv_area_get_width(&area) * sizeof(lv_color_t);
+
+			for(lv_coord_t y=area.y1; y<=area.y2; y++)
+			{
+				memcpy(dst, src, len);
+				src += OSD_WIDTH;
+				dst += stride;
+			}
+		}
+	}
+}
+
+// lvgl_mutex must be held
+static void osd_layer_create(lv_obj_t *parent)
+{
+	// nothing is drawn in a cell until the compositor has set it
+	memset(osd_buf_shadow, 0xFF, sizeof(osd_buf_shadow));
+
+	osd_layer = lv_obj_create(parent);
+	lv_obj_remove_style_all(osd_layer);
+	lv_obj_clear_flag(osd_layer, LV_OBJ_FLAG_CLICKABLE | LV_OBJ_FLAG_SCROLLABLE);
+	lv_obj_set_size(osd_layer, HD_HMAX * OSD_WIDTH, HD_VMAX * OSD_HEIGHT);
+	lv_obj_set_pos(osd_layer, 4, 64);
+	lv_obj_add_event_cb(osd_layer, osd_layer_draw_cb, LV_EVENT_DRAW_MAIN, NULL);
+}
+
+// lvgl_mutex must be held
+static void osd_layer_invalidate(uint8_t row, uint8_t col0, uint8_t col1)
+{
+	lv_area_t area;
+
+	lv_obj_get_coords(osd_layer, &area);
+	area.x1 += col0 * OSD_WIDTH;
+	area.y1 += row * OSD_HEIGHT;
+	area.x2 = area.x1 + (col1 - col0 + 1) * OSD_WIDTH - 1;
+	area.y2 = area.y1 + OSD_HEIGHT - 1;
+	lv_obj_invalidate_area(osd_layer, &area);
+}
+
 static void create_osd_object(lv_obj_t **obj, const char *img, int index)
 {
 	int x = 0;
@@ -355,7 +504,7 @@ int osd_init(void)
 	char buf[128];
 
 	pthread_mutex_init(&dvr_mutex, NULL);
-	load_osd_file(OSD_FILE);
+	icon_init();
 
 	scr_main = lv_scr_act();
 	scr_osd = lv_obj_create(scr_main);
@@ -365,17 +514,10 @@ int osd_init(void)
 	lv_obj_set_size(scr_osd, 1280, 720);
 	lv_obj_add_flag(scr_osd, LV_OBJ_FLAG_HIDDEN);
 	lv_obj_add_style(scr_osd, &style_osd, 0);
-	for(int i=0; i<HD_VMAX; i++)
-	{
-		for(int j=0; j<HD_HMAX; j++)
-		{
-			pthread_mutex_lock(&lvgl_mutex);
-    		img_arr[i][j] = lv_img_create(scr_osd);
-    		lv_obj_set_size(img_arr[i][j], OSD_WIDTH, OSD_HEIGHT);
-    		lv_obj_set_pos(img_arr[i][j], j*OSD_WIDTH+4, i*OSD_HEIGHT+64);
-			pthread_mutex_unlock(&lvgl_mutex);
-		}
-	}
+
+	pthread_mutex_lock(&lvgl_mutex);
+	osd_layer_create(scr_osd);
+	pthread_mutex_unlock(&lvgl_mutex);
 
 	sprintf(buf,"%s%s",RESOURCE_PATH,fan1_bmp);
 	create_osd_object(&g_osd_hdzero.topfan_speed, buf, 0);  
@@ -434,6 +576,7 @@ int osd_init(void)
 		lv_obj_set_style_text_font(g_osd_hdzero.osd_tempe[2], &lv_font_montserrat_26, 0);
 	}
 
+	evloop_register(EV_TASK_OSD_HDZERO, "osd_hdzero", osd_hdzero_update, 100);
 	return 0;
 }
 
@@ -464,6 +607,12 @@ void osd_hdzero_update(void)
 {
 	char buf[128],i;
 	bool showRXOSD = g_showRXOSD && (g_source_info.source == 0);
+	static uint32_t rx_ver = UINT32_MAX;
+	uint32_t ver;
+
+	ver = tlm_read(TLM_RX, &osd_rx);
+	tlm_read(TLM_POWER, &osd_power);
+	tlm_read(TLM_LINK, &osd_link);
 	
 	osd_battery_show();
 	osd_rec_show(g_showRXOSD);
@@ -474,15 +623,14 @@ void osd_hdzero_update(void)
 
 	if(showRXOSD && g_osd_hdzero.vtx_temp)
 	{
-		if(vtxTempInfo & 0x80) {
-			i = vtxTempInfo&0xF;
+		if(osd_link.vtx_temp & 0x80) {
+			i = osd_link.vtx_temp&0xF;
 			if(i==0) i=1;
 			else if(i>8) i= 8;
-			sprintf(buf,"%sVtxTemp%d",RESOURCE_PATH,i);  //"VtxTemp1.bmp"
+			icon_set(g_osd_hdzero.vtx_temp, ICON_VTXTEMP(i));  //"VtxTemp1.bmp"
 		}
 		else
-			sprintf(buf,"%s%s",RESOURCE_PATH,blank_bmp);
-		lv_img_set_src(g_osd_hdzero.vtx_temp, buf);
+			icon_set(g_osd_hdzero.vtx_temp, ICON_BLANK);
 	}
 
 	if(showRXOSD)
@@ -494,14 +642,13 @@ void osd_hdzero_update(void)
 
 	osd_vlq_show(showRXOSD);
 
-	sprintf(buf, "%sant%d.bmp", RESOURCE_PATH,RSSI2Ant(rx_status[0].rx_rssi[0]));
-	lv_img_set_src(g_osd_hdzero.ant0, buf);
-	sprintf(buf, "%sant%d.bmp", RESOURCE_PATH,RSSI2Ant(rx_status[0].rx_rssi[1]));
-	lv_img_set_src(g_osd_hdzero.ant1, buf);
-	sprintf(buf, "%sant%d.bmp", RESOURCE_PATH,RSSI2Ant(rx_status[1].rx_rssi[0]));
-	lv_img_set_src(g_osd_hdzero.ant2, buf);
-	sprintf(buf, "%sant%d.bmp", RESOURCE_PATH,RSSI2Ant(rx_status[1].rx_rssi[1]));
-	lv_img_set_src(g_osd_hdzero.ant3, buf);
+	if(ver != rx_ver) {
+		rx_ver = ver;
+		icon_set(g_osd_hdzero.ant0, ICON_ANT(RSSI2Ant(osd_rx.rx[0].rx_rssi[0])));
+		icon_set(g_osd_hdzero.ant1, ICON_ANT(RSSI2Ant(osd_rx.rx[0].rx_rssi[1])));
+		icon_set(g_osd_hdzero.ant2, ICON_ANT(RSSI2Ant(osd_rx.rx[1].rx_rssi[0])));
+		icon_set(g_osd_hdzero.ant3, ICON_ANT(RSSI2Ant(osd_rx.rx[1].rx_rssi[1])));
+	}
 
 	if(showRXOSD) {
 		lv_obj_clear_flag(g_osd_hdzero.ant0, LV_OBJ_FLAG_HIDDEN);
@@ -517,13 +664,13 @@ void osd_hdzero_update(void)
 	}
 
 	if(g_test_en) {
-		sprintf(buf,"T:%d-%d",fan_speeds[2],  g_temperature.top/10);
+		sprintf(buf,"T:%d-%d",fan_speeds[2],  osd_power.temperature.top/10);
 		lv_label_set_text(g_osd_hdzero.osd_tempe[0], buf);
 
-		sprintf(buf,"L:%d-%d",fan_speeds[1], g_temperature.left/10);
+		sprintf(buf,"L:%d-%d",fan_speeds[1], osd_power.temperature.left/10);
 		lv_label_set_text(g_osd_hdzero.osd_tempe[1], buf);
 
-		sprintf(buf,"R:%d-%d",fan_speeds[0], g_temperature.right/10);
+		sprintf(buf,"R:%d-%d",fan_speeds[0], osd_power.temperature.right/10);
 		lv_label_set_text(g_osd_hdzero.osd_tempe[2], buf);
 	}
 }
@@ -534,39 +681,71 @@ int draw_osd_clear(void)
 	return 0;
 }
 
+// lvgl_mutex must be held
 int draw_osd_on_screen(uint8_t row, uint8_t col)
 {
-	pthread_mutex_lock(&lvgl_mutex);
-	int index = osd_buf_shadow[row][col];
-   	lv_img_set_src(img_arr[row][col], &osd_font.data[index]);
-	pthread_mutex_unlock(&lvgl_mutex);
-
+	osd_layer_invalidate(row, col, col);
 	return 0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// load_osd_file
-int load_osd_file(const char *file)
+// osd_font_load
+static uint8_t osd_font_color(osd_font_t *font, lv_color_t c)
+{
+	int i, best = 0, d, dmin = 0x7FFFFFFF;
+
+	for(i=0; i<font->colors; i++)
+	{
+		if(font->palette[i].full == c.full)
+			return i;
+	}
+
+	if(font->colors < 256)
+	{
+		font->palette[font->colors] = c;
+		return font->colors++;
+	}
+
+	//more than 256 colours, use the closest one
+	for(i=0; i<256; i++)
+	{
+		d = abs(font->palette[i].ch.red - c.ch.red) + abs(font->palette[i].ch.green - c.ch.green) +
+			abs(font->palette[i].ch.blue - c.ch.blue);
+		if(d < dmin) {
+			dmin = d;
+			best = i;
+		}
+	}
+	return best;
+}
+
+static int osd_font_load(osd_font_t *font, const char *file)
 {
 	char *buf;
 	struct stat stFile;
 	int fd,size,rd;
 	int boundry_width;
 	int line_size;
+	uint8_t *idx, last = 0;
+	lv_color_t c, last_c;
 
-	Printf("load_osd_file ...\n");
 	fd = open(file, O_RDONLY);
 	if(fd < 0) return -1;
 	
 	fstat(fd, &stFile);
 	size = stFile.st_size;
 	buf = (char *)malloc(size);
-	if(!buf) return -2;
+	if(!buf) {
+		close(fd);
+		return -2;
+	}
 		
 	rd = read(fd, buf, size);
-	if(rd != size) return -3;
-
 	close(fd);
+	if(rd != size || size < sizeof(bmpFileHead)) {
+		free(buf);
+		return -3;
+	}
 
 	bmpFileHead *bmp = (bmpFileHead *)buf;
 	char *pb = buf + sizeof(bmpFileHead) + bmp->info.biClrUsed;
@@ -584,12 +763,26 @@ int load_osd_file(const char *file)
 		line_size = LINE_LENGTH_1;
 	}
 
-    // read OSD font
+	//last pixel of the last glyph must be inside the file
+	if(pb + (OSD_VNUM + 1) * boundry_width * line_size + OSD_VNUM * OSD_HEIGHT * line_size > buf + size) {
+		free(buf);
+		return -3;
+	}
+
+	idx = (uint8_t *)malloc(OSD_GLYPH_NUM * OSD_GLYPH_BYTES(8));
+	if(!idx) {
+		free(buf);
+		return -2;
+	}
+
+    // read OSD font, one palette index per pixel
     uint8_t h, v;
     uint8_t x, y;
     uint32_t addr;
-    uint8_t offset;
-    
+    uint8_t *g;
+
+	font->colors = 0;
+	last_c.full = 0;
     for (v = 0; v < OSD_VNUM; v++)
     {
         for (h = 0; h < OSD_HNUM; h++)
@@ -600,55 +793,205 @@ int load_osd_file(const char *file)
             addr += v * OSD_HEIGHT * line_size;
 			addr += h*OSD_WIDTH*3;
 
+			g = idx + ((OSD_VNUM - v - 1) * OSD_HNUM + h) * OSD_GLYPH_BYTES(8);
             for (y = 0; y < OSD_HEIGHT; y++)
             {
                 for (x = 0; x < OSD_WIDTH; x++)
                 {
-                    osdFont[OSD_VNUM - v - 1][h][OSD_HEIGHT - y - 1][x] = (0xff<<24) + ((pb[addr + x * 3] & 0xff) ) + ((pb[addr + x * 3 + 1] & 0xff) << 8) + ((pb[addr + x * 3 + 2] & 0xff)<<16);
+					c = lv_color_make(pb[addr + x * 3 + 2], pb[addr + x * 3 + 1], pb[addr + x * 3]);
+					if(!font->colors || c.full != last_c.full) {
+						last = osd_font_color(font, c);
+						last_c = c;
+					}
+                    g[(OSD_HEIGHT - y - 1) * OSD_WIDTH + x] = last;
                 }
                 addr += line_size;
             }
         }
     }
-    for (v = 0; v < OSD_VNUM; v++)
-    {
-        for (h = 0; h < OSD_HNUM; h++)
-        {
-			int index = v*OSD_HNUM + h;
-			osd_font.data[index].header.cf= LV_IMG_CF_TRUE_COLOR;
-			osd_font.data[index].header.always_zero = 0;
-			osd_font.data[index].header.reserved = 0;
-			osd_font.data[index].header.w = 24;
-			osd_font.data[index].header.h = 36;
-			osd_font.data[index].data_size = 24 * 36 * LV_COLOR_SIZE / 8;
-			osd_font.data[index].data = (uint8_t *)&osdFont[v][h][0][0];  
-		}
+	free(buf);
+
+	if(font->colors <= 16)
+	{
+		//pack two pixels per byte
+		for(int i=0; i<OSD_GLYPH_NUM * OSD_GLYPH_BYTES(4); i++)
+			idx[i] = (idx[2*i] << 4) | idx[2*i+1];
+		font->bpp = 4;
+		g = (uint8_t *)realloc(idx, OSD_GLYPH_NUM * OSD_GLYPH_BYTES(4));
+		font->glyph = g ? g : idx;
 	}
-	//free(buf); //FIX ME, ntant, it seems system becomes unstable if uncomment this ???
+	else
+	{
+		font->bpp = 8;
+		font->glyph = idx;
+	}
+	Printf("osd font %s: %d colors, %d bpp\n", file, font->colors, font->bpp);
 	return 0;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// OSD font sets
+// One font per FC variant, loaded by thread_osd_font so the render path
+// never waits on a BMP decode. A font on the SD card overrides the built-in
+// one; only the Betaflight font ships, so a variant without a user font
+// shares it. Loaded fonts are never freed or reloaded, so the draw callback
+// can keep using the old pointer until the compositor picks up the swap.
+typedef enum {
+	FONT_NONE = 0,
+	FONT_READY,			//user font
+	FONT_BUILTIN,		//built-in font, a user font may still turn up on the card
+	FONT_FAILED,
+} font_state_e;
+
+static const char *font_name[FC_END] = {"BTFL", "INAV", "ARDU"};
+static font_state_e font_state[FC_END];
+static const osd_font_t *font_loaded[FC_END];
+static bool font_builtin_loaded;
+static atomic_int font_want = BTFL;
+static pthread_mutex_t font_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t font_cond = PTHREAD_COND_INITIALIZER;
+
+// font_mutex must be held
+static void osd_font_publish(int variant)
+{
+	if(atomic_load(&osd_font_active) == font_loaded[variant])
+		return;
+
+	Printf("osd font: %s%s\n", font_name[variant], font_state[variant] == FONT_BUILTIN ? " (built-in)" : "");
+	atomic_store(&osd_font_active, font_loaded[variant]);
+	atomic_store(&osd_font_swapped, true);
+	osd_mark_dirty(OSD_ALL_ROWS);
+}
+
+// Called by the displayport parser with the variant the FC reports.
+void osd_font_select(uint8_t variant)
+{
+	if(variant >= FC_END || variant == atomic_load(&font_want))
+		return;
+
+	pthread_mutex_lock(&font_mutex);
+	atomic_store(&font_want, variant);
+	if(font_loaded[variant])
+		osd_font_publish(variant);
+	if(font_state[variant] == FONT_NONE)
+		pthread_cond_signal(&font_cond);
+	pthread_mutex_unlock(&font_mutex);
+}
+
+// Called by the SD card monitor on insertion: variants showing the built-in
+// font, or none, look for a user font on the card again.
+void osd_font_sdcard(void)
+{
+	pthread_mutex_lock(&font_mutex);
+	for(int v=0; v<FC_END; v++) {
+		if(font_state[v] == FONT_BUILTIN || font_state[v] == FONT_FAILED)
+			font_state[v] = FONT_NONE;
+	}
+	pthread_cond_signal(&font_cond);
+	pthread_mutex_unlock(&font_mutex);
+}
+
+// Runs without font_mutex; only thread_osd_font writes the fonts.
+static font_state_e osd_font_load_variant(int variant, const osd_font_t **font)
+{
+	char path[128];
+	int ret;
+
+	sprintf(path, OSD_FILE_SD, font_name[variant]);
+	if(osd_font_load(&osd_fonts[variant], path) == 0) {
+		*font = &osd_fonts[variant];
+		return FONT_READY;
+	}
+
+	if(!font_builtin_loaded) {
+		ret = osd_font_load(&osd_font_builtin, OSD_FILE);
+		if(ret) {
+			Printf("osd font: %s load failed (%d)\n", OSD_FILE, ret);
+			return FONT_FAILED;
+		}
+		font_builtin_loaded = true;
+	}
+	*font = &osd_font_builtin;
+	return FONT_BUILTIN;
+}
+
+// Loads the wanted font first, then preloads the rest while idle.
+void *thread_osd_font(void *ptr)
+{
+	const osd_font_t *font = NULL;
+	font_state_e state;
+	int v;
+
+	for(;;)
+	{
+		pthread_mutex_lock(&font_mutex);
+		for(;;)
+		{
+			v = atomic_load(&font_want);
+			if(font_state[v] == FONT_NONE)
+				break;
+			for(v=0; v<FC_END && font_state[v] != FONT_NONE; v++);
+			if(v < FC_END)
+				break;
+			pthread_cond_wait(&font_cond, &font_mutex);
+		}
+		pthread_mutex_unlock(&font_mutex);
+
+		state = osd_font_load_variant(v, &font);
+
+		pthread_mutex_lock(&font_mutex);
+		font_state[v] = state;
+		if(state != FONT_FAILED) {
+			font_loaded[v] = font;
+			if(v == atomic_load(&font_want) || !atomic_load(&osd_font_active))
+				osd_font_publish(v);
+		}
+		pthread_mutex_unlock(&font_mutex);
+	}
+	return NULL;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Threads for updating FC OSD
+// Sleeps until the displayport parser commits a refresh, then invalidates
+// the changed span of each changed row under one lvgl_mutex lock.
 void *thread_osd(void *ptr)
 {
+	static uint16_t grid[HD_VMAX][SD_HMAX_EXT];
+	uint32_t rows;
+	int first, last;
 
 	for(;;)
 	{
+		rows = osd_wait_dirty();
+		thread_loop_begin();
+		osd_front_read(grid, rows);
 
+		pthread_mutex_lock(&lvgl_mutex);
+		if(atomic_exchange(&osd_font_swapped, false))
+			lv_obj_invalidate(osd_layer);
 		for(int i=0; i<HD_VMAX; i++)
 		{
+			if(!(rows & (1 << i)))
+				continue;
+
+			first = last = -1;
 			for(int j=0; j<HD_HMAX; j++)
 			{
-				if(osd_buf[i][j] != osd_buf_shadow[i][j]) 
+				if(grid[i][j] != osd_buf_shadow[i][j]) 
 				{
-					osd_buf_shadow[i][j] =osd_buf[i][j];
-					draw_osd_on_screen(i, j);
+					osd_buf_shadow[i][j] = grid[i][j];
+					if(first < 0)
+						first = j;
+					last = j;
 				}
 			}
-
+			if(first >= 0)
+				osd_layer_invalidate(i, first, last);
 		}
-	//	usleep(2000); 
+		pthread_mutex_unlock(&lvgl_mutex);
+		evloop_notify(EV_TASK_LVGL);
+		thread_loop_end();
 	}
 return NULL;
 }
@@ -62,8 +62,16 @@ typedef struct
 }__attribute__((packed)) bmpFileHead;
 
 
+#define OSD_GLYPH_NUM (OSD_VNUM * OSD_HNUM)
+#define OSD_GLYPH_BYTES(bpp) (OSD_WIDTH * OSD_HEIGHT * (bpp) / 8)
+
+// Glyphs are stored as palette indices, 4 bits per pixel when the font has
+// no more than 16 colours and 8 bits per pixel otherwise.
 typedef struct {
-	lv_img_dsc_t data[512];
+	uint8_t bpp;
+	uint16_t colors;
+	lv_color_t palette[256];
+	uint8_t *glyph;			//OSD_GLYPH_NUM * OSD_GLYPH_BYTES(bpp)
 } osd_font_t;
 
 
@@ -78,10 +86,12 @@ void osd_rec_update(bool enable);
 void osd_show(bool show);
 char* channel2str(uint8_t channel);
 
-int load_osd_file(const char *file);
+void osd_font_select(uint8_t variant);
+void osd_font_sdcard(void);
 void rbtn_click(bool is_short, int mode);
 
 void *thread_osd(void *ptr);
+void *thread_osd_font(void *ptr);
 
 void sel_audio_source(uint8_t audio_source);
 void enable_line_out(bool bEnable);
@@ -0,0 +1,173 @@
+#include "reactor.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include "common.hh"
+#include "thread.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// I/O reactor
+// Every fd is level-triggered in one epoll set. The eventfd carries
+// reactor_call() commands from other threads, which run between fd handlers.
+#define REACTOR_FDS		8
+#define REACTOR_EVENTS	8
+#define REACTOR_CMDS	16
+
+typedef struct {
+	int fd;
+	reactor_fn_t fn;
+	void *arg;
+} reactor_src_t;
+
+typedef struct {
+	reactor_cmd_t fn;
+	void *arg;
+} reactor_msg_t;
+
+static int epfd = -1;
+static int cmd_fd = -1;
+static reactor_src_t srcs[REACTOR_FDS];
+static int src_num;
+static reactor_src_t cmd_src;
+
+static reactor_msg_t cmds[REACTOR_CMDS];
+static uint8_t cmd_rptr, cmd_wptr;
+static pthread_mutex_t cmd_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_t reactor_tid;
+static volatile int reactor_running;
+
+static int reactor_watch(reactor_src_t *src)
+{
+	struct epoll_event event;
+
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.ptr = src;
+	return epoll_ctl(epfd, EPOLL_CTL_ADD, src->fd, &event);
+}
+
+static void reactor_run_cmds(int fd, void *arg)
+{
+	reactor_msg_t msg;
+	uint64_t cnt;
+
+	read(fd, &cnt, sizeof(cnt));
+	for(;;)
+	{
+		pthread_mutex_lock(&cmd_mutex);
+		if(cmd_rptr == cmd_wptr) {
+			pthread_mutex_unlock(&cmd_mutex);
+			break;
+		}
+		msg = cmds[cmd_rptr];
+		cmd_rptr = (cmd_rptr + 1) % REACTOR_CMDS;
+		pthread_mutex_unlock(&cmd_mutex);
+
+		msg.fn(msg.arg);
+	}
+}
+
+int reactor_init(void)
+{
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	cmd_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if(epfd < 0 || cmd_fd < 0) {
+		perror("reactor_init");
+		return -1;
+	}
+
+	cmd_src.fd = cmd_fd;
+	cmd_src.fn = reactor_run_cmds;
+	return reactor_watch(&cmd_src);
+}
+
+// Must be called before thread_reactor starts. fd is switched to non-blocking.
+int reactor_add(int fd, reactor_fn_t fn, void *arg)
+{
+	reactor_src_t *src;
+
+	if(fd < 0 || src_num == REACTOR_FDS)
+		return -1;
+
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+	src = &srcs[src_num++];
+	src->fd = fd;
+	src->fn = fn;
+	src->arg = arg;
+	if(reactor_watch(src) < 0) {
+		perror("reactor_add");
+		src_num--;
+		return -1;
+	}
+	return 0;
+}
+
+// Runs fn(arg) on the reactor thread. Safe from any thread.
+int reactor_call(reactor_cmd_t fn, void *arg)
+{
+	uint64_t one = 1;
+	uint8_t next;
+
+	pthread_mutex_lock(&cmd_mutex);
+	next = (cmd_wptr + 1) % REACTOR_CMDS;
+	if(next == cmd_rptr) {
+		pthread_mutex_unlock(&cmd_mutex);
+		Printf("reactor: command queue full\n");
+		return -1;
+	}
+	cmds[cmd_wptr].fn = fn;
+	cmds[cmd_wptr].arg = arg;
+	cmd_wptr = next;
+	pthread_mutex_unlock(&cmd_mutex);
+
+	write(cmd_fd, &one, sizeof(one));
+	return 0;
+}
+
+// True when called from a handler; blocking here would stall every fd.
+int reactor_is_self(void)
+{
+	return reactor_running && pthread_equal(pthread_self(), reactor_tid);
+}
+
+void *thread_reactor(void *ptr)
+{
+	struct epoll_event events[REACTOR_EVENTS];
+	reactor_src_t *src;
+	int n;
+
+	reactor_tid = pthread_self();
+	reactor_running = 1;
+
+	for(;;)
+	{
+		n = epoll_wait(epfd, events, REACTOR_EVENTS, -1);
+		if(n < 0) {
+			if(errno != EINTR)
+				perror("reactor epoll_wait");
+			continue;
+		}
+
+		thread_loop_begin();
+		for(int i=0; i<n; i++)
+		{
+			src = events[i].data.ptr;
+			if(events[i].events & EPOLLIN)
+				src->fn(src->fd, src->arg);
+			else if(events[i].events & (EPOLLERR | EPOLLHUP)) {
+				Printf("reactor: fd %d closed\n", src->fd);
+				epoll_ctl(epfd, EPOLL_CTL_DEL, src->fd, NULL);
+			}
+		}
+		thread_loop_end();
+	}
+	return NULL;
+}
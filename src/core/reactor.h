@@ -0,0 +1,15 @@
+#ifndef _REACTOR_H
+#define _REACTOR_H
+
+// One thread multiplexing the DM5680 UARTs and the input devices.
+// Handlers run on the reactor thread and must drain their fd without blocking.
+typedef void (*reactor_fn_t)(int fd, void *arg);
+typedef void (*reactor_cmd_t)(void *arg);
+
+int  reactor_init(void);
+int  reactor_add(int fd, reactor_fn_t fn, void *arg);
+int  reactor_call(reactor_cmd_t fn, void *arg);
+int  reactor_is_self(void);
+void *thread_reactor(void *ptr);
+
+#endif
@@ -0,0 +1,190 @@
+#include "recorder.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "common.hh"
+#include "../player/gogglemsg.h"
+#include "../minIni/minIni.h"
+#include "../page/page_common.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Recorder control
+// Commands go straight onto the goggle message queue, the one gogglecmd
+// writes to, instead of forking gogglecmd. A recorder that answers
+// REC_cmdSTATUS on MTYPE_RECORD_ACK gets its parameters in REC_cmdSTARTP
+// and acknowledges start and stop. An older one is driven through
+// record.conf, MSG_cmdSTART and REC_STATUS_FILE as before, but polled rather
+// than waited out with fixed sleeps.
+#define REC_STATUS_FILE		"/tmp/record.dat"
+#define REC_PROBE_MS		50
+#define REC_LEGACY_MS		2000	//encoder and file set up
+#define REC_ACK_MS			REC_LEGACY_MS
+#define REC_STOP_MS			200
+
+typedef enum {
+	REC_PROTO_UNKNOWN,
+	REC_PROTO_ACK,
+	REC_PROTO_LEGACY,
+} rec_proto_e;
+
+static rec_proto_e rec_proto = REC_PROTO_UNKNOWN;
+
+static uint32_t rec_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int rec_init(void)
+{
+	if(gogglemsg_init(0))
+		return -1;
+	return gogglemsg_listen(MTYPE_RECORD_ACK);
+}
+
+// Acks left over from a command that timed out
+static void rec_drain(void)
+{
+	GoggleMsg_t msg;
+
+	while(gogglemsg_wait(MTYPE_RECORD_ACK, &msg, 0) > 0)
+		;
+}
+
+// Waits for the ack of cmd; false on timeout
+static bool rec_wait_ack(long cmd, RecordMsgAck_t *ack, uint32_t timeout_ms)
+{
+	uint32_t start = rec_ms(), elapsed;
+	GoggleMsg_t msg;
+	int ret;
+
+	while((elapsed = rec_ms() - start) < timeout_ms)
+	{
+		ret = gogglemsg_wait(MTYPE_RECORD_ACK, &msg, timeout_ms - elapsed);
+		if(ret == cmd) {
+			*ack = msg.u.rec_ack;
+			return true;
+		}
+		if(ret < 0)
+			return false;
+	}
+	return false;
+}
+
+static rec_proto_e rec_probe(void)
+{
+	RecordMsgAck_t ack;
+
+	if(rec_proto != REC_PROTO_UNKNOWN)
+		return rec_proto;
+
+	rec_drain();
+	gogglemsg_send(MTYPE_RECORD, (GoggleMsgCommand_e)REC_cmdSTATUS);
+	if(rec_wait_ack(REC_cmdSTATUS, &ack, REC_PROBE_MS))
+		rec_proto = REC_PROTO_ACK;
+	else
+		rec_proto = REC_PROTO_LEGACY;
+	Printf("recorder: %s\n", rec_proto == REC_PROTO_ACK ? "acked" : "legacy");
+	return rec_proto;
+}
+
+// REC_STATUS_FILE holds "1" while recording
+static bool rec_status_file(void)
+{
+	char buf[8] = {0};
+	FILE *fp = fopen(REC_STATUS_FILE, "r");
+
+	if(!fp)
+		return false;
+	fread(buf, 1, sizeof(buf) - 1, fp);
+	fclose(fp);
+	return strcmp(buf, "1") == 0;
+}
+
+static bool rec_wait_file(bool recording, uint32_t timeout_ms)
+{
+	uint32_t start = rec_ms();
+
+	while(rec_status_file() != recording) {
+		if(rec_ms() - start >= timeout_ms)
+			return false;
+		usleep(20000);
+	}
+	return true;
+}
+
+static void rec_write_conf(const RecordMsgParam_t *param)
+{
+	ini_puts("record", "type", param->format_ts ? "ts" : "mp4", REC_CONF);
+	ini_putl("venc", "fps",  param->venc_fps, REC_CONF);
+	ini_putl("venc", "kbps", param->kbps,     REC_CONF);
+	ini_putl("venc", "h265", param->h265,     REC_CONF);
+	ini_putl("vi",   "fps",  param->vi_fps,   REC_CONF);
+	ini_putl("record", "audio", param->audio, REC_CONF);
+}
+
+bool rec_start(const RecordMsgParam_t *param)
+{
+	RecordMsgAck_t ack;
+	GoggleMsg_t msg;
+	uint32_t start = rec_ms();
+	bool ok;
+
+	if(rec_probe() == REC_PROTO_ACK) {
+		rec_drain();
+		msg.mtype = MTYPE_RECORD;
+		msg.cmd = REC_cmdSTARTP;
+		msg.u.rec_param = *param;
+		gogglemsg_sendMsg(&msg, sizeof(msg.u.rec_param));
+		if(rec_wait_ack(REC_cmdSTARTP, &ack, REC_ACK_MS)) {
+			ok = ack.state == REC_stRECORDING;
+			if(!ok)
+				Printf("rec_start failed: %d\n", (int)ack.error);
+		}
+		else {
+			// a slow start may still be under way, the recorder answers
+			// REC_cmdSTATUS once it's done with it
+			Printf("rec_start: no ack, asking for status\n");
+			gogglemsg_send(MTYPE_RECORD, (GoggleMsgCommand_e)REC_cmdSTATUS);
+			if(rec_wait_ack(REC_cmdSTATUS, &ack, REC_ACK_MS))
+				ok = ack.state == REC_stRECORDING;
+			else {
+				Printf("rec_start: no status\n");
+				rec_proto = REC_PROTO_UNKNOWN;	//probe again next time
+				ok = false;
+			}
+		}
+	}
+	else {
+		rec_write_conf(param);
+		unlink(REC_STATUS_FILE);
+		gogglemsg_send(MTYPE_RECORD, MSG_cmdSTART);
+		ok = rec_wait_file(true, REC_LEGACY_MS);
+		if(!ok)
+			Printf("rec_start failed: no %s\n", REC_STATUS_FILE);
+	}
+
+	Printf("rec_start: %d in %dms\n", ok, rec_ms() - start);
+	return ok;
+}
+
+void rec_stop(void)
+{
+	RecordMsgAck_t ack;
+
+	if(rec_probe() == REC_PROTO_ACK) {
+		rec_drain();
+		gogglemsg_send(MTYPE_RECORD, MSG_cmdSTOP);
+		if(!rec_wait_ack(MSG_cmdSTOP, &ack, REC_ACK_MS)) {
+			Printf("rec_stop: no ack\n");
+			rec_proto = REC_PROTO_UNKNOWN;
+		}
+	}
+	else {
+		gogglemsg_send(MTYPE_RECORD, MSG_cmdSTOP);
+		rec_wait_file(false, REC_STOP_MS);	//the file is closed by then
+	}
+}
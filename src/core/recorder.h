@@ -0,0 +1,11 @@
+#ifndef _RECORDER_H
+#define _RECORDER_H
+
+#include <stdbool.h>
+#include "../player/appmsg.h"
+
+int  rec_init(void);
+bool rec_start(const RecordMsgParam_t *param);
+void rec_stop(void);
+
+#endif
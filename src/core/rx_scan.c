@@ -0,0 +1,204 @@
+#include "rx_scan.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "common.hh"
+#include "../driver/dm5680.h"
+#include "../driver/dm6302.h"
+#include "../minIni/minIni.h"
+#include "../page/page_common.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Channel scan
+// The two receivers are tuned apart and each works through the channel list
+// on its own: when one side has qualified its channel it retunes to the next
+// while the other is still settling. A channel is done as soon as its
+// DM5680 reports a valid link, when the gain stays under the floor, or after
+// SCAN_DWELL_MS, the settle time the scan used to wait out on every channel.
+#define SCAN_DWELL_MS		100
+#define SCAN_LOCK_MS		30	//valid flags earlier than this may still be the old channel's
+#define SCAN_STEP_MS		15
+#define SCAN_GAIN_FLOOR		5	//nothing on air below this
+#define SCAN_FLOOR_READS	3
+
+typedef struct {
+	int      ch;		//-1 = idle
+	uint32_t start;
+	uint8_t  gain;
+	uint8_t  low;		//consecutive readings under the floor
+	bool     polled;
+	dm5680_req_t vld;
+} scan_side_t;
+
+static rx_scan_result_t scan_cache[FREQ_NUM];
+
+static uint32_t scan_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// side 0: right DM6302 feeding DM5680 UART1, side 1: left / UART2
+static void scan_tune(int side, scan_side_t *sd, uint8_t ch)
+{
+	DM6302_SetChannelRF(side + 1, ch);
+	sd->ch = ch;
+	sd->start = scan_ms();
+	sd->gain = 0;
+	sd->low = 0;
+}
+
+static void scan_finish(scan_side_t *sd, bool valid, rx_scan_cb_t cb, void *arg)
+{
+	rx_scan_result_t *res = &scan_cache[sd->ch];
+
+	res->valid = valid;
+	res->gain  = sd->gain;
+	res->stamp = scan_ms();
+	Printf("Scan channel%d: valid:%d, gain:%d\n", sd->ch, valid, sd->gain);
+	if(cb)
+		cb(sd->ch, res, arg);
+	sd->ch = -1;
+}
+
+static void scan_save(void)
+{
+	static long saved = -1;
+	long mask = rx_scan_valid_mask();
+
+	if(saved < 0)
+		saved = ini_getl("scan", "valid_mask", 0, SETTING_INI);
+	if(mask != saved) {
+		ini_putl("scan", "valid_mask", mask, SETTING_INI);
+		saved = mask;
+	}
+}
+
+// Scans the channels in list; returns the number found valid
+int rx_scan_run(const uint8_t *list, int num, rx_scan_cb_t cb, void *arg)
+{
+	scan_side_t side[2];
+	uint8_t g[4];
+	uint32_t elapsed;
+	int next = 0, done = 0, found = 0, best = -1;
+	bool waited;
+
+	for(int s=0; s<2; s++)
+		side[s].ch = -1;
+
+	DM5680_clear_vldflg();
+	while(done < num)
+	{
+		for(int s=0; s<2; s++)
+			if(side[s].ch < 0 && next < num)
+				scan_tune(s, &side[s], list[next++]);
+
+		// ask for the flags first, the gain readout covers the round trip
+		waited = false;
+		for(int s=0; s<2; s++) {
+			side[s].polled = side[s].ch >= 0 && scan_ms() - side[s].start >= SCAN_LOCK_MS;
+			if(side[s].polled)
+				DM5680_request(&side[s].vld, s, 0x11, NULL, 0, SCAN_STEP_MS);
+		}
+
+		DM6302_get_gain(g);
+		side[0].gain = g[0] > g[2] ? g[0] : g[2];
+		side[1].gain = g[1] > g[3] ? g[1] : g[3];
+
+		for(int s=0; s<2; s++)
+		{
+			scan_side_t *sd = &side[s];
+			bool valid = false;
+
+			if(sd->ch < 0)
+				continue;
+
+			if(sd->polled) {
+				valid = DM5680_req_wait(&sd->vld) == DM5680_REQ_DONE && sd->vld.data[0];
+				waited = true;
+			}
+			elapsed = scan_ms() - sd->start;
+
+			if(sd->gain < SCAN_GAIN_FLOOR)
+				sd->low++;
+			else
+				sd->low = 0;
+
+			if(valid) {
+				if(best < 0 || sd->ch < best)
+					best = sd->ch;
+				found++;
+				done++;
+				scan_finish(sd, true, cb, arg);
+			}
+			else if(elapsed >= SCAN_DWELL_MS ||
+					(elapsed >= SCAN_LOCK_MS && sd->low >= SCAN_FLOOR_READS)) {
+				done++;
+				scan_finish(sd, false, cb, arg);
+			}
+		}
+
+		if(!waited && done < num)
+			usleep(SCAN_STEP_MS * 1000);
+	}
+
+	// both receivers back on one channel for diversity
+	if(best < 0)
+		best = g_setting.scan.channel - 1;
+	if(best >= 0 && best < FREQ_NUM)
+		DM6302_SetChannel(best);
+
+	scan_save();
+	return found;
+}
+
+int rx_scan_full(rx_scan_cb_t cb, void *arg)
+{
+	uint8_t list[FREQ_NUM];
+
+	for(int i=0; i<FREQ_NUM; i++)
+		list[i] = i;
+	return rx_scan_run(list, FREQ_NUM, cb, arg);
+}
+
+// Rescans only the channels in mask, e.g. rx_scan_valid_mask()
+int rx_scan_quick(uint16_t mask, rx_scan_cb_t cb, void *arg)
+{
+	uint8_t list[FREQ_NUM];
+	int num = 0;
+
+	for(int i=0; i<FREQ_NUM; i++)
+		if(mask & (1 << i))
+			list[num++] = i;
+	return num ? rx_scan_run(list, num, cb, arg) : 0;
+}
+
+const rx_scan_result_t *rx_scan_result(uint8_t ch)
+{
+	return ch < FREQ_NUM ? &scan_cache[ch] : NULL;
+}
+
+uint16_t rx_scan_valid_mask(void)
+{
+	uint16_t mask = 0;
+
+	for(int i=0; i<FREQ_NUM; i++)
+		if(scan_cache[i].valid)
+			mask |= 1 << i;
+	return mask;
+}
+
+// Channels found valid before the last power off. Returned once, for the
+// first scan after boot; 0 afterwards.
+uint16_t rx_scan_boot_mask(void)
+{
+	static bool taken = false;
+
+	if(taken)
+		return 0;
+	taken = true;
+	return ini_getl("scan", "valid_mask", 0, SETTING_INI) & ((1 << FREQ_NUM) - 1);
+}
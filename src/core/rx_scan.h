@@ -0,0 +1,24 @@
+#ifndef _RX_SCAN_H
+#define _RX_SCAN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+	bool     valid;
+	uint8_t  gain;		//0-60, strongest antenna
+	uint32_t stamp;		//ms, CLOCK_MONOTONIC; 0 = never scanned
+} rx_scan_result_t;
+
+// Called once per channel as soon as it is qualified; channels finish out of order
+typedef void (*rx_scan_cb_t)(uint8_t ch, const rx_scan_result_t *res, void *arg);
+
+int  rx_scan_run(const uint8_t *list, int num, rx_scan_cb_t cb, void *arg);
+int  rx_scan_full(rx_scan_cb_t cb, void *arg);
+int  rx_scan_quick(uint16_t mask, rx_scan_cb_t cb, void *arg);
+
+const rx_scan_result_t *rx_scan_result(uint8_t ch);
+uint16_t rx_scan_valid_mask(void);
+uint16_t rx_scan_boot_mask(void);
+
+#endif
@@ -0,0 +1,158 @@
+#include "sdcard.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/vfs.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include "common.hh"
+#include "evloop.h"
+#include "osd.h"
+#include "telemetry.h"
+#include "thread.h"
+#include "../page/page_common.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// SD card monitor
+// The kernel flags /proc/self/mountinfo with POLLPRI whenever the mount
+// table changes, so the card is looked for only then. Free space is read
+// on every such change, as formatsd.sh's umount/mkfs/mount may come as one
+// wakeup with the card still mounted, on sdcard_refresh() and, while
+// recording, every SDCARD_REC_MS. Without mountinfo the mount table is checked every
+// SDCARD_FALLBACK_MS instead.
+#define SDCARD_MOUNT		"/mnt/extsd"
+#define SDCARD_REC_MS		5000
+#define SDCARD_FALLBACK_MS	1000
+
+static int sd_efd = -1;		//refresh requests
+static int sd_tfd = -1;		//free space while recording
+static bool sd_present;
+static int  sd_free_mb;
+
+int sdcard_init(void)
+{
+	sd_efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	sd_tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+	return sd_efd < 0 || sd_tfd < 0 ? -1 : 0;
+}
+
+// Re-reads the free space, e.g. after files were deleted
+void sdcard_refresh(void)
+{
+	uint64_t one = 1;
+
+	if(sd_efd >= 0)
+		write(sd_efd, &one, sizeof(one));
+}
+
+void sdcard_recording(bool on)
+{
+	struct itimerspec its;
+
+	if(sd_tfd < 0)
+		return;
+	memset(&its, 0, sizeof(its));
+	if(on) {
+		its.it_value.tv_sec = SDCARD_REC_MS / 1000;
+		its.it_interval.tv_sec = SDCARD_REC_MS / 1000;
+	}
+	timerfd_settime(sd_tfd, 0, &its, NULL);
+}
+
+static bool sdcard_mounted(void)
+{
+	char line[512], mnt[256];
+	bool found = false;
+	FILE *fp = fopen("/proc/self/mountinfo", "r");
+
+	if(!fp)
+		return false;
+	// id parent major:minor root mount-point ...
+	while(!found && fgets(line, sizeof(line), fp))
+		found = sscanf(line, "%*s %*s %*s %*s %255s", mnt) == 1 && !strcmp(mnt, SDCARD_MOUNT);
+	fclose(fp);
+	return found;
+}
+
+static void sdcard_publish(void)
+{
+	tlm_sdcard_t sd;
+
+	memset(&sd, 0, sizeof(sd));
+	sd.present = sd_present;
+	sd.free_mb = sd_free_mb;
+	tlm_publish(TLM_SDCARD, &sd);
+	evloop_notify(EV_TASK_STATUSBAR);
+}
+
+static void sdcard_update_free(void)
+{
+	struct statfs info;
+	int size = 0;
+
+	if(sd_present && statfs(SDCARD_MOUNT, &info) != -1)
+		size = ((uint64_t)info.f_bsize * info.f_bavail) >> 20; //in MB
+	if(size != sd_free_mb) {
+		sd_free_mb = size;
+		sdcard_publish();
+	}
+}
+
+static void sdcard_update_mount(void)
+{
+	bool mounted = sdcard_mounted();
+
+	if(mounted == sd_present)
+		return;
+
+	Printf("SD card %s\n", mounted ? "inserted" : "removed");
+	sd_present = mounted;
+	sdcard_publish();
+	if(mounted)
+		osd_font_sdcard();
+}
+
+void *thread_sdcard(void *ptr)
+{
+	struct pollfd pfd[3];
+	uint64_t cnt;
+	int mfd, ret;
+
+	mfd = open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+	pfd[0].fd = mfd;
+	pfd[0].events = POLLPRI;
+	pfd[1].fd = sd_efd;
+	pfd[1].events = POLLIN;
+	pfd[2].fd = sd_tfd;
+	pfd[2].events = POLLIN;
+
+	sdcard_update_mount();
+	sdcard_update_free();
+	sdcard_publish();
+
+	for(;;)
+	{
+		ret = poll(pfd, 3, mfd < 0 ? SDCARD_FALLBACK_MS : -1);
+		if(ret < 0)
+			continue;
+
+		thread_loop_begin();
+		if(mfd < 0 || (pfd[0].revents & (POLLPRI | POLLERR))) {
+			sdcard_update_mount();
+			sdcard_update_free();
+		}
+		if(pfd[1].revents & POLLIN) {
+			read(sd_efd, &cnt, sizeof(cnt));
+			sdcard_update_free();
+		}
+		if(pfd[2].revents & POLLIN) {
+			read(sd_tfd, &cnt, sizeof(cnt));
+			sdcard_update_free();
+		}
+		thread_loop_end();
+	}
+	return NULL;
+}
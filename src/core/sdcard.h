@@ -0,0 +1,13 @@
+#ifndef _SDCARD_H
+#define _SDCARD_H
+
+#include <stdbool.h>
+
+// SD card monitor. Publishes TLM_SDCARD on insertion, removal and free
+// space changes; other threads read the card state from that snapshot.
+int   sdcard_init(void);
+void  sdcard_refresh(void);
+void  sdcard_recording(bool on);
+void *thread_sdcard(void *ptr);
+
+#endif
@@ -7,6 +7,9 @@
 #include "mcp3021.h"
 #include "osd.h"
 #include "common.hh"
+#include "icons.h"
+#include "evloop.h"
+#include "telemetry.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 //local
@@ -141,29 +144,38 @@ int statusbar_init(void)
 	lv_obj_set_style_text_font(label3, &lv_font_montserrat_26, 0);
 	lv_obj_set_style_text_font(label4, &lv_font_montserrat_26, 0);
 
+	evloop_register(EV_TASK_STATUSBAR, "statusbar", statubar_update, 100);
 	return 0;
 }
 
 void  statubar_update(void)
 {
 	char buf[128];
-	memset(buf, 0, sizeof(buf));
-	sprintf(buf, "%dS %d.%dV", g_battery.type,
-			 g_battery.voltage/1000,
-			 g_battery.voltage%1000/100);
-
-    lv_label_set_text(label4, buf);
+	static uint32_t power_ver = UINT32_MAX;
+	tlm_power_t power;
+	tlm_sdcard_t sd;
+	uint32_t ver;
+
+	ver = tlm_read(TLM_POWER, &power);
+	if(ver != power_ver) {
+		power_ver = ver;
+		memset(buf, 0, sizeof(buf));
+		sprintf(buf, "%dS %d.%dV", power.battery.type,
+				 power.battery.voltage/1000,
+				 power.battery.voltage%1000/100);
+		lv_label_set_text(label4, buf);
+	}
 
 	{	
-		#define BEEP_INTERVAL 20
+		#define BEEP_INTERVAL 4 //x100ms
 		static uint8_t beep_gap = 0;
-		int vol = g_battery.voltage/g_battery.type;
+		int vol = power.battery.voltage/power.battery.type;
 		bool low = (vol  <  g_setting.power.voltage * 100);
 
 		if(low)
-			lv_img_set_src(img_battery, &img_lowBattery);
+			img_set_src_changed(img_battery, &img_lowBattery);
 		else
-			lv_img_set_src(img_battery, &img_bat);
+			img_set_src_changed(img_battery, &img_bat);
 
 		switch(g_setting.power.warning_type) {
 			case 0: //beep only:
@@ -225,11 +237,12 @@ void  statubar_update(void)
 
 
 
-	if(g_sdcard_enable){
+	tlm_read(TLM_SDCARD, &sd);
+	if(sd.present){
 		int cnt = get_videofile_cnt();
-		float gb = g_sdcard_size/1024.0;
+		float gb = sd.free_mb/1024.0;
 		bool bFull = (gb < 0.1);
-		lv_img_set_src(img_sdc, &img_sdcard);
+		img_set_src_changed(img_sdc, &img_sdcard);
 		if(cnt != 0) {
 			if(bFull) 
 				sprintf(buf, "%d clip(s), SD Card Full", cnt);
@@ -245,7 +258,7 @@ void  statubar_update(void)
 	}
 	else {
 		sprintf(buf, "No SD card");
-		lv_img_set_src(img_sdc, &img_noSdcard);
+		img_set_src_changed(img_sdc, &img_noSdcard);
 	}
 
 	lv_label_set_text(label0, buf);
@@ -0,0 +1,70 @@
+#include "telemetry.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// Seqlock snapshot store
+// seq is odd while a record is being written. A reader copies the record and
+// retries if seq moved, so it never sees a torn copy. The version is seq/2
+// and only moves when the record content changes, so producers should clear
+// padding (memset) before filling a record.
+typedef struct {
+	atomic_uint seq;
+	pthread_mutex_t lock;	//serialises producers only
+	uint32_t size;
+	void *data;
+} tlm_slot_t;
+
+static tlm_rx_t    tlm_rx;
+static tlm_power_t tlm_power = {.battery = {.type = 2}}; //device_init default
+static tlm_link_t  tlm_link = {.cam_mode = VR_720P60}; //CAM_MODE default
+static tlm_sdcard_t tlm_sdcard;
+
+static tlm_slot_t slots[TLM_NUM] = {
+	[TLM_RX]    = {0, PTHREAD_MUTEX_INITIALIZER, sizeof(tlm_rx_t),    &tlm_rx},
+	[TLM_POWER] = {0, PTHREAD_MUTEX_INITIALIZER, sizeof(tlm_power_t), &tlm_power},
+	[TLM_LINK]  = {0, PTHREAD_MUTEX_INITIALIZER, sizeof(tlm_link_t),  &tlm_link},
+	[TLM_SDCARD] = {0, PTHREAD_MUTEX_INITIALIZER, sizeof(tlm_sdcard_t), &tlm_sdcard},
+};
+
+void tlm_publish(tlm_topic_t topic, const void *rec)
+{
+	tlm_slot_t *slot = &slots[topic];
+	unsigned seq;
+
+	pthread_mutex_lock(&slot->lock);
+	if(memcmp(slot->data, rec, slot->size)) {
+		seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+		atomic_store_explicit(&slot->seq, seq + 1, memory_order_relaxed);
+		atomic_thread_fence(memory_order_release);
+		memcpy(slot->data, rec, slot->size);
+		atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+	}
+	pthread_mutex_unlock(&slot->lock);
+}
+
+// Copies the latest record into rec and returns its version
+uint32_t tlm_read(tlm_topic_t topic, void *rec)
+{
+	tlm_slot_t *slot = &slots[topic];
+	unsigned seq;
+
+	for(;;)
+	{
+		seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+		if(seq & 1)
+			continue;
+		memcpy(rec, slot->data, slot->size);
+		atomic_thread_fence(memory_order_acquire);
+		if(atomic_load_explicit(&slot->seq, memory_order_relaxed) == seq)
+			return seq >> 1;
+	}
+}
+
+uint32_t tlm_version(tlm_topic_t topic)
+{
+	return atomic_load_explicit(&slots[topic].seq, memory_order_acquire) >> 1;
+}
@@ -0,0 +1,44 @@
+#ifndef _TELEMETRY_H
+#define _TELEMETRY_H
+
+#include <stdint.h>
+#include "msp_displayport.h"
+#include "../driver/dm5680.h"
+#include "../driver/mcp3021.h"
+#include "../driver/nct75.h"
+
+// Versioned telemetry records. Producers keep writing their own globals and
+// publish a copy; consumers read a consistent snapshot without locking.
+typedef enum {
+	TLM_RX,			//tlm_rx_t, DM5680 UART threads
+	TLM_POWER,		//tlm_power_t, thread_peripheral
+	TLM_LINK,		//tlm_link_t, MSP displayport parser
+	TLM_SDCARD,		//tlm_sdcard_t, SD card monitor
+	TLM_NUM
+} tlm_topic_t;
+
+typedef struct {
+	rx_status_t rx[2];
+} tlm_rx_t;
+
+typedef struct {
+	sys_battery_t battery;
+	sys_temperature_t temperature;
+} tlm_power_t;
+
+typedef struct {
+	video_resolution_t cam_mode;
+	uint8_t link_quality;
+	uint8_t vtx_temp;
+} tlm_link_t;
+
+typedef struct {
+	uint8_t present;
+	int     free_mb;
+} tlm_sdcard_t;
+
+void tlm_publish(tlm_topic_t topic, const void *rec);
+uint32_t tlm_read(tlm_topic_t topic, void *rec);
+uint32_t tlm_version(tlm_topic_t topic);
+
+#endif
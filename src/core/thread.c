@@ -1,9 +1,13 @@
+#define _GNU_SOURCE
 #include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <time.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
-#include <sys/vfs.h>
 
 #include "defines.h"
 #include "thread.h"
@@ -11,12 +15,17 @@
 #include "input_device.h"
 #include "ht.h"
 #include "common.hh"
+#include "evloop.h"
+#include "telemetry.h"
+#include "reactor.h"
+#include "sdcard.h"
 #include "../driver/porting.h"
 #include "../driver/mcp3021.h"
 #include "../driver/nct75.h"
 #include "../driver/hardware.h"
 #include "../driver/oled.h"
 #include "../driver/dm5680.h"
+#include "../driver/uart.h"
 #include "../driver/it66021.h"
 #include "../driver/it66021.h"
 #include "../page/page_fans.h"
@@ -24,39 +33,17 @@
 #include "msp_displayport.h"
 
 
-///////////////////////////////////////////////////////////////////////////////
-// SD card exist
-static void detect_sdcard(void)
-{
-	char   buf[128]; 
-	FILE   *stream;  
-	static bool sdcard_enable_last = false;
-
-    memset( buf, '\0', sizeof(buf) );
-    stream = popen( "ls /mnt/extsd/" , "r" );
-	fread( buf, sizeof(char), sizeof(buf),  stream);  
-	pclose( stream ); 
-
-	g_sdcard_enable = strcmp(buf, "") == 0 ? false : true;
-
-	if((g_sdcard_enable && !sdcard_enable_last) || g_sdcard_det_req) {
-		struct statfs info;
-		if(statfs( "/mnt/extsd", &info ) != -1) 
-			g_sdcard_size = (info.f_bsize * info.f_bavail)>>20; //in MB
-		else
-			g_sdcard_size = 0;
-		g_sdcard_det_req = 0;
-	}
-	sdcard_enable_last = g_sdcard_enable;
-}
+static atomic_bool thread_stats_req;	//SIGUSR1
 
 static void *thread_imu(void *ptr)
 {
 	int cnt = 0;
 	for(;;)
 	{
+		thread_loop_begin();
 		get_imu_data(true);
 		calc_ht();
+		thread_loop_end();
 		if(cnt++ == 9) {
 			cnt = 0;
 			seconds++;
@@ -66,15 +53,6 @@ static void *thread_imu(void *ptr)
 	return NULL;
 }
 
-static void *thread_dialpad(void *ptr)
-{
-	for(;;)
-	{
-		input_device_loop();
-	}
-	return NULL;
-}
-
 
 ///////////////////////////////////////////////////////////////////////////////
 // Signal loss|accquire processing
@@ -84,6 +62,8 @@ static void check_hdzero_signal(int vtmg_change)  //fix me. ntant, Need to consi
 {
 	static uint8_t cnt = 0;
 	uint8_t is_valid;
+	tlm_rx_t rx;
+	tlm_sdcard_t sd;
 
 	//HDZero digital 
 	if(g_source_info.source == 0) {
@@ -92,7 +72,8 @@ static void check_hdzero_signal(int vtmg_change)  //fix me. ntant, Need to consi
 		tune_channel_timer();
 	}
 
-	if(g_setting.record.mode_manual || !g_sdcard_enable || (g_menu_op != OPLEVEL_VIDEO)) return;
+	tlm_read(TLM_SDCARD, &sd);
+	if(g_setting.record.mode_manual || !sd.present || (g_menu_op != OPLEVEL_VIDEO)) return;
 
 	//exit if HDMI in
 	if(g_source_info.source == 1) return; 
@@ -107,7 +88,8 @@ static void check_hdzero_signal(int vtmg_change)  //fix me. ntant, Need to consi
 		return; 
 	}
 
-	is_valid = rx_status[0].rx_valid || rx_status[1].rx_valid;
+	tlm_read(TLM_RX, &rx);
+	is_valid = rx.rx[0].rx_valid || rx.rx[1].rx_valid;
 
 	if(vtmg_change) {
 		Printf("VTMG change\n");
@@ -141,6 +123,16 @@ static void check_hdzero_signal(int vtmg_change)  //fix me. ntant, Need to consi
 	}
 }
 
+static void power_publish(void)
+{
+	tlm_power_t power;
+
+	memset(&power, 0, sizeof(power));
+	power.battery = g_battery;
+	power.temperature = g_temperature;
+	tlm_publish(TLM_POWER, &power);
+}
+
 static void *thread_peripheral(void *ptr)
 {
 	int record_vtmg_change = 0;
@@ -151,9 +143,9 @@ static void *thread_peripheral(void *ptr)
 		if(j>50)
 		{
 			j=0;
+			thread_loop_begin();
 			
 			fans_auto_ctrl();
-			detect_sdcard();
 			if(k++ == 4) {
 				k = 0;
 				g_battery.voltage = mcp_read_vatage();
@@ -161,6 +153,7 @@ static void *thread_peripheral(void *ptr)
 				g_temperature.left = nct_read_temperature(NCT_LEFT);
 				g_temperature.right= nct_read_temperature(NCT_RIGHT);
 			}
+			power_publish();
             // detect HDZERO
 			record_vtmg_change = HDZERO_detect();
 
@@ -176,6 +169,13 @@ static void *thread_peripheral(void *ptr)
 			g_latency_locked = (bool)Get_VideoLatancy_status();
 			check_hdzero_signal(record_vtmg_change);
 			record_vtmg_change = 0;
+			evloop_notify(EV_TASK_SOURCE);
+			thread_loop_end();
+
+			if(atomic_exchange(&thread_stats_req, false)) {
+				thread_stats_dump();
+				uart_stats_dump();
+			}
 		}
 		j++;
 		usleep(2000); 
@@ -186,34 +186,206 @@ static void *thread_peripheral(void *ptr)
 
 
 //////////////////////////////////////////////////////////////////////
-//local
-static threads_obj_t threads_obj;
+// Thread registry
+// Every thread is started through thread_spawn(), which names it, applies
+// its scheduling class and core, and keeps a slot for the stats dump.
+typedef struct {
+	const char *name;
+	fun_thread_instance_t instance;
+	void *arg;
+	int priority;
+	int cpu;
+	pthread_t pid;
+	atomic_uint wakeups;
+	atomic_uint lat_max;	//us
+	atomic_uint lat_sum;	//us
+	uint32_t wakeups_dumped;
+	uint64_t loop_start;
+} thread_slot_t;
+
+static thread_slot_t thread_slots[THREAD_COUNT_MAX];
+static atomic_int thread_slot_num;
+static __thread thread_slot_t *thread_self;
 
-static void threads_instance(threads_obj_t *obj)
+static const thread_desc_t threads_desc[] = {
+	{"reactor",    thread_reactor,    THREAD_PRIO_IO,     THREAD_CPU_RT},
+	{"peripheral", thread_peripheral, THREAD_PRIO_NORMAL, THREAD_CPU_ANY},
+	{"version",    thread_version,    THREAD_PRIO_NORMAL, THREAD_CPU_ANY},
+	{"osd",        thread_osd,        THREAD_PRIO_NORMAL, THREAD_CPU_ANY},
+	{"imu",        thread_imu,        THREAD_PRIO_IMU,    THREAD_CPU_RT},
+	{"osd_font",   thread_osd_font,   THREAD_PRIO_NORMAL, THREAD_CPU_ANY},
+	{"sdcard",     thread_sdcard,     THREAD_PRIO_NORMAL, THREAD_CPU_ANY},
+	{"input",      thread_input,      THREAD_PRIO_NORMAL, THREAD_CPU_ANY},
+};
+
+static uint64_t thread_now_us(void)
 {
-	obj->instance[0] =  thread_dialpad;
-	obj->instance[1] =  thread_peripheral;
-	obj->instance[2] =  thread_version;
-	obj->instance[3] =  thread_osd;
-	obj->instance[4] =  thread_imu;
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
 }
 
-int create_threads()
+static void thread_apply(thread_slot_t *slot)
+{
+	struct sched_param param;
+	cpu_set_t cpus;
+	int ret;
+
+	pthread_setname_np(slot->pid, slot->name);
+
+	//children of a real-time thread (system(), popen()) start at SCHED_OTHER;
+	//they still inherit its core, so no real-time thread should fork
+	if(slot->priority != THREAD_PRIO_NORMAL) {
+		param.sched_priority = slot->priority;
+		ret = pthread_setschedparam(slot->pid, SCHED_FIFO | SCHED_RESET_ON_FORK, &param);
+		if(ret)
+			Printf("thread %s: SCHED_FIFO %d failed (%d)\n", slot->name, slot->priority, ret);
+	}
+
+	if(slot->cpu != THREAD_CPU_ANY && slot->cpu < sysconf(_SC_NPROCESSORS_ONLN)) {
+		CPU_ZERO(&cpus);
+		CPU_SET(slot->cpu, &cpus);
+		ret = pthread_setaffinity_np(slot->pid, sizeof(cpus), &cpus);
+		if(ret)
+			Printf("thread %s: pin to cpu%d failed (%d)\n", slot->name, slot->cpu, ret);
+	}
+}
+
+static thread_slot_t *thread_slot_alloc(void)
+{
+	int n = atomic_fetch_add(&thread_slot_num, 1);
+
+	if(n >= THREAD_COUNT_MAX) {
+		atomic_fetch_sub(&thread_slot_num, 1);
+		return NULL;
+	}
+	return &thread_slots[n];
+}
+
+static void *thread_entry(void *ptr)
+{
+	thread_slot_t *slot = ptr;
+
+	thread_self = slot;
+	slot->pid = pthread_self();
+	thread_apply(slot);
+	return slot->instance(slot->arg);
+}
+
+int thread_spawn(const thread_desc_t *desc, void *arg, pthread_t *pid)
+{
+	thread_slot_t *slot = thread_slot_alloc();
+	pthread_t tid;
+	int ret;
+
+	if(!slot) {
+		Printf("thread %s: registry full\n", desc->name);
+		return pthread_create(pid ? pid : &tid, NULL, desc->instance, arg);
+	}
+
+	slot->name = desc->name;
+	slot->instance = desc->instance;
+	slot->arg = arg;
+	slot->priority = desc->priority;
+	slot->cpu = desc->cpu;
+
+	ret = pthread_create(&slot->pid, NULL, thread_entry, slot);
+	if(ret == 0 && pid)
+		*pid = slot->pid;
+	return ret;
+}
+
+// Adds an already running thread, e.g. main, to the stats dump
+void thread_register_self(const char *name)
+{
+	thread_slot_t *slot = thread_slot_alloc();
+
+	if(!slot)
+		return;
+
+	slot->name = name;
+	slot->priority = THREAD_PRIO_NORMAL;
+	slot->cpu = THREAD_CPU_ANY;
+	slot->pid = pthread_self();
+	thread_self = slot;
+	pthread_setname_np(slot->pid, name);
+}
+
+void thread_loop_begin(void)
+{
+	if(!thread_self)
+		return;
+	thread_self->loop_start = thread_now_us();
+	atomic_fetch_add_explicit(&thread_self->wakeups, 1, memory_order_relaxed);
+}
+
+void thread_loop_end(void)
+{
+	thread_slot_t *slot = thread_self;
+	uint32_t lat;
+
+	if(!slot || !slot->loop_start)
+		return;
+
+	lat = thread_now_us() - slot->loop_start;
+	atomic_fetch_add_explicit(&slot->lat_sum, lat, memory_order_relaxed);
+	if(lat > atomic_load_explicit(&slot->lat_max, memory_order_relaxed))
+		atomic_store_explicit(&slot->lat_max, lat, memory_order_relaxed);
+}
+
+// One line per thread: cpu time, loop wakeups and loop latency (avg/max).
+// Wakeups and latency are counted since the previous dump.
+void thread_stats_dump(void)
 {
-	int ret = 0;
+	int n = atomic_load(&thread_slot_num);
+	struct timespec ts;
+	clockid_t clk;
+	uint32_t wakeups, lat_sum, lat_max;
+	int cpu_ms;
+	char line[96];
 
-    threads_obj_t *obj = &threads_obj; 
-	threads_instance(obj);
-	for(int i=0; i<THREAD_COUNT; i++)
+	Printf("thread           prio cpu  cpu_ms  wakeups  avg_us  max_us\n");
+	for(int i=0; i<n; i++)
 	{
-		ret = pthread_create(&obj->pid[i],
-			   	NULL,
-				obj->instance[i],
-				NULL);
+		thread_slot_t *slot = &thread_slots[i];
+
+		if(!slot->name)
+			continue;
+
+		cpu_ms = -1;
+		if(pthread_getcpuclockid(slot->pid, &clk) == 0 && clock_gettime(clk, &ts) == 0)
+			cpu_ms = ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+
+		wakeups = atomic_load(&slot->wakeups);
+		lat_sum = atomic_exchange(&slot->lat_sum, 0);
+		lat_max = atomic_exchange(&slot->lat_max, 0);
+		wakeups -= slot->wakeups_dumped;
+		slot->wakeups_dumped += wakeups;
+
+		snprintf(line, sizeof(line), "%-16s %4d %3d %7d %8u %7u %7u", slot->name,
+				slot->priority, slot->cpu, cpu_ms, wakeups,
+				wakeups ? lat_sum / wakeups : 0, lat_max);
+		Printf("%s\n", line);
+	}
+}
 
+static void thread_stats_signal(int sig)
+{
+	atomic_store(&thread_stats_req, true);
+}
+
+int create_threads()
+{
+	int ret;
+
+	signal(SIGUSR1, thread_stats_signal);
+
+	for(int i=0; i<sizeof(threads_desc)/sizeof(threads_desc[0]); i++)
+	{
+		ret = thread_spawn(&threads_desc[i], NULL, NULL);
 		if(ret != 0)
 			goto thread_create_err;
-		
 	}
 	return 0;
 
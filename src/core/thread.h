@@ -2,16 +2,34 @@
 #define _THREAD_H
 
 #include <stdint.h>
+#include <pthread.h>
 
-#define THREAD_COUNT_MAX (10)
-#define THREAD_COUNT (5)
+#define THREAD_COUNT_MAX (16)
+
+// SCHED_FIFO threads must not take lvgl_mutex or run UI code
+#define THREAD_PRIO_NORMAL	0	//SCHED_OTHER
+#define THREAD_PRIO_IO		30	//SCHED_FIFO, reactor: DM5680 UARTs and input devices
+#define THREAD_PRIO_IMU		20	//SCHED_FIFO, head tracker
+
+#define THREAD_CPU_ANY	(-1)
+#define THREAD_CPU_RT	1		//real-time threads stay off the recorder's core
 
 typedef void *(*fun_thread_instance_t)(void *params);
 
 typedef struct {
-	pthread_t pid[THREAD_COUNT_MAX]; 
-	fun_thread_instance_t instance[THREAD_COUNT_MAX];
-} threads_obj_t;
+	const char *name;		//at most 15 characters
+	fun_thread_instance_t instance;
+	int priority;
+	int cpu;
+} thread_desc_t;
 
 int create_threads();
+int thread_spawn(const thread_desc_t *desc, void *arg, pthread_t *pid);
+void thread_register_self(const char *name);
+
+// Loop accounting, called by the registered thread itself
+void thread_loop_begin(void);
+void thread_loop_end(void);
+void thread_stats_dump(void);
+
 #endif
@@ -1,7 +1,11 @@
 #include "dm5680.h"
 #include "uart.h"
+#include "ringbuf.h"
 
 #include <pthread.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/timerfd.h>
 #include <stdio.h>
 #include <stdbool.h>
 #include <assert.h>
@@ -26,6 +30,10 @@
 #include "page_common.h"
 #include "msp_displayport.h"
 #include "../core/osd.h"
+#include "../core/evloop.h"
+#include "../core/telemetry.h"
+#include "../core/reactor.h"
+#include "../core/input_queue.h"
 
 
 /////////////////////////////////////////////////////////////////////
@@ -33,253 +41,593 @@
 rx_status_t     rx_status[2]; //global, 0=UART1 from Right DM5680, 1=UART2 from Left DM5680, 
 
 //local
-uint8_t         uart_buffer[2][256];
-uint8_t         uart_rptr[2],uart_wptr[2];
 int             fd_dm5680l =0, fd_dm5680r =0;
-pthread_mutex_t cmd_to5680_mutex;
 
-uint8_t uart_parse_core(uint8_t* buff, uint8_t* rptr,uint8_t* wptr,uint8_t* state, uint8_t* len,uint8_t* payload,uint8_t* payload_ptr)
+static void rx_status_publish(void)
 {
-	uint8_t pkt_cnt = 0;
-	while(*rptr != *wptr) {
-		switch(*state) {
-			case 0: //
-				if(buff[*rptr] == 0xCC) 
-					*state = 1;
-				break;
+	tlm_publish(TLM_RX, rx_status);
+}
 
-			case 1:
-				if(buff[*rptr] == 0x33)
-					*state = 2;
-				else	
-					*state = 0;
-				break;
+///////////////////////////////////////////////////////////////////////////////
+// Receive path
+// Each UART reads straight into its ring. Frames are CC 33 <len> <cmd> <data>,
+// len counting cmd and data; handlers get a view starting at len, so
+// pkt[0]=len, pkt[1]=cmd and pkt[2..len] the data.
+#define DM5680_RING_SIZE	1024
+#define DM5680_PKT_MAX		256		//len byte + up to 255
+
+// Both links run at the DM5680 firmware's rate; the reactor reads them
+// non-blocking, so VMIN/VTIME stay 0.
+#define DM5680_UART_CFG		{115200, 8, 'N', 1, 0, 0, true}
+
+typedef struct {
+	ringbuf_t ring;
+	uint8_t mem[RINGBUF_MEM(DM5680_RING_SIZE, DM5680_PKT_MAX)];
+	int fd;				//frame and error counters live in the uart stats
+	uint8_t link;		//dm5680_link[] sending on the same UART
+} dm5680_rx_t;
+
+static dm5680_rx_t dm5680_rx_ctx[2];
+
+// Shortest len each command's handler reads up to
+static uint8_t dm5680_min_len(uint8_t cmd)
+{
+	switch(cmd) {
+		case 0x01: return 2;
+		case 0x11: return 2;
+		case 0x12: return 6;
+		case 0x14: return 5;
+		case 0x15: return 1;
+		case 0x19: return 2;
+		case 0x20: return 2;
+		default:   return 0xFF;
+	}
+}
 
-			case 2:
-				*len = buff[*rptr];
-				payload[*payload_ptr]= *len;
-				(*payload_ptr)++;
-				*state = 3;
-				break;
+static void dm5680_resp(uint8_t sel, uint8_t *pkt);
 
-			case 3:
-				payload[*payload_ptr]= buff[*rptr];
-				(*payload_ptr)++;
+static void dm5680_dispatch(uint8_t sel, uint8_t *ptr)
+{
+	//Printf("UART%d:Cmd=%x,len=%x,Value=%x\n",sel+1,ptr[1],ptr[0],ptr[2]);
+	switch(ptr[1]) {
+		case 0x01: //Ver
+			DM5680_get_ver(sel,ptr);
+			break;
+
+		case 0x11: // Valid_channel
+			DM5680_get_vldflg(sel, ptr);
+			break;
+
+		case 0x12: // rssi0 rssi1 DLQ Stat crc
+			DM5680_get_rssi(sel,ptr);
+			break;
+
+		case 0x14: // vtx_type vtx_ver vtx_stat crc
+			DM5680_get_vtxinfo(sel,ptr);
+			break;
+
+		case 0x15:// osd_data....... crc
+			if(!sel) //Update OSD from UART1 only sel: 1=from left, 0= from right
+				DM5680_OSD_parse(&ptr[2], ptr[0]-1);
+			break;
+				
+		case 0x20:// right_btn
+			if(sel) {
+				Printf("btn:%x\n", ptr[2]);	//0=short,1=long
+				input_queue_put(RIGHT_KEY_CLICK+(ptr[2]&1));
+			}
+			break;
 
-				(*len)--;
-				if(*len ==0){
-					*state = 0;
-					pkt_cnt++;
-				}
-				break;
-		}
-		(*rptr)++; 
+		case 0x19: //Read DM5680 reg
+			DM5680_get_regval(sel,ptr);
+			break;
 	}
-	return pkt_cnt;
+
+	if(ptr[1] != 0x15 && ptr[1] != 0x20) //unsolicited
+		dm5680_resp(dm5680_rx_ctx[sel].link, ptr);
 }
 
-void uart_parse(uint8_t sel,uint8_t* state, uint8_t* len, uint8_t* payload,uint8_t* payload_ptr)
+// Dispatches every complete frame in the ring. Garbage between frames is
+// skipped a whole span at a time with memchr; a partial frame stays queued.
+static void dm5680_parse(uint8_t sel)
 {
-	uint8_t* uart_buf = sel? uart_buffer[1] : uart_buffer[0];
-	uint8_t* uart_buf_rptr = sel? &uart_rptr[1] : &uart_rptr[0];
-	uint8_t* uart_buf_wptr = sel? &uart_wptr[1] : &uart_wptr[0];
+	dm5680_rx_t *rx = &dm5680_rx_ctx[sel];
+	ringbuf_t *rb = &rx->ring;
+	uint8_t *p, *hdr, *pkt;
+	uint32_t span, len;
 
-	uint8_t* ptr;
-	uint8_t  i,pkt_cnt;
+	for(;;)
+	{
+		span = ringbuf_read_span(rb, &p);
+		if(span == 0)
+			break;
+
+		hdr = memchr(p, 0xCC, span);
+		if(!hdr) {
+			ringbuf_consume(rb, span);
+			continue;
+		}
+		if(hdr != p) {
+			ringbuf_consume(rb, hdr - p);
+			continue;
+		}
 
-	pkt_cnt = uart_parse_core(uart_buf,uart_buf_rptr,uart_buf_wptr, state,len,payload,payload_ptr);
-	ptr = payload;
-	while(pkt_cnt--) {
-		//Printf("UART%d:Cmd=%x,len=%x,Value=%x\n",sel+1,ptr[1],ptr[0],ptr[2]);
-		switch(ptr[1]) {
-			case 0x01: //Ver
-				DM5680_get_ver(sel,ptr);
-				break;
+		if(ringbuf_count(rb) < 3)
+			break;
+		if(ringbuf_at(rb, 1) != 0x33) {
+			ringbuf_consume(rb, 1);
+			continue;
+		}
 
-			case 0x11: // Valid_channel
-				DM5680_get_vldflg(sel, ptr);
-				break;
+		len = ringbuf_at(rb, 2);
+		if(ringbuf_count(rb) < 3 + len)
+			break;
 
-			case 0x12: // rssi0 rssi1 DLQ Stat crc
-				DM5680_get_rssi(sel,ptr);
-				break;
+		pkt = ringbuf_view(rb, 2, len + 1);
+		if(len == 0 || len < dm5680_min_len(pkt[1])) {
+			uart_count_frame(rx->fd, false);
+			Printf("UART%d bad command\n",sel+1);
+		}
+		else {
+			uart_count_frame(rx->fd, true);
+			dm5680_dispatch(sel, pkt);
+		}
+		ringbuf_consume(rb, 3 + len);
+	}
+}
 
-			case 0x14: // vtx_type vtx_ver vtx_stat crc
-				DM5680_get_vtxinfo(sel,ptr);
-				break;
+// Raw UART1 bytes are copied to DM5680_CAPTURE when that file exists at
+// boot, for replaying the OSD stream on a host (tools/osd_replay.c).
+static FILE *dm5680_capture = NULL;
 
-			case 0x15:// osd_data....... crc
-				if(!sel) //Update OSD from UART1 only sel: 1=from left, 0= from right
-					DM5680_OSD_parse(&ptr[2], ptr[0]-1);
-				break;
-					
-			case 0x20:// right_btn
-				if(sel) {
-					g_key = RIGHT_KEY_CLICK+(ptr[2]&1);
-					Printf("btn:%x\n", ptr[2]);	//0=short,1=long
-					if((g_source_info.source != 1) && (g_menu_op == OPLEVEL_VIDEO)) //no record feature for HDMI in or non-Video mode
-						rbtn_click(!ptr[2], 0);
-				}
-				break;
+static void dm5680_capture_open(void)
+{
+	if(access(DM5680_CAPTURE, F_OK))
+		return;
+	dm5680_capture = fopen(DM5680_CAPTURE, "wb");
+	if(dm5680_capture)
+		Printf("DM5680 capture to %s\n", DM5680_CAPTURE);
+}
 
-			case 0x19: //Read DM5680 reg
-				DM5680_get_regval(sel,ptr);
-				break;
+// Reactor handler, arg = sel. Reads into the ring until the UART runs dry.
+static void dm5680_rx(int fd, void *arg)
+{
+	int      sel = (intptr_t)arg;
+	ringbuf_t *rb = &dm5680_rx_ctx[sel].ring;
+	uint8_t  *p, scratch[64];
+	uint32_t span;
+	int      len;
 
-			default:
-				Printf("UART%d bad command\n",sel+1);
+	for(;;)
+	{
+		span = ringbuf_write_span(rb, &p);
+		if(span == 0) {
+			//ring full of a partial frame, drop input so the fd drains
+			len = uart_read(fd, scratch, sizeof(scratch));
+			if(len <= 0)
 				break;
+			if(rb->overflow == 0)
+				Printf("UART%d fifo full!\n", sel+1);
+			rb->overflow += len;
+			continue;
 		}
-		(*payload_ptr) -= (ptr[0]+1);
-		ptr += (ptr[0]+1);
+
+		len = uart_read(fd, p, span);
+		if(len <= 0)
+			break;
+		if(dm5680_capture && sel == 0)
+			fwrite(p, 1, len, dm5680_capture);
+		ringbuf_commit(rb, len);
+		dm5680_parse(sel);
 	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Transmit path
+// Callers append whole frames to the link's queue. Whoever finds the link
+// idle becomes the writer and flushes everything queued, including frames
+// other threads add meanwhile, with one write() per batch outside the lock.
+// Each link counts the sends of every command still owed a reply; status
+// polls are dropped while one is owed, and a reply later than
+// DM5680_POLL_MS is presumed lost.
+#define DM5680_TX_SIZE		256
+#define DM5680_POLL_MS		200
+#define DM5680_PENDING_MAX	8
+
+typedef struct {
+	pthread_mutex_t lock;
+	pthread_cond_t  cond;		//queue drained or a request completed
+	uint8_t  buf[DM5680_TX_SIZE];
+	uint16_t len;
+	bool     busy;				//a writer is flushing
+	uint8_t  inflight[256];		//sends owed a reply, per command
+	uint32_t inflight_until[256];	//ms
+	dm5680_req_t *pending[DM5680_PENDING_MAX];	//in send order
+	uint8_t  pending_num;
+	uint32_t coalesced;
+	uint32_t timeouts;
+} dm5680_link_t;
+
+static dm5680_link_t dm5680_link[2];
+static int dm5680_req_tfd = -1;
+static pthread_mutex_t dm5680_req_tmutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t dm5680_ms(void)
+{
+	struct timespec ts;
 
-	for(i=0;i<(*payload_ptr);i++) 
-		payload[i] = (*ptr++);
-	
-	//Printf("(UART%d:%d %d %d)\n",sel+1,*uart_buf_rptr,*uart_buf_wptr,*payload_ptr);	
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
 }
 
+//sel=0 goes out on UART1 (right), sel=1 on UART2 (left)
+static int dm5680_tx_fd(uint8_t sel)
+{
+	return sel ? fd_dm5680l : fd_dm5680r;
+}
 
-static void *pthread_recv_dm5680l(void *arg)
+// req, if any, joins the pending table in the same critical section that
+// queues its frame, so its place among the owed replies is exact.
+static int dm5680_send(uint8_t sel, uint8_t* cmd, uint8_t cmd_len, bool coalesce, dm5680_req_t *req)
 {
-	int     i,len=0;
+	dm5680_link_t *link = &dm5680_link[sel];
+	uint8_t out[DM5680_TX_SIZE];
+	uint8_t id = cmd[3];
+	uint32_t now = dm5680_ms();
+	uint16_t n;
+
+	pthread_mutex_lock(&link->lock);
+	if((int32_t)(now - link->inflight_until[id]) >= 0)
+		link->inflight[id] = 0;
+
+	if(coalesce && link->inflight[id]) {
+		link->coalesced++;
+		pthread_mutex_unlock(&link->lock);
+		return 0;
+	}
+	if(req) {
+		if(link->pending_num == DM5680_PENDING_MAX) {
+			pthread_mutex_unlock(&link->lock);
+			return -1;
+		}
+		req->skip = link->inflight[id];
+		link->pending[link->pending_num++] = req;
+	}
+	if(link->inflight[id] < 0xFF)
+		link->inflight[id]++;
+	link->inflight_until[id] = now + DM5680_POLL_MS;
+
+	while(link->len + cmd_len > DM5680_TX_SIZE)
+		pthread_cond_wait(&link->cond, &link->lock);
+	memcpy(&link->buf[link->len], cmd, cmd_len);
+	link->len += cmd_len;
+
+	if(!link->busy) {
+		link->busy = true;
+		while(link->len)
+		{
+			n = link->len;
+			memcpy(out, link->buf, n);
+			link->len = 0;
+			pthread_cond_broadcast(&link->cond);
+			pthread_mutex_unlock(&link->lock);
 
-	uint8_t buffer[128];
-	fd_set  rd;
+			if(uart_write_all(dm5680_tx_fd(sel), out, n) != n)
+				Printf("UART%d tx short\n", sel+1);
 
-	uint8_t state,len8,payload_ptr,payload[128];
+			pthread_mutex_lock(&link->lock);
+		}
+		link->busy = false;
+	}
+	pthread_mutex_unlock(&link->lock);
+	return 0;
+}
 
-	//Init UART buffers
-	uart_rptr[0]=0;
-	uart_wptr[0]=0;
-	state = len8 = payload_ptr = 0;
+///////////////////////////////////////////////////////////////////////////////
+// Pending requests
+// The DM5680 answers in order, so a reply completes the oldest pending
+// request for its command once the replies owed to earlier sends (req->skip)
+// have gone by. Deadlines run off one timerfd on the reactor.
+static void dm5680_unlink(dm5680_link_t *link, int i)
+{
+	link->pending_num--;
+	memmove(&link->pending[i], &link->pending[i+1], (link->pending_num - i) * sizeof(link->pending[0]));
+}
 
-	for(;;)
+// Arms the timer for the nearest deadline on either link
+static void dm5680_req_arm(void)
+{
+	struct itimerspec its;
+	int32_t left, min = -1;
+	uint32_t now;
+
+	pthread_mutex_lock(&dm5680_req_tmutex);
+	now = dm5680_ms();
+	for(int sel=0; sel<2; sel++)
 	{
-		FD_ZERO(&rd);
-		FD_SET(fd_dm5680l,&rd);
-		while(FD_ISSET(fd_dm5680l,&rd))
-		{
-		  if(select(fd_dm5680l+1,&rd,NULL,NULL,NULL) < 0)
-			Printf("UART1:select error!\n");
-		  else
-		  {
-			len = uart_read(fd_dm5680l, buffer, 128);
-			//if(len) Printf("(UART1-%d)\n",len);
-			for(i=0;i<len;i++)
-			{
-				uart_buffer[0][uart_wptr[0]] = buffer[i];
-				uart_wptr[0]++; 
-
-				if(uart_wptr[0] == uart_rptr[0]) 
-					Printf("UART1 fifo full!\n");
-			}
-			if(len) 
-				uart_parse(0,&state, &len8, payload,&payload_ptr);
-		  }
+		dm5680_link_t *link = &dm5680_link[sel];
+
+		pthread_mutex_lock(&link->lock);
+		for(int i=0; i<link->pending_num; i++) {
+			left = link->pending[i]->deadline - now;
+			if(left < 1)
+				left = 1;
+			if(min < 0 || left < min)
+				min = left;
 		}
+		pthread_mutex_unlock(&link->lock);
 	}
 
-	return NULL;
+	memset(&its, 0, sizeof(its));
+	if(min > 0) {
+		its.it_value.tv_sec  = min / 1000;
+		its.it_value.tv_nsec = (min % 1000) * 1000000;
+	}
+	timerfd_settime(dm5680_req_tfd, 0, &its, NULL);
+	pthread_mutex_unlock(&dm5680_req_tmutex);
 }
 
-static void *pthread_recv_dm5680r(void *arg)
+// Called for every reply frame on the reactor thread
+static void dm5680_resp(uint8_t sel, uint8_t *pkt)
 {
-	int     i,len=0;
+	dm5680_link_t *link = &dm5680_link[sel];
+	dm5680_req_t *req, *done = NULL;
+	dm5680_req_fn_t fn = NULL;
+	uint8_t cmd = pkt[1];
+	uint8_t n = pkt[0] - 1;
 
-	uint8_t buffer[128];
-	fd_set  rd;
+	pthread_mutex_lock(&link->lock);
+	if(link->inflight[cmd])
+		link->inflight[cmd]--;
 
-	uint8_t state,len8,payload_ptr,payload[128];
+	for(int i=0; i<link->pending_num; i++)
+	{
+		req = link->pending[i];
+		if(req->cmd != cmd)
+			continue;
+		if(req->skip) {
+			req->skip--;
+			continue;
+		}
+		if(done)
+			continue;
+
+		if(n > sizeof(req->data))
+			n = sizeof(req->data);
+		memcpy(req->data, &pkt[2], n);
+		req->len = n;
+		fn = req->fn;
+		req->status = DM5680_REQ_DONE;
+		done = req;
+		dm5680_unlink(link, i--);
+	}
+	if(done)
+		pthread_cond_broadcast(&link->cond);
+	pthread_mutex_unlock(&link->lock);
 
-	//Init UART buffers
-	uart_rptr[1]=0;
-	uart_wptr[1]=0;
-	state = len8 = payload_ptr = 0;
+	if(fn)
+		fn(done);
+}
 
-	for(;;)
+// Timer handler: fails every request whose deadline has passed
+static void dm5680_req_timer(int fd, void *arg)
+{
+	dm5680_req_t *expired[DM5680_PENDING_MAX];
+	uint64_t cnt;
+	uint32_t now = dm5680_ms();
+	int num;
+
+	read(fd, &cnt, sizeof(cnt));
+	for(int sel=0; sel<2; sel++)
 	{
-		FD_ZERO(&rd);
-		FD_SET(fd_dm5680r,&rd);
-		while(FD_ISSET(fd_dm5680r,&rd))
+		dm5680_link_t *link = &dm5680_link[sel];
+
+		num = 0;
+		pthread_mutex_lock(&link->lock);
+		for(int i=0; i<link->pending_num; i++) {
+			if((int32_t)(now - link->pending[i]->deadline) < 0)
+				continue;
+			link->pending[i]->status = DM5680_REQ_TIMEOUT;
+			expired[num++] = link->pending[i];
+			link->timeouts++;
+			dm5680_unlink(link, i--);
+		}
+		if(num)
+			pthread_cond_broadcast(&link->cond);
+		pthread_mutex_unlock(&link->lock);
+
+		for(int i=0; i<num; i++)
+			if(expired[i]->fn)
+				expired[i]->fn(expired[i]);
+	}
+	dm5680_req_arm();
+}
+
+static int dm5680_submit(dm5680_req_t *req, uint8_t sel, uint8_t cmd, const uint8_t *args,
+						 uint8_t nargs, int timeout_ms, dm5680_req_fn_t fn, void *arg)
+{
+	uint8_t frame[4 + DM5680_REQ_ARGS_MAX] = {0xAA, 0x55, nargs + 1, cmd};
+
+	if(nargs > DM5680_REQ_ARGS_MAX)
+		return -1;
+	memcpy(&frame[4], args, nargs);
+
+	req->sel = sel;
+	req->cmd = cmd;
+	req->status = DM5680_REQ_PENDING;
+	req->len = 0;
+	req->fn = fn;
+	req->arg = arg;
+	req->deadline = dm5680_ms() + timeout_ms;
+
+	if(dm5680_send(sel, frame, 4 + nargs, false, req) < 0) {
+		req->status = DM5680_REQ_FAILED;
+		return -1;
+	}
+	dm5680_req_arm();
+	return 0;
+}
+
+// Sends cmd with args to one side; the reply or a timeout completes req.
+// Collect the result with DM5680_req_wait().
+int DM5680_request(dm5680_req_t *req, uint8_t sel, uint8_t cmd, const uint8_t *args, uint8_t nargs, int timeout_ms)
+{
+	return dm5680_submit(req, sel, cmd, args, nargs, timeout_ms, NULL, NULL);
+}
+
+// As DM5680_request(), but fn(req) runs on the reactor thread on completion.
+// req must stay valid until then.
+int DM5680_request_cb(dm5680_req_t *req, uint8_t sel, uint8_t cmd, const uint8_t *args, uint8_t nargs,
+					  int timeout_ms, dm5680_req_fn_t fn, void *arg)
+{
+	return dm5680_submit(req, sel, cmd, args, nargs, timeout_ms, fn, arg);
+}
+
+static int dm5680_req_status(dm5680_req_t *req)
+{
+	dm5680_link_t *link = &dm5680_link[req->sel];
+	int status;
+
+	pthread_mutex_lock(&link->lock);
+	status = req->status;
+	pthread_mutex_unlock(&link->lock);
+	return status;
+}
+
+// Drops req from the table if it is still there past its deadline
+static void dm5680_req_giveup(dm5680_req_t *req)
+{
+	dm5680_link_t *link = &dm5680_link[req->sel];
+
+	pthread_mutex_lock(&link->lock);
+	for(int i=0; i<link->pending_num; i++) {
+		if(link->pending[i] == req) {
+			req->status = DM5680_REQ_TIMEOUT;
+			link->timeouts++;
+			dm5680_unlink(link, i);
+			break;
+		}
+	}
+	pthread_mutex_unlock(&link->lock);
+}
+
+// Blocks until req completes, at most until its deadline. Returns the
+// final status.
+int DM5680_req_wait(dm5680_req_t *req)
+{
+	dm5680_link_t *link = &dm5680_link[req->sel];
+	struct timespec ts;
+	struct pollfd pfd[2];
+	int32_t left;
+
+	if(reactor_is_self()) {
+		//replies are parsed on this thread, so pump the UARTs here
+		pfd[0].fd = fd_dm5680l;
+		pfd[1].fd = fd_dm5680r;
+		pfd[0].events = pfd[1].events = POLLIN;
+		while(dm5680_req_status(req) == DM5680_REQ_PENDING)
 		{
-		  if(select(fd_dm5680r+1,&rd,NULL,NULL,NULL) < 0)
-			Printf("UART2:select error!\n");
-		  else
-		  {
-			len = uart_read(fd_dm5680r, buffer, 128);
-			//if(len) Printf("(UART2-%d)\n",len);
-			for(i=0;i<len;i++)
-			{
-				uart_buffer[1][uart_wptr[1]] = buffer[i];
-				uart_wptr[1]++; 
-
-				if(uart_wptr[1] == uart_rptr[1]) 
-					Printf("UART2 fifo full!\n");
+			left = req->deadline - dm5680_ms();
+			if(left <= 0 || poll(pfd, 2, left) <= 0) {
+				dm5680_req_giveup(req);
+				break;
 			}
-			if(len) 
-				uart_parse(1,&state, &len8, payload,&payload_ptr);
-		  }
+			for(int i=0; i<2; i++)
+				if(pfd[i].revents & POLLIN)
+					dm5680_rx(pfd[i].fd, (void *)(intptr_t)i);
 		}
+		return req->status;
+	}
+
+	left = req->deadline - dm5680_ms();
+	if(left < 0)
+		left = 0;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	ts.tv_sec  += left / 1000;
+	ts.tv_nsec += (left % 1000) * 1000000;
+	if(ts.tv_nsec >= 1000000000) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
 	}
 
-	return NULL;
+	pthread_mutex_lock(&link->lock);
+	while(req->status == DM5680_REQ_PENDING)
+		if(pthread_cond_timedwait(&link->cond, &link->lock, &ts) == ETIMEDOUT)
+			break;
+	pthread_mutex_unlock(&link->lock);
+
+	if(req->status == DM5680_REQ_PENDING)
+		dm5680_req_giveup(req);
+	return req->status;
 }
 
+// Runs both links over already open fds: the goggle's UARTs from
+// uart_init(), or pipes and socketpairs in a host harness. Must be called
+// before thread_reactor starts.
+int DM5680_attach(int fd_right, int fd_left)
+{
+	pthread_condattr_t attr;
+
+	fd_dm5680r = fd_right;
+	fd_dm5680l = fd_left;
+
+	for(int i=0; i<2; i++)
+		ringbuf_init(&dm5680_rx_ctx[i].ring, dm5680_rx_ctx[i].mem, DM5680_RING_SIZE, DM5680_PKT_MAX);
+	// receive sel 0 is the left UART, transmit sel 0 the right one
+	dm5680_rx_ctx[0].fd = fd_dm5680l;
+	dm5680_rx_ctx[0].link = 1;
+	dm5680_rx_ctx[1].fd = fd_dm5680r;
+	dm5680_rx_ctx[1].link = 0;
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	for(int i=0; i<2; i++) {
+		pthread_mutex_init(&dm5680_link[i].lock, NULL);
+		pthread_cond_init(&dm5680_link[i].cond, &attr);
+	}
+	pthread_condattr_destroy(&attr);
+
+	dm5680_req_tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+
+	reactor_add(fd_dm5680l, dm5680_rx, (void *)0);
+	reactor_add(fd_dm5680r, dm5680_rx, (void *)1);
+	return reactor_add(dm5680_req_tfd, dm5680_req_timer, NULL);
+}
 
 int uart_init()
 {
 	static bool is_inited = false;
-	pthread_t tid_l,tid_r;
+	static const uart_cfg_t cfg = DM5680_UART_CFG;
 
 	if(is_inited)
 		return 0;
 
-	fd_dm5680r = uart_open(1);
-	fd_dm5680l = uart_open(2);
-
-	pthread_create(&tid_l, NULL, pthread_recv_dm5680l, NULL);
-	pthread_create(&tid_r, NULL, pthread_recv_dm5680r, NULL);
-	pthread_mutex_init(&cmd_to5680_mutex, NULL);
+	dm5680_capture_open();
+	DM5680_attach(uart_open_cfg(1, &cfg), uart_open_cfg(2, &cfg));
 
 	is_inited = true;
 	return 0;
 }
 
-void UART1_TX (uint8_t d)
-{
-	uart_write_byte(fd_dm5680r, d);
-}
-
-void UART2_TX (uint8_t d)
-{
-	uart_write_byte(fd_dm5680l, d);
-}
-
 //////////////////////////////
 //sel=0/URART1/Right,
 //sel=1/URART2/Left
 void Cmd_to_DM5680(uint8_t sel, uint8_t* cmd, uint8_t cmd_len)
 {
-	uint8_t i;
-	pthread_mutex_lock(&cmd_to5680_mutex);
-
-	for(i=0;i<cmd_len;i++) {
-		if(sel==0)
-			UART1_TX(cmd[i]);
-		else 	
-			UART2_TX(cmd[i]);
-	}
+	dm5680_send(sel, cmd, cmd_len, false, NULL);
+}
 
-	pthread_mutex_unlock(&cmd_to5680_mutex);
+// Status request; dropped while the previous one is still unanswered
+static void Poll_to_DM5680(uint8_t sel, uint8_t* cmd, uint8_t cmd_len)
+{
+	dm5680_send(sel, cmd, cmd_len, true, NULL);
 }
 
 void DM5680_req_ver()
 {
 	uint8_t Cmd[4] = {0xAA, 0x55,0x01,0x1};
-	Cmd_to_DM5680(0, Cmd, 4);
-	Cmd_to_DM5680(1, Cmd, 4);
+	Poll_to_DM5680(0, Cmd, 4);
+	Poll_to_DM5680(1, Cmd, 4);
 
 }
 
@@ -287,6 +635,7 @@ void DM5680_get_ver(uint8_t sel, uint8_t* payload)
 {
 	rx_status_t* rx_status_ptr = sel?(&rx_status[1]) : (&rx_status[0]);
 	rx_status_ptr->rx_ver = payload[2]; 
+	rx_status_publish();
 }
 
 void DM5680_SetFanSpeed(uint8_t sel, uint8_t speed) 
@@ -310,6 +659,8 @@ void DM5680_ResetRF(uint8_t on) //Reset DM6302, 0=reset
 	uint8_t Cmd[5] = {0xAA, 0x55,0x02,0x4,0x00};
 	Cmd[4]= on;
 
+	if(!on)
+		DM6302_shadow_reset();
 	Cmd_to_DM5680(0, Cmd, 5);
 	Cmd_to_DM5680(1, Cmd, 5);
 }
@@ -350,8 +701,8 @@ void DM5680_SetFPS(uint8_t fps) //0=60fps, 1=90fps
 void DM5680_req_rssi()
 {
 	uint8_t Cmd[4] = {0xAA, 0x55,0x01,0x12};
-	Cmd_to_DM5680(0, Cmd, 4);
-	Cmd_to_DM5680(1, Cmd, 4);
+	Poll_to_DM5680(0, Cmd, 4);
+	Poll_to_DM5680(1, Cmd, 4);
 }
 
 void DM5680_WriteReg(uint8_t page, uint8_t addr, uint8_t wdat) 
@@ -397,6 +748,8 @@ void DM5680_get_rssi(uint8_t sel, uint8_t* payload)
 		filter_rssi(&rx_status_ptr->rx_rssi[1], payload[3],&avg_buf[sel*20+10]);
 		rx_status_ptr->rx_DLQ  = payload[4];
 		rx_status_ptr->rx_Stat = payload[5];
+		rx_status_publish();
+		evloop_notify(EV_TASK_OSD_HDZERO);
 		#if 0 
 		Printf("(RSSI %x %x %x %x)\n",	rx_status[0].rx_rssi[0],
 										rx_status[0].rx_rssi[1],
@@ -413,7 +766,7 @@ void DM5680_get_rssi(uint8_t sel, uint8_t* payload)
 void DM5680_req_vtxinfo(uint8_t sel)
 {
 	uint8_t Cmd[4] = {0xAA, 0x55,0x01,0x14};
-	Cmd_to_DM5680(sel, Cmd, 4);
+	Poll_to_DM5680(sel, Cmd, 4);
 }
 
 void DM5680_get_vtxinfo(uint8_t sel, uint8_t* payload)
@@ -424,6 +777,7 @@ void DM5680_get_vtxinfo(uint8_t sel, uint8_t* payload)
 		rx_status_ptr->rx_vtx_type = payload[2];
 		rx_status_ptr->rx_vtx_ver  = payload[3];
 		rx_status_ptr->rx_vtx_stat = payload[4];
+		rx_status_publish();
 	}
 	else {
 		perror("GetVTXinfo: CRC Error\n");
@@ -433,26 +787,29 @@ void DM5680_get_vtxinfo(uint8_t sel, uint8_t* payload)
 void DM5680_req_vldflg()
 {
 	uint8_t Cmd[4] = {0xAA, 0x55,0x01,0x11};
-	Cmd_to_DM5680(0, Cmd, 4);
-	Cmd_to_DM5680(1, Cmd, 4);
+	Poll_to_DM5680(0, Cmd, 4);
+	Poll_to_DM5680(1, Cmd, 4);
 }
 
 void DM5680_clear_vldflg()
 {
 	rx_status[0].rx_valid    = 0;
 	rx_status[1].rx_valid    = 0;
+	rx_status_publish();
 }
 
 void DM5680_get_vldflg(uint8_t sel, uint8_t* payload)
 {
 	rx_status_t* rx_status_ptr = sel? &rx_status[1] : &rx_status[0];
 	rx_status_ptr->rx_valid    = payload[2];
+	rx_status_publish();
 }
 
 void DM5680_get_regval(uint8_t sel, uint8_t* payload)
 {
 	rx_status_t* rx_status_ptr = sel? &rx_status[1] : &rx_status[0];
 	rx_status_ptr->rx_regval  = payload[2];
+	rx_status_publish();
 }
 
 void DM5680_OSD_parse(uint8_t *buf, uint8_t len)
@@ -21,10 +21,38 @@ typedef struct {
 
 extern rx_status_t  rx_status[2];
 
-void UART1_TX (uint8_t d);
-void UART2_TX (uint8_t d);
-
 int uart_init();
+int DM5680_attach(int fd_right, int fd_left);
+
+// Request with a deadline. Owned by the caller; once status leaves
+// PENDING, data holds the reply payload (what follows cmd).
+#define DM5680_REQ_PENDING	0
+#define DM5680_REQ_DONE		1
+#define DM5680_REQ_TIMEOUT	2
+#define DM5680_REQ_FAILED	3	//pending table full
+
+#define DM5680_REQ_ARGS_MAX	4
+
+typedef struct dm5680_req dm5680_req_t;
+typedef void (*dm5680_req_fn_t)(dm5680_req_t *req);
+
+struct dm5680_req {
+	uint8_t  sel;
+	uint8_t  cmd;
+	int      status;
+	uint8_t  data[8];
+	uint8_t  len;
+	dm5680_req_fn_t fn;
+	void    *arg;
+
+	uint8_t  skip;		//replies owed to earlier sends of cmd
+	uint32_t deadline;	//ms
+};
+
+int DM5680_request(dm5680_req_t *req, uint8_t sel, uint8_t cmd, const uint8_t *args, uint8_t nargs, int timeout_ms);
+int DM5680_request_cb(dm5680_req_t *req, uint8_t sel, uint8_t cmd, const uint8_t *args, uint8_t nargs,
+					  int timeout_ms, dm5680_req_fn_t fn, void *arg);
+int DM5680_req_wait(dm5680_req_t *req);
 
 void DM5680_req_ver();
 void DM5680_get_ver(uint8_t sel, uint8_t* payload);
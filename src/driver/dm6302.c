@@ -52,72 +52,89 @@
    dat1: ���Ҳ�DM6302����������*/
 void SPI_Read (uint8_t page, uint16_t addr, uint32_t* dat0, uint32_t* dat1)
 {
-    uint8_t val;
-    uint32_t rdat;
+    i2c_xfer_t xfer;
+    uint8_t rd[8];
+    uint8_t i;
 
-    //spi_addr
-    val = addr & 0xFF;
-    I2C_Write(ADDR_FPGA, 0x91, val);
-    val = (page << 4) | (addr >> 8);
-    I2C_Write(ADDR_FPGA, 0x92, val);
-
-    //read cmd
-    I2C_Write(ADDR_FPGA, 0x90, 0x10);
-
-    //read dat
-    rdat = I2C_Read(ADDR_FPGA, 0x9b);
-    rdat <<= 8;
-    rdat |= I2C_Read(ADDR_FPGA, 0x9a);
-    rdat <<= 8;
-    rdat |= I2C_Read(ADDR_FPGA, 0x99);
-    rdat <<= 8;
-    rdat |= I2C_Read(ADDR_FPGA, 0x98);
-    *dat0 = rdat;
-
-    rdat = I2C_Read(ADDR_FPGA, 0x9f);
-    rdat <<= 8;
-    rdat |= I2C_Read(ADDR_FPGA, 0x9e);
-    rdat <<= 8;
-    rdat |= I2C_Read(ADDR_FPGA, 0x9d);
-    rdat <<= 8;
-    rdat |= I2C_Read(ADDR_FPGA, 0x9c);
-    *dat1 = rdat;
+    //spi_addr + read cmd
+    i2c_xfer_init(&xfer, I2C_PORT_MAIN);
+    i2c_xfer_write(&xfer, ADDR_FPGA, 0x91, addr & 0xFF);
+    i2c_xfer_write(&xfer, ADDR_FPGA, 0x92, (page << 4) | (addr >> 8));
+    i2c_xfer_write(&xfer, ADDR_FPGA, 0x90, 0x10);
+    i2c_xfer_submit(&xfer);
+
+    //read dat, in a separate transfer so the FPGA has finished the SPI read
+    for(i=0; i<8; i++)
+        i2c_xfer_read(&xfer, ADDR_FPGA, 0x98 + i, &rd[i]);
+    i2c_xfer_submit(&xfer);
+
+    *dat0 = ((uint32_t)rd[3] << 24) | ((uint32_t)rd[2] << 16) | ((uint32_t)rd[1] << 8) | rd[0];
+    *dat1 = ((uint32_t)rd[7] << 24) | ((uint32_t)rd[6] << 16) | ((uint32_t)rd[5] << 8) | rd[4];
 
 #ifdef _DEBUG_DM6300
     Printf("SPI READ: addr=%x  data=  %x  %x\n", addr, (*dat1), (*dat0));
 #endif
 }
 
-// RF_SPIд����
-/* sel: 0=д����DM6302
-        1=д�Ҳ�DM6302
-        2=д���DM6302*/
-void SPI_Write(uint8_t sel, uint8_t page, uint16_t addr, uint32_t dat)
+static void shadow_record(uint8_t sel, uint8_t page, uint16_t addr, uint32_t dat);
+
+///////////////////////////////////////////////////////////////////////////////
+// SPI burst
+//
+// Each SPI word is 7 register writes to the FPGA bridge. A burst queues the
+// words of a sequence and sends them as multi-message I2C transfers, 6 words
+// per I2C_RDWR ioctl, instead of 7 ioctls per word.
+// SPI_Read() doesn't see queued words, so end the burst before reading back.
+void SPI_Burst_Begin(spi_burst_t* burst)
 {
-    uint8_t val;
-    uint32_t r1=0,r0=0;
+    i2c_xfer_init(burst, I2C_PORT_MAIN);
+}
+
+void SPI_Burst_Write(spi_burst_t* burst, uint8_t sel, uint8_t page, uint16_t addr, uint32_t dat)
+{
+    // keep the 7 writes of one word in the same transfer
+    if(burst->nmsgs + 7 > I2C_XFER_MAX_MSGS)
+        i2c_xfer_submit(burst);
 
     //spi_addr
-    val = addr & 0xFF;
-    I2C_Write(ADDR_FPGA, 0x91, val);
-    val = (page << 4) | (addr >> 8);
-    I2C_Write(ADDR_FPGA, 0x92, val);
+    i2c_xfer_write(burst, ADDR_FPGA, 0x91, addr & 0xFF);
+    i2c_xfer_write(burst, ADDR_FPGA, 0x92, (page << 4) | (addr >> 8));
 
     //spi_wdat
-    val = dat & 0xFF;
-    I2C_Write(ADDR_FPGA, 0x93, val);
-    val = (dat>>8) & 0xFF;
-    I2C_Write(ADDR_FPGA, 0x94, val);
-    val = (dat>>16) & 0xFF;
-    I2C_Write(ADDR_FPGA, 0x95, val);
-    val = (dat>>24) & 0xFF;
-    I2C_Write(ADDR_FPGA, 0x96, val);
+    i2c_xfer_write(burst, ADDR_FPGA, 0x93, dat & 0xFF);
+    i2c_xfer_write(burst, ADDR_FPGA, 0x94, (dat>>8) & 0xFF);
+    i2c_xfer_write(burst, ADDR_FPGA, 0x95, (dat>>16) & 0xFF);
+    i2c_xfer_write(burst, ADDR_FPGA, 0x96, (dat>>24) & 0xFF);
 
     //wrte cmd
     if(sel == 0)
-        I2C_Write(ADDR_FPGA, 0x90, 0x03);
+        i2c_xfer_write(burst, ADDR_FPGA, 0x90, 0x03);
     else
-        I2C_Write(ADDR_FPGA, 0x90, sel);
+        i2c_xfer_write(burst, ADDR_FPGA, 0x90, sel);
+
+    shadow_record(sel, page, addr, dat);
+}
+
+int SPI_Burst_End(spi_burst_t* burst)
+{
+    int ret = i2c_xfer_submit(burst);
+    if(ret < 0)
+        DM6302_shadow_reset(); // don't know what made it to the chips
+    return ret;
+}
+
+// RF_SPI write
+/* sel: 0=both DM6302
+        1=right DM6302
+        2=left DM6302*/
+void SPI_Write(uint8_t sel, uint8_t page, uint16_t addr, uint32_t dat)
+{
+    spi_burst_t burst;
+    uint32_t r1=0,r0=0;
+
+    SPI_Burst_Begin(&burst);
+    SPI_Burst_Write(&burst, sel, page, addr, dat);
+    SPI_Burst_End(&burst);
 
 #ifdef _DEBUG_DM6300
     SPI_Read(page, addr, &r0, &r1);
@@ -143,43 +160,185 @@ uint32_t tab[3][FREQ_NUM] = {
     {0xB00000, 0x9D5555, 0x8AAAAB, 0x780000, 0x655555, 0x52AAAB, 0x400000, 0x2D5555, 0x000000, 0x155555}
 };
 
+///////////////////////////////////////////////////////////////////////////////
+// Register programs
+//
+// The init and channel sequences are const tables run by DM6302_run().
+// It keeps a shadow of the last value written to each register of both
+// DM6302s and drops writes that would not change anything, including the
+// repeated 0xFF0 bank selects. Entries marked DM_FORCE (strobes, calibration
+// triggers, anything toggled within a program) are always written.
+#define DM_W        0   // write dat
+#define DM_FORCE    1   // write dat, never elided
+#define DM_CH       2   // write tab[dat][ch]
+
+#define PROG_LEN(p) (sizeof(p) / sizeof(p[0]))
+
+typedef struct {
+    uint8_t  op;
+    uint8_t  page;
+    uint16_t addr;
+    uint32_t dat;
+} dm6302_prog_t;
+
+#define SHADOW_REGS 1024 // 12-bit byte address, 32-bit registers
+
+// slot 0: page 6, slot 1: page 3 in bank 0x18, slot 2: page 3 in bank 0x19
+typedef struct {
+    int32_t  bank;  // last value written to page 6 0xFF0, -1 = unknown
+    bool     m0_run;
+    uint32_t val[3][SHADOW_REGS];
+    bool     valid[3][SHADOW_REGS];
+} dm6302_shadow_t;
+
+static dm6302_shadow_t dm_shadow[2] = { //0=right DM6302, 1=left DM6302
+    {.bank = -1},
+    {.bank = -1},
+};
+
+void DM6302_shadow_reset(void)
+{
+    int i;
+
+    for(i=0; i<2; i++) {
+        memset(&dm_shadow[i], 0, sizeof(dm6302_shadow_t));
+        dm_shadow[i].bank = -1;
+    }
+}
+
+static int shadow_slot(dm6302_shadow_t* sh, uint8_t page)
+{
+    if(page == 0x6)
+        return 0;
+    if(page == 0x3) {
+        if(sh->bank == 0x18) return 1;
+        if(sh->bank == 0x19) return 2;
+    }
+    return -1;
+}
+
+static void shadow_record(uint8_t sel, uint8_t page, uint16_t addr, uint32_t dat)
+{
+    int i, slot;
+    uint16_t reg = (addr >> 2) & (SHADOW_REGS - 1);
+
+    for(i=0; i<2; i++) {
+        if(sel && (sel != i+1))
+            continue;
+
+        dm6302_shadow_t* sh = &dm_shadow[i];
+        if(page == 0x6 && addr == 0x7FC && (bool)(dat & 1) != sh->m0_run) {
+            // the M0 starting or stopping: nothing from before is known,
+            // except which bank we selected last
+            memset(sh->valid, 0, sizeof(sh->valid));
+            sh->m0_run = dat & 1;
+        }
+
+        slot = shadow_slot(sh, page);
+        if(slot >= 0) {
+            sh->val[slot][reg] = dat;
+            sh->valid[slot][reg] = true;
+        }
+        else if((page == 0x3) && (sh->bank < 0)) {
+            // unknown bank, could be either one
+            sh->valid[1][reg] = false;
+            sh->valid[2][reg] = false;
+        }
+
+        if(page == 0x6 && addr == 0xFF0)
+            sh->bank = dat;
+    }
+}
+
+static bool shadow_match(uint8_t sel, uint8_t page, uint16_t addr, uint32_t dat)
+{
+    int i, slot;
+    uint16_t reg = (addr >> 2) & (SHADOW_REGS - 1);
+
+    for(i=0; i<2; i++) {
+        if(sel && (sel != i+1))
+            continue;
+
+        dm6302_shadow_t* sh = &dm_shadow[i];
+        // the M0 may change registers behind our back, trust only the bank select
+        if(sh->m0_run && !(page == 0x6 && addr == 0xFF0))
+            return false;
+        slot = shadow_slot(sh, page);
+        if(slot < 0 || !sh->valid[slot][reg] || sh->val[slot][reg] != dat)
+            return false;
+    }
+    return true;
+}
+
+static void DM6302_run(uint8_t sel, const dm6302_prog_t* prog, uint32_t len, uint8_t ch)
+{
+    spi_burst_t burst;
+    uint32_t i, dat;
+
+    SPI_Burst_Begin(&burst);
+    for(i=0; i<len; i++) {
+        if(prog[i].op == DM_CH)
+            dat = tab[prog[i].dat][ch];
+        else
+            dat = prog[i].dat;
+
+        if((prog[i].op != DM_FORCE) && shadow_match(sel, prog[i].page, prog[i].addr, dat))
+            continue;
+        SPI_Burst_Write(&burst, sel, prog[i].page, prog[i].addr, dat);
+    }
+    SPI_Burst_End(&burst);
+}
+
+static const dm6302_prog_t dm6302_rx1_pll[] = {
+    //02_RX1_PLL_11316(5658MHz)
+    {DM_W,     0x6, 0xFF0, 0x00000018},
+    {DM_FORCE, 0x3, 0x130, 0x00000013}, //0x00000013 10
+    {DM_W,     0x3, 0x134, 0x00000013},
+    {DM_W,     0x3, 0x138, 0x00000370},
+    {DM_W,     0x3, 0x13C, 0x00000410},
+    {DM_FORCE, 0x3, 0x140, 0x00000000},
+    {DM_W,     0x3, 0x144, 0x0D640735},
+    {DM_W,     0x3, 0x148, 0x01017F03},
+    {DM_W,     0x3, 0x14C, 0x022288A2}, //0x021288A2
+    {DM_FORCE, 0x3, 0x150, 0x00FFCF33}, //0x00FFCF33
+    {DM_W,     0x3, 0x154, 0x1F0C3440}, //0x1F3C3C40 0x1F0C3440
+    {DM_W,     0x3, 0x128, 0x00008030},
+    {DM_CH,    0x3, 0x120, 0}, //ch
+    {DM_FORCE, 0x3, 0x11C, 0x00000002},
+    {DM_FORCE, 0x3, 0x118, 0x00000001},
+    {DM_FORCE, 0x3, 0x118, 0x00000000},
+    {DM_W,     0x3, 0x128, 0x00008030},
+    {DM_CH,    0x3, 0x120, 0}, //ch
+    {DM_FORCE, 0x3, 0x11C, 0x00000003},
+    {DM_FORCE, 0x3, 0x118, 0x00000001},
+    {DM_FORCE, 0x3, 0x118, 0x00000000},
+    {DM_FORCE, 0x3, 0x150, 0x00FFCFB3},
+    {DM_CH,    0x3, 0x104, 1}, //ch
+    {DM_CH,    0x3, 0x108, 2}, //ch
+    {DM_FORCE, 0x3, 0x100, 0x00000000},
+    {DM_FORCE, 0x3, 0x100, 0x00000003},
+    {DM_FORCE, 0x3, 0x150, 0x000333B3},
+    {DM_FORCE, 0x3, 0x140, 0x07070000},
+    {DM_FORCE, 0x3, 0x130, 0x00000010},
+};
+
 void DM6302_SetChannel(uint8_t ch)
 {
-    SPI_Write(0, 0x6, 0xFF0, 0x00000018);
-    SPI_Write(0, 0x3, 0x130, 0x00000013);
-    SPI_Write(0, 0x3, 0x134, 0x00000013);
-    SPI_Write(0, 0x3, 0x138, 0x00000370);
-    SPI_Write(0, 0x3, 0x13C, 0x00000410);
-    SPI_Write(0, 0x3, 0x140, 0x00000000);
-    SPI_Write(0, 0x3, 0x144, 0x0D640735);
-    SPI_Write(0, 0x3, 0x148, 0x01017F03);
-    SPI_Write(0, 0x3, 0x14C, 0x022288A2);
-    SPI_Write(0, 0x3, 0x150, 0x00FFCF33);
-    SPI_Write(0, 0x3, 0x154, 0x1F0C3440);
-    SPI_Write(0, 0x3, 0x128, 0x00008030);
-    SPI_Write(0, 0x3, 0x120, tab[0][ch]);  //ch
-    SPI_Write(0, 0x3, 0x11C, 0x00000002);
-    SPI_Write(0, 0x3, 0x118, 0x00000001);
-    SPI_Write(0, 0x3, 0x118, 0x00000000);
-    SPI_Write(0, 0x3, 0x128, 0x00008030);
-    SPI_Write(0, 0x3, 0x120, tab[0][ch]);  //ch
-    SPI_Write(0, 0x3, 0x11C, 0x00000003);
-    SPI_Write(0, 0x3, 0x118, 0x00000001);
-    SPI_Write(0, 0x3, 0x118, 0x00000000);
-    SPI_Write(0, 0x3, 0x150, 0x00FFCFB3);
-    SPI_Write(0, 0x3, 0x104, tab[1][ch]);  //ch
-    SPI_Write(0, 0x3, 0x108, tab[2][ch]);  //ch
-    SPI_Write(0, 0x3, 0x100, 0x00000000);
-    SPI_Write(0, 0x3, 0x100, 0x00000003);
-    SPI_Write(0, 0x3, 0x150, 0x000333B3);
-    SPI_Write(0, 0x3, 0x140, 0x07070000);
-    SPI_Write(0, 0x3, 0x130, 0x00000010);
+    DM6302_run(0, dm6302_rx1_pll, PROG_LEN(dm6302_rx1_pll), ch);
+}
+
+// Tunes one DM6302 only, sel: 1=right, 2=left. Lets the scan look at two
+// channels at once; DM6302_SetChannel() brings both back together.
+void DM6302_SetChannelRF(uint8_t sel, uint8_t ch)
+{
+    DM6302_run(sel, dm6302_rx1_pll, PROG_LEN(dm6302_rx1_pll), ch);
 }
 
 void DM6302_M0()
 {
+    spi_burst_t burst;
     uint32_t i;
-    uint32_t dat[] = {
+    static const uint32_t dat[] = {
     0x0000C118,
     0x000000D5,
     0x00000135,
@@ -419,9 +578,10 @@ void DM6302_M0()
     0x2036313A
     };
 
-    SPI_Write(0 ,0x6, 0xFF0, 0x00000000);
+    SPI_Burst_Begin(&burst);
+    SPI_Burst_Write(&burst, 0, 0x6, 0xFF0, 0x00000000);
     for(i=0;i<237;i++){
-        SPI_Write(0, 0x3, i<<2, dat[i]);
+        SPI_Burst_Write(&burst, 0, 0x3, i<<2, dat[i]);
     }
 
     /*SPI_Write(0, 0x6, 0xFF0, 0x00000001);
@@ -429,464 +589,492 @@ void DM6302_M0()
         SPI_Write(0, 0x3, i<<2, dat[i]);
     }*/
 
-    SPI_Write(0, 0x6, 0x7FC, 0x00000000);
+    SPI_Burst_Write(&burst, 0, 0x6, 0x7FC, 0x00000000);
     //SPI_Write(0, 0x6, 0x7FC, 0x00000001);
+    SPI_Burst_End(&burst);
 }
 
+static const dm6302_prog_t dm6302_init0[] = {
+    //00_INIT
+    {DM_W,     0x6, 0x7FC, 0x00000000},
+    {DM_W,     0x6, 0xF1C, 0x00000001},
+    {DM_W,     0x6, 0xF20, 0x0000FCD0},
+    {DM_W,     0x6, 0xF04, 0x00004741}, //0x00004741
+    {DM_FORCE, 0x6, 0xF08, 0x00000083},
+    {DM_FORCE, 0x6, 0xF08, 0x000000C3},
+    {DM_W,     0x6, 0xF24, 0x00007000}, //0x00007000
+    {DM_FORCE, 0x6, 0xF40, 0x00000003},
+    {DM_FORCE, 0x6, 0xF40, 0x00000001},
+    {DM_FORCE, 0x6, 0xFFC, 0x00000000},
+    {DM_FORCE, 0x6, 0xFFC, 0x00000001},
+    {DM_W,     0x6, 0xFF0, 0x00000018},
+};
+
 void DM6302_Init0(uint8_t sel)
 {
-    //00_INIT
-    SPI_Write(sel, 0x6, 0x7FC, 0x00000000);
-    SPI_Write(sel, 0x6, 0xF1C, 0x00000001);
-    SPI_Write(sel, 0x6, 0xF20, 0x0000FCD0);
-    SPI_Write(sel, 0x6, 0xF04, 0x00004741); //0x00004741
-    SPI_Write(sel, 0x6, 0xF08, 0x00000083);
-    SPI_Write(sel, 0x6, 0xF08, 0x000000C3);
-    SPI_Write(sel, 0x6, 0xF24, 0x00007000); //0x00007000
-    SPI_Write(sel, 0x6, 0xF40, 0x00000003);
-    SPI_Write(sel, 0x6, 0xF40, 0x00000001);
-    SPI_Write(sel, 0x6, 0xFFC, 0x00000000);
-    SPI_Write(sel, 0x6, 0xFFC, 0x00000001);
-    SPI_Write(sel, 0x6, 0xFF0, 0x00000018);
+    DM6302_run(sel, dm6302_init0, PROG_LEN(dm6302_init0), 0);
 }
 
+static const dm6302_prog_t dm6302_init1[] = {
+    //01_BB_PLL_3456
+    {DM_W,     0x6, 0xFF0, 0x00000018},
+    {DM_W,     0x3, 0x2ac, 0x00000300},
+    {DM_W,     0x3, 0x2B0, 0x00077777}, //dcxo_pathbuf_sel
+    {DM_W,     0x3, 0x230, 0x00000000},
+    {DM_W,     0x3, 0x234, 0x10000000},
+    {DM_W,     0x3, 0x238, 0x000000BF},
+    {DM_W,     0x3, 0x23C, 0x73530610}, //55530610,
+    {DM_FORCE, 0x3, 0x240, 0x3FFC0047},
+    {DM_FORCE, 0x3, 0x244, 0x00188A13},
+    {DM_FORCE, 0x3, 0x248, 0x00000000},
+    {DM_W,     0x3, 0x24C, 0x0A121707},
+    {DM_W,     0x3, 0x250, 0x017F0001},
+    {DM_W,     0x3, 0x228, 0x0000807A}, //coarse tune freq calibra
+    {DM_W,     0x3, 0x220, 0x00002AE4},
+    {DM_FORCE, 0x3, 0x21C, 0x00000002},
+    {DM_FORCE, 0x3, 0x218, 0x00000001},
+    {DM_FORCE, 0x3, 0x218, 0x00000000},
+    {DM_W,     0x3, 0x228, 0x0000807A}, //fine tune freq calibra
+    {DM_W,     0x3, 0x220, 0x00002AE4},
+    {DM_FORCE, 0x3, 0x21C, 0x00000003},
+    {DM_FORCE, 0x3, 0x218, 0x00000001},
+    {DM_FORCE, 0x3, 0x218, 0x00000000},
+    {DM_FORCE, 0x3, 0x244, 0x00188A17},
+    {DM_W,     0x3, 0x204, 0x0000002D}, //int div ratio
+    {DM_W,     0x3, 0x208, 0x00000000}, //fracn div ratio
+    {DM_FORCE, 0x3, 0x200, 0x00000000}, //sdm en
+    {DM_FORCE, 0x3, 0x200, 0x00000003},
+    {DM_FORCE, 0x3, 0x240, 0x00030041}, //pll close loop
+    {DM_FORCE, 0x3, 0x248, 0x00000404},
+};
+
 void DM6302_Init1(uint8_t sel)
 {
-    //01_BB_PLL_3456
-    SPI_Write(sel, 0x6, 0xFF0, 0x00000018);
-    SPI_Write(sel, 0x3, 0x2ac, 0x00000300);
-    SPI_Write(sel, 0x3, 0x2B0, 0x00077777);//dcxo_pathbuf_sel
-    SPI_Write(sel, 0x3, 0x230, 0x00000000);
-    SPI_Write(sel, 0x3, 0x234, 0x10000000);
-    SPI_Write(sel, 0x3, 0x238, 0x000000BF);
-    SPI_Write(sel, 0x3, 0x23C, 0x73530610);//55530610,
-    SPI_Write(sel, 0x3, 0x240, 0x3FFC0047);
-    SPI_Write(sel, 0x3, 0x244, 0x00188A13);
-    SPI_Write(sel, 0x3, 0x248, 0x00000000);
-    SPI_Write(sel, 0x3, 0x24C, 0x0A121707);
-    SPI_Write(sel, 0x3, 0x250, 0x017F0001);
-    SPI_Write(sel, 0x3, 0x228, 0x0000807A);//coarse tune freq calibra
-    SPI_Write(sel, 0x3, 0x220, 0x00002AE4);
-    SPI_Write(sel, 0x3, 0x21C, 0x00000002);
-    SPI_Write(sel, 0x3, 0x218, 0x00000001);
-    SPI_Write(sel, 0x3, 0x218, 0x00000000);
-    SPI_Write(sel, 0x3, 0x228, 0x0000807A);//fine tune freq calibra
-    SPI_Write(sel, 0x3, 0x220, 0x00002AE4);
-    SPI_Write(sel, 0x3, 0x21C, 0x00000003);
-    SPI_Write(sel, 0x3, 0x218, 0x00000001);
-    SPI_Write(sel, 0x3, 0x218, 0x00000000);
-    SPI_Write(sel, 0x3, 0x244, 0x00188A17);
-    SPI_Write(sel, 0x3, 0x204, 0x0000002D);//int div ratio
-    SPI_Write(sel, 0x3, 0x208, 0x00000000);//fracn div ratio
-    SPI_Write(sel, 0x3, 0x200, 0x00000000);//sdm en
-    SPI_Write(sel, 0x3, 0x200, 0x00000003);
-    SPI_Write(sel, 0x3, 0x240, 0x00030041);//pll close loop
-    SPI_Write(sel, 0x3, 0x248, 0x00000404);
+    DM6302_run(sel, dm6302_init1, PROG_LEN(dm6302_init1), 0);
 }
 
 void DM6302_Init2(uint8_t sel, uint8_t freq)
 {
-    //02_RX1_PLL_11316(5658MHz)
-    SPI_Write(sel, 0x6, 0xFF0, 0x00000018);
-    SPI_Write(sel, 0x3, 0x130, 0x00000013); //0x00000013 10
-    SPI_Write(sel, 0x3, 0x134, 0x00000013);
-    SPI_Write(sel, 0x3, 0x138, 0x00000370);
-    SPI_Write(sel, 0x3, 0x13C, 0x00000410);
-    SPI_Write(sel, 0x3, 0x140, 0x00000000);
-    SPI_Write(sel, 0x3, 0x144, 0x0D640735);
-    SPI_Write(sel, 0x3, 0x148, 0x01017F03);
-    SPI_Write(sel, 0x3, 0x14C, 0x022288A2); //0x021288A2
-    SPI_Write(sel, 0x3, 0x150, 0x00FFCF33); //0x00FFCF33
-    SPI_Write(sel, 0x3, 0x154, 0x1F0C3440); //0x1F3C3C40 0x1F0C3440
-    SPI_Write(sel, 0x3, 0x128, 0x00008030);
-    SPI_Write(sel, 0x3, 0x120, tab[0][freq]);  //ch
-    SPI_Write(sel, 0x3, 0x11C, 0x00000002);
-    SPI_Write(sel, 0x3, 0x118, 0x00000001);
-    SPI_Write(sel, 0x3, 0x118, 0x00000000);
-    SPI_Write(sel, 0x3, 0x128, 0x00008030);
-    SPI_Write(sel, 0x3, 0x120, tab[0][freq]);  //ch
-    SPI_Write(sel, 0x3, 0x11C, 0x00000003);
-    SPI_Write(sel, 0x3, 0x118, 0x00000001);
-    SPI_Write(sel, 0x3, 0x118, 0x00000000);
-    SPI_Write(sel, 0x3, 0x150, 0x00FFCFB3);
-    SPI_Write(sel, 0x3, 0x104, tab[1][freq]);  //ch
-    SPI_Write(sel, 0x3, 0x108, tab[2][freq]);  //ch
-    SPI_Write(sel, 0x3, 0x100, 0x00000000);
-    SPI_Write(sel, 0x3, 0x100, 0x00000003);
-    SPI_Write(sel, 0x3, 0x150, 0x000333B3);
-    SPI_Write(sel, 0x3, 0x140, 0x07070000);
-    SPI_Write(sel, 0x3, 0x130, 0x00000010);
+    DM6302_run(sel, dm6302_rx1_pll, PROG_LEN(dm6302_rx1_pll), freq);
 }
 
+static const dm6302_prog_t dm6302_init3[] = {
+    //03_RX1_RF
+    {DM_W,     0x6, 0xFF0, 0x00000018},
+    {DM_W,     0x3, 0x480, 0x60FFFFFF},
+    {DM_W,     0x3, 0x484, 0xFFFFF7FF},
+    {DM_W,     0x3, 0x488, 0x0FFF7FE0}, //0x0FFF7FE0
+    {DM_W,     0x3, 0x48C, 0x00000001},
+    {DM_W,     0x3, 0x490, 0x34460E01},
+    {DM_W,     0x3, 0x494, 0x066727CC}, //0x066427CC
+    {DM_W,     0x3, 0x498, 0x00000002}, //0x00001020
+    {DM_W,     0x3, 0x49C, 0x00001020},
+    {DM_W,     0x3, 0x4A0, 0x00001020},
+    {DM_W,     0x3, 0x4A4, 0x00001030},
+    {DM_W,     0x3, 0x4A8, 0x00001030},
+    {DM_W,     0x3, 0x4AC, 0x8102040D},
+    {DM_W,     0x3, 0x4B0, 0x00000964},
+    {DM_W,     0x3, 0x4B4, 0x00000000},
+    {DM_W,     0x3, 0x4B8, 0x00000000},
+};
+
 void DM6302_Init3(uint8_t sel)
 {
-    //03_RX1_RF
-    SPI_Write(sel, 0x6, 0xFF0, 0x00000018);
-    SPI_Write(sel, 0x3, 0x480, 0x60FFFFFF);
-    SPI_Write(sel, 0x3, 0x484, 0xFFFFF7FF);
-    SPI_Write(sel, 0x3, 0x488, 0x0FFF7FE0);//0x0FFF7FE0
-    SPI_Write(sel, 0x3, 0x48C, 0x00000001);
-    SPI_Write(sel, 0x3, 0x490, 0x34460E01);
-    SPI_Write(sel, 0x3, 0x494, 0x066727CC);//0x066427CC
-    SPI_Write(sel, 0x3, 0x498, 0x00000002);//0x00001020
-    SPI_Write(sel, 0x3, 0x49C, 0x00001020);
-    SPI_Write(sel, 0x3, 0x4A0, 0x00001020);
-    SPI_Write(sel, 0x3, 0x4A4, 0x00001030);
-    SPI_Write(sel, 0x3, 0x4A8, 0x00001030);
-    SPI_Write(sel, 0x3, 0x4AC, 0x8102040D);
-    SPI_Write(sel, 0x3, 0x4B0, 0x00000964);
-    SPI_Write(sel, 0x3, 0x4B4, 0x00000000);
-    SPI_Write(sel, 0x3, 0x4B8, 0x00000000);
+    DM6302_run(sel, dm6302_init3, PROG_LEN(dm6302_init3), 0);
 }
 
+static const dm6302_prog_t dm6302_init4[] = {
+    //04_RX1_BBF
+    {DM_W,     0x6, 0xFF0, 0x00000018},
+    {DM_W,     0x3, 0x500, 0x0F85FF49},
+    {DM_W,     0x3, 0x504, 0x1488809A},
+    {DM_W,     0x3, 0x508, 0x1488809A},
+    {DM_W,     0x3, 0x50C, 0x1F616110},
+    {DM_W,     0x3, 0x510, 0x00040C49},
+    {DM_W,     0x3, 0x514, 0x11846130},
+    {DM_W,     0x3, 0x518, 0x01B86E39},
+    {DM_W,     0x3, 0x51C, 0x01F07C41},
+    {DM_W,     0x3, 0x520, 0x02288A4B},
+    {DM_W,     0x3, 0x524, 0x026C9B55},
+    {DM_W,     0x3, 0x528, 0x82B8AE62},
+    {DM_W,     0x3, 0x52C, 0x1310C470},
+    {DM_W,     0x3, 0x530, 0x60300301},
+    {DM_W,     0x3, 0x534, 0x40610613},
+    {DM_W,     0x3, 0x538, 0x00C40C47},
+    {DM_W,     0x3, 0x53C, 0x0188188F},
+    {DM_W,     0x3, 0x540, 0x00010B00},
+    {DM_W,     0x3, 0x544, 0x00090900},
+    {DM_W,     0x3, 0x548, 0x0000000A},
+    {DM_W,     0x3, 0x54C, 0x00000000},
+    {DM_W,     0x3, 0x550, 0x0000002F},
+    {DM_W,     0x3, 0x554, 0x00000100},
+    {DM_W,     0x3, 0x55C, 0x00000000},
+    {DM_W,     0x3, 0x560, 0x00000000},
+    {DM_W,     0x3, 0x564, 0x00000007},
+    {DM_W,     0x3, 0x568, 0x00000000},
+};
+
 void DM6302_Init4(uint8_t sel)
 {
-    //04_RX1_BBF
-    SPI_Write(sel, 0x6, 0xFF0, 0x00000018);
-    SPI_Write(sel, 0x3, 0x500, 0x0F85FF49);
-    SPI_Write(sel, 0x3, 0x504, 0x1488809A);
-    SPI_Write(sel, 0x3, 0x508, 0x1488809A);
-    SPI_Write(sel, 0x3, 0x50C, 0x1F616110);
-    SPI_Write(sel, 0x3, 0x510, 0x00040C49);
-    SPI_Write(sel, 0x3, 0x514, 0x11846130);
-    SPI_Write(sel, 0x3, 0x518, 0x01B86E39);
-    SPI_Write(sel, 0x3, 0x51C, 0x01F07C41);
-    SPI_Write(sel, 0x3, 0x520, 0x02288A4B);
-    SPI_Write(sel, 0x3, 0x524, 0x026C9B55);
-    SPI_Write(sel, 0x3, 0x528, 0x82B8AE62);
-    SPI_Write(sel, 0x3, 0x52C, 0x1310C470);
-    SPI_Write(sel, 0x3, 0x530, 0x60300301);
-    SPI_Write(sel, 0x3, 0x534, 0x40610613);
-    SPI_Write(sel, 0x3, 0x538, 0x00C40C47);
-    SPI_Write(sel, 0x3, 0x53C, 0x0188188F);
-    SPI_Write(sel, 0x3, 0x540, 0x00010B00);
-    SPI_Write(sel, 0x3, 0x544, 0x00090900);
-    SPI_Write(sel, 0x3, 0x548, 0x0000000A);
-    SPI_Write(sel, 0x3, 0x54C, 0x00000000);
-    SPI_Write(sel, 0x3, 0x550, 0x0000002F);
-    SPI_Write(sel, 0x3, 0x554, 0x00000100);
-    SPI_Write(sel, 0x3, 0x55C, 0x00000000);
-    SPI_Write(sel, 0x3, 0x560, 0x00000000);
-    SPI_Write(sel, 0x3, 0x564, 0x00000007);
-    SPI_Write(sel, 0x3, 0x568, 0x00000000);
+    DM6302_run(sel, dm6302_init4, PROG_LEN(dm6302_init4), 0);
 }
 
+static const dm6302_prog_t dm6302_init5[] = {
+    //05_RX1_ADC
+    {DM_W,     0x6, 0xFF0, 0x00000018},
+    {DM_W,     0x3, 0x728, 0xFFFFFFFE},
+    {DM_W,     0x3, 0x72C, 0x22C42273},
+    {DM_W,     0x3, 0x730, 0x141E81E8},
+    {DM_W,     0x3, 0x734, 0x0040B1E8},
+    {DM_W,     0x3, 0x738, 0x22C42273},
+    {DM_W,     0x3, 0x73C, 0x141E81E8},
+    {DM_W,     0x3, 0x740, 0x0040B1E8},
+    {DM_W,     0x3, 0x744, 0x00A20001},
+    {DM_W,     0x3, 0x748, 0x00004400},
+    {DM_W,     0x3, 0x74C, 0x00000000},
+};
+
 void DM6302_Init5(uint8_t sel)
 {
-    //05_RX1_ADC
-    SPI_Write(sel,  0x6, 0xFF0, 0x00000018);
-    SPI_Write(sel, 0x3, 0x728, 0xFFFFFFFE);
-    SPI_Write(sel, 0x3, 0x72C, 0x22C42273);
-    SPI_Write(sel, 0x3, 0x730, 0x141E81E8);
-    SPI_Write(sel, 0x3, 0x734, 0x0040B1E8);
-    SPI_Write(sel, 0x3, 0x738, 0x22C42273);
-    SPI_Write(sel, 0x3, 0x73C, 0x141E81E8);
-    SPI_Write(sel, 0x3, 0x740, 0x0040B1E8);
-    SPI_Write(sel, 0x3, 0x744, 0x00A20001);
-    SPI_Write(sel, 0x3, 0x748, 0x00004400);
-    SPI_Write(sel, 0x3, 0x74C, 0x00000000);
+    DM6302_run(sel, dm6302_init5, PROG_LEN(dm6302_init5), 0);
 }
 
+static const dm6302_prog_t dm6302_init6[] = {
+    //06_RX1_DFE
+    {DM_W,     0x6, 0xFF0, 0x00000019},
+    {DM_W,     0x3, 0x0E4, 0x0000000C},
+    {DM_W,     0x3, 0x0E8, 0x00000003},
+
+    {DM_W,     0x6, 0xFF0, 0x00000018},
+    {DM_W,     0x3, 0x254, 0x0055780F}, //ADC1=ADC2=3456/8=432
+    {DM_W,     0x3, 0x258, 0x00010002}, //RBDP=3456/8=432
+    {DM_W,     0x3, 0x908, 0x001FFF03}, //0x001FFF03
+    {DM_W,     0x3, 0x90C, 0xDE07E0F0}, //ADC=432/2,FBCLK=ADC/4=54  0xDE07E0F0
+    {DM_W,     0x3, 0x880, 0x0000001C}, //GAIN
+    {DM_W,     0x3, 0x938, 0x00000082}, //AGC 0x00000082
+};
+
 void DM6302_Init6(uint8_t sel)
 {
-    //06_RX1_DFE
-    SPI_Write(sel, 0x6, 0xFF0, 0x00000019);
-    SPI_Write(sel, 0x3, 0x0E4, 0x0000000C);
-    SPI_Write(sel, 0x3, 0x0E8, 0x00000003);
-
-    SPI_Write(sel, 0x6, 0xFF0, 0x00000018);
-    SPI_Write(sel, 0x3, 0x254, 0x0055780F); //ADC1=ADC2=3456/8=432
-    SPI_Write(sel, 0x3, 0x258, 0x00010002); //RBDP=3456/8=432
-    SPI_Write(sel, 0x3, 0x908, 0x001FFF03); //0x001FFF03
-    SPI_Write(sel, 0x3, 0x90C, 0xDE07E0F0); //ADC=432/2,FBCLK=ADC/4=54  0xDE07E0F0
-    SPI_Write(sel, 0x3, 0x880, 0x0000001C); //GAIN
-    SPI_Write(sel, 0x3, 0x938, 0x00000082); //AGC 0x00000082
+    DM6302_run(sel, dm6302_init6, PROG_LEN(dm6302_init6), 0);
 }
 
+static const dm6302_prog_t dm6302_init7[] = {
+    //07_RX1_FIR
+    {DM_W,     0x6, 0xFF0, 0x00000018},
+    {DM_W,     0x3, 0x800, 0x000E000A},
+    {DM_W,     0x3, 0x804, 0xFFEFFFF4},
+    {DM_W,     0x3, 0x808, 0x00140010},
+    {DM_W,     0x3, 0x80C, 0xFFE9FFEA},
+    {DM_W,     0x3, 0x810, 0x0018001D},
+    {DM_W,     0x3, 0x814, 0xFFE7FFDA},
+    {DM_W,     0x3, 0x818, 0x0018002F},
+    {DM_W,     0x3, 0x81C, 0xFFEAFFC5},
+    {DM_W,     0x3, 0x820, 0x00110047},
+    {DM_W,     0x3, 0x824, 0xFFF6FFAC},
+    {DM_W,     0x3, 0x828, 0x00000062},
+    {DM_W,     0x3, 0x82C, 0x000DFF8F},
+    {DM_W,     0x3, 0x830, 0xFFE3007F},
+    {DM_W,     0x3, 0x834, 0x0032FF73},
+    {DM_W,     0x3, 0x838, 0xFFB6009B},
+    {DM_W,     0x3, 0x83C, 0x0068FF59},
+    {DM_W,     0x3, 0x840, 0xFF7600B0},
+    {DM_W,     0x3, 0x844, 0x00B1FF49},
+    {DM_W,     0x3, 0x848, 0xFF2100BA},
+    {DM_W,     0x3, 0x84C, 0x0112FF48},
+    {DM_W,     0x3, 0x850, 0xFEB400B0},
+    {DM_W,     0x3, 0x854, 0x018EFF5F},
+    {DM_W,     0x3, 0x858, 0xFE280089},
+    {DM_W,     0x3, 0x85C, 0x022EFF9B},
+    {DM_W,     0x3, 0x860, 0xFD6E0032},
+    {DM_W,     0x3, 0x864, 0x030A0015},
+    {DM_W,     0x3, 0x868, 0xFC5EFF87},
+    {DM_W,     0x3, 0x86C, 0x046E0109},
+    {DM_W,     0x3, 0x870, 0xFA61FE1B},
+    {DM_W,     0x3, 0x874, 0x07BB035C},
+    {DM_W,     0x3, 0x878, 0xF304F990},
+    {DM_W,     0x3, 0x87C, 0x3B341183},
+};
+
 void DM6302_Init7(uint8_t sel)
 {
-    //07_RX1_FIR
-    SPI_Write(sel, 0x6, 0xFF0, 0x00000018);
-    SPI_Write(sel, 0x3, 0x800, 0x000E000A);
-    SPI_Write(sel, 0x3, 0x804, 0xFFEFFFF4);
-    SPI_Write(sel, 0x3, 0x808, 0x00140010);
-    SPI_Write(sel, 0x3, 0x80C, 0xFFE9FFEA);
-    SPI_Write(sel, 0x3, 0x810, 0x0018001D);
-    SPI_Write(sel, 0x3, 0x814, 0xFFE7FFDA);
-    SPI_Write(sel, 0x3, 0x818, 0x0018002F);
-    SPI_Write(sel, 0x3, 0x81C, 0xFFEAFFC5);
-    SPI_Write(sel, 0x3, 0x820, 0x00110047);
-    SPI_Write(sel, 0x3, 0x824, 0xFFF6FFAC);
-    SPI_Write(sel, 0x3, 0x828, 0x00000062);
-    SPI_Write(sel, 0x3, 0x82C, 0x000DFF8F);
-    SPI_Write(sel, 0x3, 0x830, 0xFFE3007F);
-    SPI_Write(sel, 0x3, 0x834, 0x0032FF73);
-    SPI_Write(sel, 0x3, 0x838, 0xFFB6009B);
-    SPI_Write(sel, 0x3, 0x83C, 0x0068FF59);
-    SPI_Write(sel, 0x3, 0x840, 0xFF7600B0);
-    SPI_Write(sel, 0x3, 0x844, 0x00B1FF49);
-    SPI_Write(sel, 0x3, 0x848, 0xFF2100BA);
-    SPI_Write(sel, 0x3, 0x84C, 0x0112FF48);
-    SPI_Write(sel, 0x3, 0x850, 0xFEB400B0);
-    SPI_Write(sel, 0x3, 0x854, 0x018EFF5F);
-    SPI_Write(sel, 0x3, 0x858, 0xFE280089);
-    SPI_Write(sel, 0x3, 0x85C, 0x022EFF9B);
-    SPI_Write(sel, 0x3, 0x860, 0xFD6E0032);
-    SPI_Write(sel, 0x3, 0x864, 0x030A0015);
-    SPI_Write(sel, 0x3, 0x868, 0xFC5EFF87);
-    SPI_Write(sel, 0x3, 0x86C, 0x046E0109);
-    SPI_Write(sel, 0x3, 0x870, 0xFA61FE1B);
-    SPI_Write(sel, 0x3, 0x874, 0x07BB035C);
-    SPI_Write(sel, 0x3, 0x878, 0xF304F990);
-    SPI_Write(sel, 0x3, 0x87C, 0x3B341183);
+    DM6302_run(sel, dm6302_init7, PROG_LEN(dm6302_init7), 0);
 }
 
+static const dm6302_prog_t dm6302_init8[] = {
+    //08_RX1_AGC
+    {DM_W,     0x6, 0xFF0, 0x00000018},
+    {DM_W,     0x3, 0x880, 0x003C001C},
+    {DM_W,     0x3, 0x884, 0x007C005C},
+    {DM_W,     0x3, 0x888, 0x00BC009C},
+    {DM_W,     0x3, 0x88C, 0x013C011C},
+    {DM_W,     0x3, 0x890, 0x017C015C},
+    {DM_W,     0x3, 0x894, 0x01BC019C},
+    {DM_W,     0x3, 0x898, 0x023C01DC},
+    {DM_W,     0x3, 0x89C, 0x027C025C},
+    {DM_W,     0x3, 0x8A0, 0x02BC029C},
+    {DM_W,     0x3, 0x8A4, 0x033C02DC},
+    {DM_W,     0x3, 0x8A8, 0x037C035C},
+    {DM_W,     0x3, 0x8AC, 0x03BC039C},
+    {DM_W,     0x3, 0x8B0, 0x033403DC},
+    {DM_W,     0x3, 0x8B4, 0x03740354},
+    {DM_W,     0x3, 0x8B8, 0x03B40394},
+    {DM_W,     0x3, 0x8BC, 0x032C03D4},
+    {DM_W,     0x3, 0x8C0, 0x036C034C},
+    {DM_W,     0x3, 0x8C4, 0x03AC038C},
+    {DM_W,     0x3, 0x8C8, 0x032403CC},
+    {DM_W,     0x3, 0x8CC, 0x03640344},
+    {DM_W,     0x3, 0x8D0, 0x03A40384},
+    {DM_W,     0x3, 0x8D4, 0x038303C4},
+    {DM_W,     0x3, 0x8D8, 0x03C303A3},
+    {DM_W,     0x3, 0x8DC, 0x03A20382},
+    {DM_W,     0x3, 0x8E0, 0x032103C2},
+    {DM_W,     0x3, 0x8E4, 0x03610341},
+    {DM_W,     0x3, 0x8E8, 0x03A10381},
+    {DM_W,     0x3, 0x8EC, 0x032003C1},
+    {DM_W,     0x3, 0x8F0, 0x03600340},
+    {DM_W,     0x3, 0x8F4, 0x03A00380},
+    {DM_W,     0x3, 0x8F8, 0x03C103C0},
+    {DM_FORCE, 0x3, 0x8FC, 0x03C303C2},
+    {DM_FORCE, 0x3, 0x8FC, 0x03C503C4},
+    {DM_W,     0x3, 0x900, 0x03C703C6},
+    {DM_W,     0x3, 0x904, 0x03C903C8},
+    {DM_W,     0x3, 0x93C, 0x0001FF00}, //0x0002FF00
+    {DM_W,     0x3, 0x944, 0x00004300},
+    {DM_W,     0x3, 0x948, 0x00010000}, //0x00001000
+    {DM_W,     0x3, 0x958, 0x00FCFE00}, //0x00FCFE00
+    {DM_W,     0x3, 0x960, 0x0000B278}, //0x0000B260
+    {DM_W,     0x3, 0x938, 0x0000100A}, //0x0000101A
+    {DM_W,     0x3, 0x968, 0x00000020},
+    {DM_W,     0x3, 0x974, 0x0058001F},
+    {DM_W,     0x3, 0x978, 0x00000000},
+    {DM_W,     0x3, 0x52C, 0x1310C470},
+    {DM_W,     0x3, 0x530, 0x98300301},
+    {DM_W,     0x3, 0x534, 0x40610613},
+    {DM_W,     0x3, 0x4B0, 0x00000964},
+    {DM_W,     0x3, 0x970, 0x0000003F},
+    {DM_W,     0x3, 0x940, 0x00050A0A},
+    {DM_W,     0x3, 0x94C, 0x10001000},
+};
+
 void DM6302_Init8(uint8_t sel)
 {
-    //08_RX1_AGC
-    SPI_Write(sel, 0x6, 0xFF0, 0x00000018);
-    SPI_Write(sel, 0x3, 0x880, 0x003C001C);
-    SPI_Write(sel, 0x3, 0x884, 0x007C005C);
-    SPI_Write(sel, 0x3, 0x888, 0x00BC009C);
-    SPI_Write(sel, 0x3, 0x88C, 0x013C011C);
-    SPI_Write(sel, 0x3, 0x890, 0x017C015C);
-    SPI_Write(sel, 0x3, 0x894, 0x01BC019C);
-    SPI_Write(sel, 0x3, 0x898, 0x023C01DC);
-    SPI_Write(sel, 0x3, 0x89C, 0x027C025C);
-    SPI_Write(sel, 0x3, 0x8A0, 0x02BC029C);
-    SPI_Write(sel, 0x3, 0x8A4, 0x033C02DC);
-    SPI_Write(sel, 0x3, 0x8A8, 0x037C035C);
-    SPI_Write(sel, 0x3, 0x8AC, 0x03BC039C);
-    SPI_Write(sel, 0x3, 0x8B0, 0x033403DC);
-    SPI_Write(sel, 0x3, 0x8B4, 0x03740354);
-    SPI_Write(sel, 0x3, 0x8B8, 0x03B40394);
-    SPI_Write(sel, 0x3, 0x8BC, 0x032C03D4);
-    SPI_Write(sel, 0x3, 0x8C0, 0x036C034C);
-    SPI_Write(sel, 0x3, 0x8C4, 0x03AC038C);
-    SPI_Write(sel, 0x3, 0x8C8, 0x032403CC);
-    SPI_Write(sel, 0x3, 0x8CC, 0x03640344);
-    SPI_Write(sel, 0x3, 0x8D0, 0x03A40384);
-    SPI_Write(sel, 0x3, 0x8D4, 0x038303C4);
-    SPI_Write(sel, 0x3, 0x8D8, 0x03C303A3);
-    SPI_Write(sel, 0x3, 0x8DC, 0x03A20382);
-    SPI_Write(sel, 0x3, 0x8E0, 0x032103C2);
-    SPI_Write(sel, 0x3, 0x8E4, 0x03610341);
-    SPI_Write(sel, 0x3, 0x8E8, 0x03A10381);
-    SPI_Write(sel, 0x3, 0x8EC, 0x032003C1);
-    SPI_Write(sel, 0x3, 0x8F0, 0x03600340);
-    SPI_Write(sel, 0x3, 0x8F4, 0x03A00380);
-    SPI_Write(sel, 0x3, 0x8F8, 0x03C103C0);
-    SPI_Write(sel, 0x3, 0x8FC, 0x03C303C2);
-    SPI_Write(sel, 0x3, 0x8FC, 0x03C503C4);
-    SPI_Write(sel, 0x3, 0x900, 0x03C703C6);
-    SPI_Write(sel, 0x3, 0x904, 0x03C903C8);
-    SPI_Write(sel, 0x3, 0x93C, 0x0001FF00); //0x0002FF00
-    SPI_Write(sel, 0x3, 0x944, 0x00004300);
-    SPI_Write(sel, 0x3, 0x948, 0x00010000); //0x00001000
-    SPI_Write(sel, 0x3, 0x958, 0x00FCFE00); //0x00FCFE00
-    SPI_Write(sel, 0x3, 0x960, 0x0000B278); //0x0000B260
-    SPI_Write(sel, 0x3, 0x938, 0x0000100A); //0x0000101A
-    SPI_Write(sel, 0x3, 0x968, 0x00000020);
-    SPI_Write(sel, 0x3, 0x974, 0x0058001F);
-    SPI_Write(sel, 0x3, 0x978, 0x00000000);
-    SPI_Write(sel, 0x3, 0x52C, 0x1310C470);
-    SPI_Write(sel, 0x3, 0x530, 0x98300301);
-    SPI_Write(sel, 0x3, 0x534, 0x40610613);
-    SPI_Write(sel, 0x3, 0x4B0, 0x00000964);
-    SPI_Write(sel, 0x3, 0x970, 0x0000003F);
-    SPI_Write(sel, 0x3, 0x940, 0x00050A0A);
-    SPI_Write(sel, 0x3, 0x94C, 0x10001000);
+    DM6302_run(sel, dm6302_init8, PROG_LEN(dm6302_init8), 0);
 }
 
+static const dm6302_prog_t dm6302_init9[] = {
+    //09_RX2_RF
+    {DM_W,     0x6, 0xFF0, 0x00000018},
+    {DM_W,     0x3, 0x4C0, 0x6000F001},
+    {DM_W,     0x3, 0x4C4, 0x00000000},
+    {DM_W,     0x3, 0x4C8, 0x00006048},
+    {DM_W,     0x3, 0x4CC, 0x00000001},
+    {DM_W,     0x3, 0x4D0, 0x34460E01},
+    {DM_W,     0x3, 0x4D4, 0x066727CC}, //0x066427CC
+    {DM_W,     0x3, 0x4D8, 0x00000002}, //0x00001020
+    {DM_W,     0x3, 0x4DC, 0x00001020},
+    {DM_W,     0x3, 0x4E0, 0x00001020},
+    {DM_W,     0x3, 0x4E4, 0x00001030},
+    {DM_W,     0x3, 0x4E8, 0x00001030},
+    {DM_W,     0x3, 0x4EC, 0x8102040D},
+    {DM_W,     0x3, 0x4F0, 0x00000964},
+    {DM_W,     0x3, 0x4F4, 0x00000000},
+    {DM_W,     0x3, 0x4F8, 0x00000000},
+};
+
 void DM6302_Init9(uint8_t sel)
 {
-    //09_RX2_RF
-    SPI_Write(sel, 0x6, 0xFF0, 0x00000018);
-    SPI_Write(sel, 0x3, 0x4C0, 0x6000F001);
-    SPI_Write(sel, 0x3, 0x4C4, 0x00000000);
-    SPI_Write(sel, 0x3, 0x4C8, 0x00006048);
-    SPI_Write(sel, 0x3, 0x4CC, 0x00000001);
-    SPI_Write(sel, 0x3, 0x4D0, 0x34460E01);
-    SPI_Write(sel, 0x3, 0x4D4, 0x066727CC);//0x066427CC
-    SPI_Write(sel, 0x3, 0x4D8, 0x00000002);//0x00001020
-    SPI_Write(sel, 0x3, 0x4DC, 0x00001020);
-    SPI_Write(sel, 0x3, 0x4E0, 0x00001020);
-    SPI_Write(sel, 0x3, 0x4E4, 0x00001030);
-    SPI_Write(sel, 0x3, 0x4E8, 0x00001030);
-    SPI_Write(sel, 0x3, 0x4EC, 0x8102040D);
-    SPI_Write(sel, 0x3, 0x4F0, 0x00000964);
-    SPI_Write(sel, 0x3, 0x4F4, 0x00000000);
-    SPI_Write(sel, 0x3, 0x4F8, 0x00000000);
+    DM6302_run(sel, dm6302_init9, PROG_LEN(dm6302_init9), 0);
 }
 
+static const dm6302_prog_t dm6302_init10[] = {
+    //10_RX2_BBF
+    {DM_W,     0x6, 0xFF0, 0x00000018},
+    {DM_W,     0x3, 0x600, 0x0F85FF49},
+    {DM_W,     0x3, 0x604, 0x1488809A},
+    {DM_W,     0x3, 0x608, 0x1488809A},
+    {DM_W,     0x3, 0x60C, 0x1F616110},
+    {DM_W,     0x3, 0x610, 0x00040C49},
+    {DM_W,     0x3, 0x614, 0x11846130},
+    {DM_W,     0x3, 0x618, 0x01B86E39},
+    {DM_W,     0x3, 0x61C, 0x01F07C41},
+    {DM_W,     0x3, 0x620, 0x02288A4B},
+    {DM_W,     0x3, 0x624, 0x026C9B55},
+    {DM_W,     0x3, 0x628, 0x82B8AE62},
+    {DM_W,     0x3, 0x62C, 0x1310C470},
+    {DM_W,     0x3, 0x630, 0x60300301},
+    {DM_W,     0x3, 0x634, 0x40610613},
+    {DM_W,     0x3, 0x638, 0x00C40C47},
+    {DM_W,     0x3, 0x63C, 0x0188188F},
+    {DM_W,     0x3, 0x640, 0x00010B00},
+    {DM_W,     0x3, 0x644, 0x00090900},
+    {DM_W,     0x3, 0x648, 0x0000000A},
+    {DM_W,     0x3, 0x64C, 0x00000000},
+    {DM_W,     0x3, 0x650, 0x0000002F},
+    {DM_W,     0x3, 0x654, 0x00000100},
+    {DM_W,     0x3, 0x65C, 0x00000000},
+    {DM_W,     0x3, 0x660, 0x00000000},
+    {DM_W,     0x3, 0x664, 0x00000007},
+    {DM_W,     0x3, 0x668, 0x00000000},
+};
+
 void DM6302_Init10(uint8_t sel)
 {
-    //10_RX2_BBF
-    SPI_Write(sel, 0x6, 0xFF0, 0x00000018);
-    SPI_Write(sel, 0x3, 0x600, 0x0F85FF49);
-    SPI_Write(sel, 0x3, 0x604, 0x1488809A);
-    SPI_Write(sel, 0x3, 0x608, 0x1488809A);
-    SPI_Write(sel, 0x3, 0x60C, 0x1F616110);
-    SPI_Write(sel, 0x3, 0x610, 0x00040C49);
-    SPI_Write(sel, 0x3, 0x614, 0x11846130);
-    SPI_Write(sel, 0x3, 0x618, 0x01B86E39);
-    SPI_Write(sel, 0x3, 0x61C, 0x01F07C41);
-    SPI_Write(sel, 0x3, 0x620, 0x02288A4B);
-    SPI_Write(sel, 0x3, 0x624, 0x026C9B55);
-    SPI_Write(sel, 0x3, 0x628, 0x82B8AE62);
-    SPI_Write(sel, 0x3, 0x62C, 0x1310C470);
-    SPI_Write(sel, 0x3, 0x630, 0x60300301);
-    SPI_Write(sel, 0x3, 0x634, 0x40610613);
-    SPI_Write(sel, 0x3, 0x638, 0x00C40C47);
-    SPI_Write(sel, 0x3, 0x63C, 0x0188188F);
-    SPI_Write(sel, 0x3, 0x640, 0x00010B00);
-    SPI_Write(sel, 0x3, 0x644, 0x00090900);
-    SPI_Write(sel, 0x3, 0x648, 0x0000000A);
-    SPI_Write(sel, 0x3, 0x64C, 0x00000000);
-    SPI_Write(sel, 0x3, 0x650, 0x0000002F);
-    SPI_Write(sel, 0x3, 0x654, 0x00000100);
-    SPI_Write(sel, 0x3, 0x65C, 0x00000000);
-    SPI_Write(sel, 0x3, 0x660, 0x00000000);
-    SPI_Write(sel, 0x3, 0x664, 0x00000007);
-    SPI_Write(sel, 0x3, 0x668, 0x00000000);
+    DM6302_run(sel, dm6302_init10, PROG_LEN(dm6302_init10), 0);
 }
 
+static const dm6302_prog_t dm6302_init11[] = {
+    //11_RX2_ADC
+    {DM_W,     0x6, 0xFF0, 0x00000018},
+    {DM_W,     0x3, 0x750, 0xFFFFFFFE},
+    {DM_W,     0x3, 0x754, 0x22C42273},
+    {DM_W,     0x3, 0x758, 0x141E81E8},
+    {DM_W,     0x3, 0x75C, 0x0040B1E8},
+    {DM_W,     0x3, 0x760, 0x22C42273},
+    {DM_W,     0x3, 0x764, 0x141E81E8},
+    {DM_W,     0x3, 0x768, 0x0040B1E8},
+    {DM_W,     0x3, 0x76C, 0x00A20001},
+    {DM_W,     0x3, 0x770, 0x00004400},
+    {DM_W,     0x3, 0x774, 0x00000000},
+};
+
 void DM6302_Init11(uint8_t sel)
 {
-    //11_RX2_ADC
-    SPI_Write(sel, 0x6, 0xFF0, 0x00000018);
-    SPI_Write(sel, 0x3, 0x750, 0xFFFFFFFE);
-    SPI_Write(sel, 0x3, 0x754, 0x22C42273);
-    SPI_Write(sel, 0x3, 0x758, 0x141E81E8);
-    SPI_Write(sel, 0x3, 0x75C, 0x0040B1E8);
-    SPI_Write(sel, 0x3, 0x760, 0x22C42273);
-    SPI_Write(sel, 0x3, 0x764, 0x141E81E8);
-    SPI_Write(sel, 0x3, 0x768, 0x0040B1E8);
-    SPI_Write(sel, 0x3, 0x76C, 0x00A20001);
-    SPI_Write(sel, 0x3, 0x770, 0x00004400);
-    SPI_Write(sel, 0x3, 0x774, 0x00000000);
+    DM6302_run(sel, dm6302_init11, PROG_LEN(dm6302_init11), 0);
 }
 
+static const dm6302_prog_t dm6302_init12[] = {
+    //12_RX2_FIR
+    {DM_W,     0x6, 0xFF0, 0x00000018},
+    {DM_W,     0x3, 0xA00, 0x000E000A},
+    {DM_W,     0x3, 0xA04, 0xFFEFFFF4},
+    {DM_W,     0x3, 0xA08, 0x00140010},
+    {DM_W,     0x3, 0xA0C, 0xFFE9FFEA},
+    {DM_W,     0x3, 0xA10, 0x0018001D},
+    {DM_W,     0x3, 0xA14, 0xFFE7FFDA},
+    {DM_W,     0x3, 0xA18, 0x0018002F},
+    {DM_W,     0x3, 0xA1C, 0xFFEAFFC5},
+    {DM_W,     0x3, 0xA20, 0x00110047},
+    {DM_W,     0x3, 0xA24, 0xFFF6FFAC},
+    {DM_W,     0x3, 0xA28, 0x00000062},
+    {DM_W,     0x3, 0xA2C, 0x000DFF8F},
+    {DM_W,     0x3, 0xA30, 0xFFE3007F},
+    {DM_W,     0x3, 0xA34, 0x0032FF73},
+    {DM_W,     0x3, 0xA38, 0xFFB6009B},
+    {DM_W,     0x3, 0xA3C, 0x0068FF59},
+    {DM_W,     0x3, 0xA40, 0xFF7600B0},
+    {DM_W,     0x3, 0xA44, 0x00B1FF49},
+    {DM_W,     0x3, 0xA48, 0xFF2100BA},
+    {DM_W,     0x3, 0xA4C, 0x0112FF48},
+    {DM_W,     0x3, 0xA50, 0xFEB400B0},
+    {DM_W,     0x3, 0xA54, 0x018EFF5F},
+    {DM_W,     0x3, 0xA58, 0xFE280089},
+    {DM_W,     0x3, 0xA5C, 0x022EFF9B},
+    {DM_W,     0x3, 0xA60, 0xFD6E0032},
+    {DM_W,     0x3, 0xA64, 0x030A0015},
+    {DM_W,     0x3, 0xA68, 0xFC5EFF87},
+    {DM_W,     0x3, 0xA6C, 0x046E0109},
+    {DM_W,     0x3, 0xA70, 0xFA61FE1B},
+    {DM_W,     0x3, 0xA74, 0x07BB035C},
+    {DM_W,     0x3, 0xA78, 0xF304F990},
+    {DM_W,     0x3, 0xA7C, 0x3B341183},
+};
+
 void DM6302_Init12(uint8_t sel)
 {
-    //12_RX2_FIR
-    SPI_Write(sel, 0x6, 0xFF0, 0x00000018);
-    SPI_Write(sel, 0x3, 0xA00, 0x000E000A);
-    SPI_Write(sel, 0x3, 0xA04, 0xFFEFFFF4);
-    SPI_Write(sel, 0x3, 0xA08, 0x00140010);
-    SPI_Write(sel, 0x3, 0xA0C, 0xFFE9FFEA);
-    SPI_Write(sel, 0x3, 0xA10, 0x0018001D);
-    SPI_Write(sel, 0x3, 0xA14, 0xFFE7FFDA);
-    SPI_Write(sel, 0x3, 0xA18, 0x0018002F);
-    SPI_Write(sel, 0x3, 0xA1C, 0xFFEAFFC5);
-    SPI_Write(sel, 0x3, 0xA20, 0x00110047);
-    SPI_Write(sel, 0x3, 0xA24, 0xFFF6FFAC);
-    SPI_Write(sel, 0x3, 0xA28, 0x00000062);
-    SPI_Write(sel, 0x3, 0xA2C, 0x000DFF8F);
-    SPI_Write(sel, 0x3, 0xA30, 0xFFE3007F);
-    SPI_Write(sel, 0x3, 0xA34, 0x0032FF73);
-    SPI_Write(sel, 0x3, 0xA38, 0xFFB6009B);
-    SPI_Write(sel, 0x3, 0xA3C, 0x0068FF59);
-    SPI_Write(sel, 0x3, 0xA40, 0xFF7600B0);
-    SPI_Write(sel, 0x3, 0xA44, 0x00B1FF49);
-    SPI_Write(sel, 0x3, 0xA48, 0xFF2100BA);
-    SPI_Write(sel, 0x3, 0xA4C, 0x0112FF48);
-    SPI_Write(sel, 0x3, 0xA50, 0xFEB400B0);
-    SPI_Write(sel, 0x3, 0xA54, 0x018EFF5F);
-    SPI_Write(sel, 0x3, 0xA58, 0xFE280089);
-    SPI_Write(sel, 0x3, 0xA5C, 0x022EFF9B);
-    SPI_Write(sel, 0x3, 0xA60, 0xFD6E0032);
-    SPI_Write(sel, 0x3, 0xA64, 0x030A0015);
-    SPI_Write(sel, 0x3, 0xA68, 0xFC5EFF87);
-    SPI_Write(sel, 0x3, 0xA6C, 0x046E0109);
-    SPI_Write(sel, 0x3, 0xA70, 0xFA61FE1B);
-    SPI_Write(sel, 0x3, 0xA74, 0x07BB035C);
-    SPI_Write(sel, 0x3, 0xA78, 0xF304F990);
-    SPI_Write(sel, 0x3, 0xA7C, 0x3B341183);
+    DM6302_run(sel, dm6302_init12, PROG_LEN(dm6302_init12), 0);
 }
 
+static const dm6302_prog_t dm6302_init13[] = {
+    //13_RX2_DFE
+    {DM_W,     0x6, 0xFF0, 0x00000019},
+    {DM_W,     0x3, 0x080, 0x1004210C}, //RBDP=432/8,CLKOUT=432/4
+    {DM_W,     0x3, 0x084, 0x00000004},
+    {DM_W,     0x3, 0x088, 0x00000205}, //TDD,2PORT,2T2R 0x00000005
+    {DM_W,     0x3, 0x018, 0xE4F15E3C},
+    {DM_W,     0x3, 0x01C, 0x0001C140},
+    {DM_W,     0x3, 0x020, 0x0000000D},
+
+    {DM_W,     0x6, 0xFF0, 0x00000018},
+    {DM_W,     0x3, 0xB08, 0x001FFF03}, //0x001FFF03
+    {DM_W,     0x3, 0xB0C, 0xDE07E0F0}, //0xDE07E0F0
+    {DM_W,     0x3, 0xA80, 0x0000001C}, //GAIN
+    {DM_W,     0x3, 0xB38, 0x00000082}, //AGC 0x00000082
+};
+
 void DM6302_Init13(uint8_t sel)
 {
-    //13_RX2_DFE
-    SPI_Write(sel, 0x6, 0xFF0, 0x00000019);
-    SPI_Write(sel, 0x3, 0x080, 0x1004210C);//RBDP=432/8,CLKOUT=432/4
-    SPI_Write(sel, 0x3, 0x084, 0x00000004);
-    SPI_Write(sel, 0x3, 0x088, 0x00000205);//TDD,2PORT,2T2R 0x00000005
-    SPI_Write(sel, 0x3, 0x018, 0xE4F15E3C);
-    SPI_Write(sel, 0x3, 0x01C, 0x0001C140);
-    SPI_Write(sel, 0x3, 0x020, 0x0000000D);
-
-    SPI_Write(sel, 0x6, 0xFF0, 0x00000018);
-    SPI_Write(sel, 0x3, 0xB08, 0x001FFF03);//0x001FFF03
-    SPI_Write(sel, 0x3, 0xB0C, 0xDE07E0F0);//0xDE07E0F0
-    SPI_Write(sel, 0x3, 0xA80, 0x0000001C);//GAIN
-    SPI_Write(sel, 0x3, 0xB38, 0x00000082);//AGC 0x00000082
+    DM6302_run(sel, dm6302_init13, PROG_LEN(dm6302_init13), 0);
 }
 
+static const dm6302_prog_t dm6302_init14[] = {
+    //14_RX2_AGC
+    {DM_W,     0x6, 0xFF0, 0x00000018},
+    {DM_W,     0x3, 0xA80, 0x003C001C},
+    {DM_W,     0x3, 0xA84, 0x007C005C},
+    {DM_W,     0x3, 0xA88, 0x00BC009C},
+    {DM_W,     0x3, 0xA8C, 0x013C011C},
+    {DM_W,     0x3, 0xA90, 0x017C015C},
+    {DM_W,     0x3, 0xA94, 0x01BC019C},
+    {DM_W,     0x3, 0xA98, 0x023C01DC},
+    {DM_W,     0x3, 0xA9C, 0x027C025C},
+    {DM_W,     0x3, 0xAA0, 0x02BC029C},
+    {DM_W,     0x3, 0xAA4, 0x033C02DC},
+    {DM_W,     0x3, 0xAA8, 0x037C035C},
+    {DM_W,     0x3, 0xAAC, 0x03BC039C},
+    {DM_W,     0x3, 0xAB0, 0x033403DC},
+    {DM_W,     0x3, 0xAB4, 0x03740354},
+    {DM_W,     0x3, 0xAB8, 0x03B40394},
+    {DM_W,     0x3, 0xABC, 0x032C03D4},
+    {DM_W,     0x3, 0xAC0, 0x036C034C},
+    {DM_W,     0x3, 0xAC4, 0x03AC038C},
+    {DM_W,     0x3, 0xAC8, 0x032403CC},
+    {DM_W,     0x3, 0xACC, 0x03640344},
+    {DM_W,     0x3, 0xAD0, 0x03A40384},
+    {DM_W,     0x3, 0xAD4, 0x038303C4},
+    {DM_W,     0x3, 0xAD8, 0x03C303A3},
+    {DM_W,     0x3, 0xADC, 0x03A20382},
+    {DM_W,     0x3, 0xAE0, 0x032103C2},
+    {DM_W,     0x3, 0xAE4, 0x03610341},
+    {DM_W,     0x3, 0xAE8, 0x03A10381},
+    {DM_W,     0x3, 0xAEC, 0x032003C1},
+    {DM_W,     0x3, 0xAF0, 0x03600340},
+    {DM_W,     0x3, 0xAF4, 0x03A00380},
+    {DM_W,     0x3, 0xAF8, 0x03C103C0},
+    {DM_FORCE, 0x3, 0xAFC, 0x03C303C2},
+    {DM_FORCE, 0x3, 0xAFC, 0x03C503C4},
+    {DM_W,     0x3, 0xB00, 0x03C703C6},
+    {DM_W,     0x3, 0xB04, 0x03C903C8},
+    {DM_W,     0x3, 0xB3C, 0x0001FF00}, //0x0002FF00
+    {DM_W,     0x3, 0xB44, 0x00004300},
+    {DM_W,     0x3, 0xB48, 0x00010000}, //0x00001000
+    {DM_W,     0x3, 0xB58, 0x00FCFE00}, //0x00FCFE00
+    {DM_W,     0x3, 0xB60, 0x0000B278}, //0x0000B260
+    {DM_W,     0x3, 0xB38, 0x0000100A}, //0x0000101A
+    {DM_W,     0x3, 0xB68, 0x00000020},
+    {DM_W,     0x3, 0xB74, 0x0058001F},
+    {DM_W,     0x3, 0xB78, 0x00000000},
+    {DM_W,     0x3, 0x62C, 0x1310C470},
+    {DM_W,     0x3, 0x630, 0x98300301},
+    {DM_W,     0x3, 0x634, 0x40610613},
+    {DM_W,     0x3, 0x4F0, 0x00000964},
+    {DM_W,     0x3, 0xB70, 0x0000003F},
+    {DM_W,     0x3, 0xB40, 0x00050A0A},
+    {DM_W,     0x3, 0xB4C, 0x10001000},
+
+    {DM_W,     0x3, 0x90C, 0x9E22E0F0},
+    {DM_W,     0x3, 0xB0C, 0x9E22E0F0},
+    {DM_W,     0x3, 0x920, 0x00000098},
+    {DM_W,     0x3, 0xB20, 0x00000098},
+    {DM_FORCE, 0x3, 0x908, 0x00000000},
+    {DM_FORCE, 0x3, 0xB08, 0x00000000},
+    {DM_FORCE, 0x3, 0x908, 0x001FFF03},
+    {DM_FORCE, 0x3, 0xB08, 0x001FFF03},
+};
+
 void DM6302_Init14(uint8_t sel)
 {
-    //14_RX2_AGC
-    SPI_Write(sel, 0x6, 0xFF0, 0x00000018);
-    SPI_Write(sel, 0x3, 0xA80, 0x003C001C);
-    SPI_Write(sel, 0x3, 0xA84, 0x007C005C);
-    SPI_Write(sel, 0x3, 0xA88, 0x00BC009C);
-    SPI_Write(sel, 0x3, 0xA8C, 0x013C011C);
-    SPI_Write(sel, 0x3, 0xA90, 0x017C015C);
-    SPI_Write(sel, 0x3, 0xA94, 0x01BC019C);
-    SPI_Write(sel, 0x3, 0xA98, 0x023C01DC);
-    SPI_Write(sel, 0x3, 0xA9C, 0x027C025C);
-    SPI_Write(sel, 0x3, 0xAA0, 0x02BC029C);
-    SPI_Write(sel, 0x3, 0xAA4, 0x033C02DC);
-    SPI_Write(sel, 0x3, 0xAA8, 0x037C035C);
-    SPI_Write(sel, 0x3, 0xAAC, 0x03BC039C);
-    SPI_Write(sel, 0x3, 0xAB0, 0x033403DC);
-    SPI_Write(sel, 0x3, 0xAB4, 0x03740354);
-    SPI_Write(sel, 0x3, 0xAB8, 0x03B40394);
-    SPI_Write(sel, 0x3, 0xABC, 0x032C03D4);
-    SPI_Write(sel, 0x3, 0xAC0, 0x036C034C);
-    SPI_Write(sel, 0x3, 0xAC4, 0x03AC038C);
-    SPI_Write(sel, 0x3, 0xAC8, 0x032403CC);
-    SPI_Write(sel, 0x3, 0xACC, 0x03640344);
-    SPI_Write(sel, 0x3, 0xAD0, 0x03A40384);
-    SPI_Write(sel, 0x3, 0xAD4, 0x038303C4);
-    SPI_Write(sel, 0x3, 0xAD8, 0x03C303A3);
-    SPI_Write(sel, 0x3, 0xADC, 0x03A20382);
-    SPI_Write(sel, 0x3, 0xAE0, 0x032103C2);
-    SPI_Write(sel, 0x3, 0xAE4, 0x03610341);
-    SPI_Write(sel, 0x3, 0xAE8, 0x03A10381);
-    SPI_Write(sel, 0x3, 0xAEC, 0x032003C1);
-    SPI_Write(sel, 0x3, 0xAF0, 0x03600340);
-    SPI_Write(sel, 0x3, 0xAF4, 0x03A00380);
-    SPI_Write(sel, 0x3, 0xAF8, 0x03C103C0);
-    SPI_Write(sel, 0x3, 0xAFC, 0x03C303C2);
-    SPI_Write(sel, 0x3, 0xAFC, 0x03C503C4);
-    SPI_Write(sel, 0x3, 0xB00, 0x03C703C6);
-    SPI_Write(sel, 0x3, 0xB04, 0x03C903C8);
-    SPI_Write(sel, 0x3, 0xB3C, 0x0001FF00);//0x0002FF00
-    SPI_Write(sel, 0x3, 0xB44, 0x00004300);
-    SPI_Write(sel, 0x3, 0xB48, 0x00010000);//0x00001000
-    SPI_Write(sel, 0x3, 0xB58, 0x00FCFE00);//0x00FCFE00
-    SPI_Write(sel, 0x3, 0xB60, 0x0000B278);//0x0000B260
-    SPI_Write(sel, 0x3, 0xB38, 0x0000100A);//0x0000101A
-    SPI_Write(sel, 0x3, 0xB68, 0x00000020);
-    SPI_Write(sel, 0x3, 0xB74, 0x0058001F);
-    SPI_Write(sel, 0x3, 0xB78, 0x00000000);
-    SPI_Write(sel, 0x3, 0x62C, 0x1310C470);
-    SPI_Write(sel, 0x3, 0x630, 0x98300301);
-    SPI_Write(sel, 0x3, 0x634, 0x40610613);
-    SPI_Write(sel, 0x3, 0x4F0, 0x00000964);
-    SPI_Write(sel, 0x3, 0xB70, 0x0000003F);
-    SPI_Write(sel, 0x3, 0xB40, 0x00050A0A);
-    SPI_Write(sel, 0x3, 0xB4C, 0x10001000);
-
-    SPI_Write(sel, 0x3, 0x90C, 0x9E22E0F0);
-    SPI_Write(sel, 0x3, 0xB0C, 0x9E22E0F0);
-    SPI_Write(sel, 0x3, 0x920, 0x00000098);
-    SPI_Write(sel, 0x3, 0xB20, 0x00000098);
-    SPI_Write(sel, 0x3, 0x908, 0x00000000);
-    SPI_Write(sel, 0x3, 0xB08, 0x00000000);
-    SPI_Write(sel, 0x3, 0x908, 0x001FFF03);
-    SPI_Write(sel, 0x3, 0xB08, 0x001FFF03);
+    DM6302_run(sel, dm6302_init14, PROG_LEN(dm6302_init14), 0);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
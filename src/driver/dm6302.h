@@ -3,6 +3,7 @@
 
 
 #include <stdbool.h>
+#include "i2c.h"
 
 //#define _DEBUG_DM6300
 
@@ -28,12 +29,21 @@ typedef enum{
 	CMD_R_BTN,
 }cmd_5680_t;
 
+typedef i2c_xfer_t spi_burst_t;
+
 int DM6302_init(uint8_t freq);
 void DM6302_SetChannel(uint8_t ch);
+void DM6302_SetChannelRF(uint8_t sel, uint8_t ch);
 void DM6302_openM0(uint32_t open);
 void DM6302_get_gain(uint8_t* gain);
+void DM6302_shadow_reset(void);
 
 void DM6302_Init0(uint8_t sel);
 void SPI_Read (uint8_t page, uint16_t addr, uint32_t* dat0, uint32_t* dat1);
+void SPI_Write(uint8_t sel, uint8_t page, uint16_t addr, uint32_t dat);
+
+void SPI_Burst_Begin(spi_burst_t* burst);
+void SPI_Burst_Write(spi_burst_t* burst, uint8_t sel, uint8_t page, uint16_t addr, uint32_t dat);
+int  SPI_Burst_End(spi_burst_t* burst);
 
 #endif // __DM6302_H_
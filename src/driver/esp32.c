@@ -24,6 +24,7 @@
 #include "dm5680.h"
 #include "uart.h"
 #include "esp32.h"
+#include "../core/thread.h"
 
 /////////////////////////////////////////////////////////////////////////////////
 pthread_mutex_t esp32_mutex;
@@ -71,14 +72,14 @@ static void *pthread_recv_esp32(void *arg)
 
 void init_esp32()
 {
-    pthread_t tid;
+    static const thread_desc_t rx = {"esp32_rx", pthread_recv_esp32, THREAD_PRIO_NORMAL, THREAD_CPU_ANY};
     set_gpio(GPIO_ESP32_BOOT0,1);
     set_gpio(GPIO_ESP32_EN,0);
     usleep(50000);
     set_gpio(GPIO_ESP32_EN,1);
     fd_esp32 = uart_open(3);
     if(fd_esp32 != -1)
-        pthread_create(&tid, NULL, pthread_recv_esp32, NULL);
+        thread_spawn(&rx, NULL, NULL);
     pthread_mutex_init(&esp32_mutex, NULL);
 }
 
@@ -77,15 +77,11 @@ void fb_memset (void *addr, int c, size_t len)
     memset(addr, c, len);
 }
 
-void fb_sync(PFBDEV pFbdev)
+//flush the CPU cache over rows y..y+h-1 and pan with x,y,w,h as the dirty rect
+void fb_sync_area(PFBDEV pFbdev, unsigned int pitch, int x, int y, int w, int h)
 {
     void *mem_start = pFbdev->fb_mem + pFbdev->fb_mem_offset;
     unsigned int bytes_per_pixel = pFbdev->fb_var.bits_per_pixel >> 3;
-    unsigned int pitch = bytes_per_pixel * pFbdev->fb_var.xres;
-    int x = 0;
-    int y = 0;
-    int w = pFbdev->fb_var.xres;
-    int h = pFbdev->fb_var.yres;
 
     void *args[2];
     void *dirty_rect_vir_addr_begin = (mem_start +  pitch*y + bytes_per_pixel*x);
@@ -102,6 +98,13 @@ void fb_sync(PFBDEV pFbdev)
     ioctl(pFbdev->fb, FBIOPAN_DISPLAY, &pFbdev->fb_var);
 }
 
+void fb_sync(PFBDEV pFbdev)
+{
+    unsigned int bytes_per_pixel = pFbdev->fb_var.bits_per_pixel >> 3;
+
+    fb_sync_area(pFbdev, bytes_per_pixel * pFbdev->fb_var.xres, 0, 0, pFbdev->fb_var.xres, pFbdev->fb_var.yres);
+}
+
 
 int fb_clean()
 {
@@ -22,3 +22,4 @@ int fb_close(PFBDEV pFbdev);
 int get_display_depth(PFBDEV pFbdev);
 void fb_memset (void *addr, int c, size_t len);
 void fb_sync(PFBDEV pFbdev);
+void fb_sync_area(PFBDEV pFbdev, unsigned int pitch, int x, int y, int w, int h);
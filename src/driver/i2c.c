@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <fcntl.h>
 #include <unistd.h> // for close
 #include <linux/i2c-dev.h>
@@ -10,19 +11,19 @@
 #include "i2c.h"
 #include "../core/common.hh"
 
-pthread_mutex_t i2c_mutex;
-
-void iic_init()
-{
-    pthread_mutex_init(&i2c_mutex, NULL);
-}
-
-
-static char* iic_ports[IIC_PORTS] = {
-    "/dev/i2c-0",
-    "/dev/i2c-1",
-    "/dev/i2c-2",
-    "/dev/i2c-3",
+typedef struct {
+    char*           dev;
+    int             fd;
+    pthread_mutex_t mutex;
+} iic_bus_t;
+
+// Every adapter is opened once and kept open. Each bus has its own lock so
+// traffic to the FPGA on M_I2C doesn't hold up the R_I2C/L_I2C devices.
+static iic_bus_t iic_bus[IIC_PORTS] = {
+    {"/dev/i2c-0", -1, PTHREAD_MUTEX_INITIALIZER},
+    {"/dev/i2c-1", -1, PTHREAD_MUTEX_INITIALIZER},
+    {"/dev/i2c-2", -1, PTHREAD_MUTEX_INITIALIZER},
+    {"/dev/i2c-3", -1, PTHREAD_MUTEX_INITIALIZER},
 };
 
 static int iic_open(char* port)
@@ -35,9 +36,23 @@ static int iic_open(char* port)
     return i2c_fd;
 }
 
-static void iic_close(int i2c_fd)
+// bus->mutex must be held
+static int iic_bus_fd(iic_bus_t* bus)
+{
+    if(bus->fd < 0)
+        bus->fd = iic_open(bus->dev);
+    return bus->fd;
+}
+
+void iic_init()
 {
-    close(i2c_fd);
+    int i;
+
+    for(i=0; i<IIC_PORTS; i++) {
+        pthread_mutex_lock(&iic_bus[i].mutex);
+        iic_bus_fd(&iic_bus[i]);
+        pthread_mutex_unlock(&iic_bus[i].mutex);
+    }
 }
 
 static uint8_t iic_read(int i2c_fd, uint8_t slave_address, uint16_t reg_address)
@@ -239,113 +254,162 @@ static int iic_write_n(int i2c_fd, uint8_t slave_address, uint8_t reg_address ,
 
 uint8_t i2c_read(int port, uint8_t slave_address, uint8_t addr)
 {
+    iic_bus_t* bus;
     int fd;
     uint8_t val = 0;
     if(port >= IIC_PORTS) 
         return 0;
 
-    pthread_mutex_lock(&i2c_mutex);
-    fd = iic_open(iic_ports[port]);
-    if(fd >= 0) {
+    bus = &iic_bus[port];
+    pthread_mutex_lock(&bus->mutex);
+    fd = iic_bus_fd(bus);
+    if(fd >= 0)
         val = iic_read(fd, slave_address, addr);
-        iic_close(fd);
-    }
-    pthread_mutex_unlock(&i2c_mutex);
+    pthread_mutex_unlock(&bus->mutex);
     return val;
 }
 
 
 int8_t i2c_read_n(int port, uint8_t slave_address, uint8_t addr, uint8_t * data, uint16_t len)
 {
+    iic_bus_t* bus;
     int8_t ret = -2;
     if(port >= IIC_PORTS)
         return -1;
 
-    pthread_mutex_lock(&i2c_mutex);
-    int fd = iic_open(iic_ports[port]);
+    bus = &iic_bus[port];
+    pthread_mutex_lock(&bus->mutex);
+    int fd = iic_bus_fd(bus);
     if(fd >= 0) {
         iic_read_n(fd, slave_address, addr,data,len);
-        iic_close(fd);
         ret = 0;
     }
-    pthread_mutex_unlock(&i2c_mutex);
+    pthread_mutex_unlock(&bus->mutex);
     return ret;
 }
 
-/*
-int8_t i2c_read_n(int port, uint8_t slave_address, uint8_t addr, uint8_t * data, uint16_t len)
-{
-    pthread_mutex_lock(&i2c_mutex);
-    if(port >= IIC_PORTS)
-    {
-        return -1;
-    }
-
-    int fd = iic_open(iic_ports[port]);
-    if(fd < 0)
-    {
-        return -2;
-    }
-
-    iic_read_n(fd, slave_address, addr,data,len);
-
-    iic_close(fd);
-    pthread_mutex_unlock(&i2c_mutex);
-    return 0;
-}*/
-
 int i2c_write(int port, uint8_t slave_address, uint8_t addr, uint8_t val)
 {
+    iic_bus_t* bus;
     int ret = -1;
     if(port >= IIC_PORTS)
         return -1;
 
-    pthread_mutex_lock(&i2c_mutex);
-    int fd = iic_open(iic_ports[port]);
-    if(fd >= 0) {
+    bus = &iic_bus[port];
+    pthread_mutex_lock(&bus->mutex);
+    int fd = iic_bus_fd(bus);
+    if(fd >= 0)
         ret = iic_write(fd, slave_address, addr, val);
-        iic_close(fd);
-    }
-    pthread_mutex_unlock(&i2c_mutex);
+    pthread_mutex_unlock(&bus->mutex);
     return ret;
 }
 
 
 int8_t i2c_write_n(int port, uint8_t slave_address, uint8_t addr, uint8_t* val, uint16_t len)
 {
+    iic_bus_t* bus;
     int ret = -2;
     if(port >= IIC_PORTS)
         return -1;
 
-    pthread_mutex_lock(&i2c_mutex);
-    int fd = iic_open(iic_ports[port]);
+    bus = &iic_bus[port];
+    pthread_mutex_lock(&bus->mutex);
+    int fd = iic_bus_fd(bus);
     if(fd >= 0) {
         iic_write_n(fd, slave_address, addr, val, len);
-        iic_close(fd);
         ret = 0;
     }
-    pthread_mutex_unlock(&i2c_mutex);
+    pthread_mutex_unlock(&bus->mutex);
     return ret;
 }
-/*
-int8_t i2c_write_n(int port, uint8_t slave_address, uint8_t addr, uint8_t* val, uint16_t len)
+
+///////////////////////////////////////////////////////////////////////////////
+// Transaction queue
+//
+// Register accesses are queued with i2c_xfer_write()/i2c_xfer_read() and sent
+// as one I2C_RDWR ioctl by i2c_xfer_submit(), instead of one ioctl each. A full
+// queue is submitted automatically, so a long sequence may go out as several
+// ioctls; other users of the bus can get in between those.
+void i2c_xfer_init(i2c_xfer_t* xfer, int port)
 {
-    pthread_mutex_lock(&i2c_mutex);
-    if(port >= IIC_PORTS)
-    {
-        return -1;
-    }
+    xfer->port = port;
+    xfer->nmsgs = 0;
+    xfer->err = 0;
+}
 
-    int fd = iic_open(iic_ports[port]);
-    if(fd < 0)
-    {
-        return -2;
-    }
+int i2c_xfer_write(i2c_xfer_t* xfer, uint8_t slave_address, uint8_t addr, uint8_t val)
+{
+    struct i2c_msg* msg;
+
+    if(xfer->nmsgs + 1 > I2C_XFER_MAX_MSGS)
+        i2c_xfer_submit(xfer);
+
+    msg = &xfer->msgs[xfer->nmsgs];
+    msg->addr = slave_address;
+    msg->flags = 0;
+    msg->len = 2;
+    msg->buf = xfer->obuf[xfer->nmsgs];
+    msg->buf[0] = addr;
+    msg->buf[1] = val;
+    xfer->nmsgs++;
+    return xfer->err;
+}
+
+// val is filled in by i2c_xfer_submit(), and must stay valid until then.
+int i2c_xfer_read(i2c_xfer_t* xfer, uint8_t slave_address, uint8_t addr, uint8_t* val)
+{
+    struct i2c_msg* msg;
+
+    if(xfer->nmsgs + 2 > I2C_XFER_MAX_MSGS)
+        i2c_xfer_submit(xfer);
+
+    msg = &xfer->msgs[xfer->nmsgs];
+    msg[0].addr = slave_address;
+    msg[0].flags = 0;
+    msg[0].len = 1;
+    msg[0].buf = xfer->obuf[xfer->nmsgs];
+    msg[0].buf[0] = addr;
+
+    msg[1].addr = slave_address;
+    msg[1].flags = I2C_M_RD;
+    msg[1].len = 1;
+    msg[1].buf = val;
+    xfer->nmsgs += 2;
+    return xfer->err;
+}
 
-    int ret = iic_write_n(fd, slave_address, addr, val, len);
+// Returns 0, or -1 if any part of the queue failed since i2c_xfer_init().
+// Reads of a failed ioctl return 0, like i2c_read().
+int i2c_xfer_submit(i2c_xfer_t* xfer)
+{
+    struct i2c_rdwr_ioctl_data work_queue;
+    iic_bus_t* bus;
+    int fd, ret = -1;
+    uint16_t i;
 
-    iic_close(fd);
-    pthread_mutex_unlock(&i2c_mutex);
-    return 0;
+    if(xfer->nmsgs == 0)
+        return xfer->err;
+
+    if(xfer->port < IIC_PORTS) {
+        work_queue.nmsgs = xfer->nmsgs;
+        work_queue.msgs = xfer->msgs;
+
+        bus = &iic_bus[xfer->port];
+        pthread_mutex_lock(&bus->mutex);
+        fd = iic_bus_fd(bus);
+        if(fd >= 0)
+            ret = ioctl(fd, I2C_RDWR, (unsigned long) &work_queue);
+        pthread_mutex_unlock(&bus->mutex);
+    }
+
+    if(ret < 0) {
+        //Printf("i2c_xfer_submit[%d] %d msgs failed.\n", xfer->port, xfer->nmsgs);
+        for(i=0; i<xfer->nmsgs; i++) {
+            if(xfer->msgs[i].flags & I2C_M_RD)
+                memset(xfer->msgs[i].buf, 0, xfer->msgs[i].len);
+        }
+        xfer->err = -1;
+    }
+    xfer->nmsgs = 0;
+    return xfer->err;
 }
-*/
\ No newline at end of file
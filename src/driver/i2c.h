@@ -4,6 +4,19 @@
 #define IIC_PORTS  4
 
 #include <stdint.h>
+#include <linux/i2c.h>
+
+#define I2C_XFER_MAX_MSGS  42  // I2C_RDWR_IOCTL_MAX_MSGS of the kernel
+
+// A queue of i2c messages on one bus, sent as one I2C_RDWR ioctl.
+// Read results land in the caller's buffers once the queue is submitted.
+typedef struct {
+    int             port;
+    uint16_t        nmsgs;
+    int             err;
+    struct i2c_msg  msgs[I2C_XFER_MAX_MSGS];
+    uint8_t         obuf[I2C_XFER_MAX_MSGS][2];
+} i2c_xfer_t;
 
 void iic_init();
 uint8_t i2c_read(int port, uint8_t slave_address, uint8_t addr);
@@ -12,6 +25,11 @@ int i2c_write(int port, uint8_t slave_address, uint8_t addr, uint8_t val);
 int8_t i2c_read_n(int port, uint8_t slave_address, uint8_t addr, uint8_t * data, uint16_t len);
 int8_t i2c_write_n(int port, uint8_t slave_address, uint8_t addr, uint8_t* val, uint16_t len);
 
+void i2c_xfer_init(i2c_xfer_t* xfer, int port);
+int  i2c_xfer_write(i2c_xfer_t* xfer, uint8_t slave_address, uint8_t addr, uint8_t val);
+int  i2c_xfer_read(i2c_xfer_t* xfer, uint8_t slave_address, uint8_t addr, uint8_t* val);
+int  i2c_xfer_submit(i2c_xfer_t* xfer);
+
 #define BMI_I2C_WRITE(addr, val, len) i2c_write_n(1, 0x68, addr, val, len)
 #define BMI_I2C_READ(addr, val, len)  i2c_read_n(1, 0x68, addr, val, len)
 
@@ -44,13 +62,17 @@ int8_t i2c_write_n(int port, uint8_t slave_address, uint8_t addr, uint8_t* val,
 
 #define ADDR_IT66021    0x49
 
-#define I2C_Write(s, a, d)      i2c_write(2, s, a, d)
-#define I2C_Read(s, a)          i2c_read(2, s, a)
+#define I2C_PORT_R      1
+#define I2C_PORT_MAIN   2
+#define I2C_PORT_L      3
+
+#define I2C_Write(s, a, d)      i2c_write(I2C_PORT_MAIN, s, a, d)
+#define I2C_Read(s, a)          i2c_read(I2C_PORT_MAIN, s, a)
 
-#define I2C_R_Write(s, a, d)    i2c_write(1, s, a, d)
-#define I2C_R_Read(s, a)        i2c_read(1, s, a)
+#define I2C_R_Write(s, a, d)    i2c_write(I2C_PORT_R, s, a, d)
+#define I2C_R_Read(s, a)        i2c_read(I2C_PORT_R, s, a)
 
-#define I2C_L_Write(s, a, d)    i2c_write(3, s, a, d)
-#define I2C_L_Read(s, a)        i2c_read(3, s, a)
+#define I2C_L_Write(s, a, d)    i2c_write(I2C_PORT_L, s, a, d)
+#define I2C_L_Read(s, a)        i2c_read(I2C_PORT_L, s, a)
 
 #endif // __I2C_H_
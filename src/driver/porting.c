@@ -12,28 +12,62 @@
 
 static int h_resolution =DISP_HOR_RES; 
 
-static lv_disp_draw_buf_t draw_buf;
-static lv_color_t buf1[DISP_HOR_RES * DISP_VER_RES  * 4 ];                        /*Declare a buffer for 1/10 screen size*/
+// Each display mode owns two partial draw buffers of 1/10 of its screen.
+// LVGL renders the dirty areas into them and my_disp_flush copies the rows
+// into /dev/fb0. The buffers are set up once, so switching modes only swaps
+// the draw buffer and the resolution.
+#define DRAW_BUF_SIZE(hor, ver) ((hor) * (ver) / 10)
+
+typedef struct {
+	lv_coord_t hor_res;
+	lv_coord_t ver_res;
+	lv_color_t *buf1;
+	lv_color_t *buf2;
+	lv_disp_draw_buf_t draw_buf;
+} disp_mode_t;
+
+static lv_color_t buf_1080p[2][DRAW_BUF_SIZE(1920, 1080)];
+static lv_color_t buf_720p[2][DRAW_BUF_SIZE(1280, 720)];
+
+static disp_mode_t disp_mode[LVGL_MODE_NUM] = {
+	[LVGL_MODE_1080P] = {1920, 1080, buf_1080p[0], buf_1080p[1]},
+	[LVGL_MODE_720P]  = {1280,  720, buf_720p[0],  buf_720p[1]},
+};
+static lvgl_mode_t cur_mode = LVGL_MODE_1080P;
 static lv_disp_drv_t disp_drv;        /*Descriptor of a display driver*/
 
+// union of the areas flushed during the current refresh
+static lv_area_t flush_area;
+static bool flush_pending = false;
+
 FBDEV fbdev;
 
 static void my_disp_flush(lv_disp_drv_t * disp, const lv_area_t * area, lv_color_t * color_p)
 {
     int32_t  y;
-    /*It's a very slow but simple implementation.
-     *`set_pixel` needs to be written by you to a set pixel on the screen*/
+    uint32_t pitch = h_resolution * sizeof(lv_color_t);
+    uint32_t len = lv_area_get_width(area) * sizeof(lv_color_t);
+    uint8_t *dst = (uint8_t *)fbdev.fb_mem + fbdev.fb_mem_offset + area->y1 * pitch + area->x1 * sizeof(lv_color_t);
+
     for(y = area->y1; y <= area->y2; y++) {
-//        for(x = area->x1; x <= area->x2; x++) {
-			fbdev.fb_mem_offset = (y*h_resolution+area->x1)*4;
-			fbdev.fb_fix.smem_len = 4 * (area->x2 - area->x1+1);
-			memcpy(fbdev.fb_mem + fbdev.fb_mem_offset, ((char *)color_p), fbdev.fb_fix.smem_len);
-            color_p+=(area->x2 - area->x1 + 1);
- //       }
+        memcpy(dst, color_p, len);
+        dst += pitch;
+        color_p += lv_area_get_width(area);
+    }
+
+    if(flush_pending)
+        _lv_area_join(&flush_area, &flush_area, area);
+    else {
+        lv_area_copy(&flush_area, area);
+        flush_pending = true;
     }
 
-    fb_sync(&fbdev);
-//    fb_close(&fbdev);
+    // one cache sync and pan per refresh, covering only what changed
+    if(lv_disp_flush_is_last(disp)) {
+        fb_sync_area(&fbdev, pitch, flush_area.x1, flush_area.y1,
+                     lv_area_get_width(&flush_area), lv_area_get_height(&flush_area));
+        flush_pending = false;
+    }
     lv_disp_flush_ready(disp);         /* Indicate you are ready with the flushing*/
 }
 
@@ -49,13 +83,16 @@ int lvgl_init_porting(void)
     }
 	Printf("register disp drv\n");
 //ע����ʾ����
-	lv_disp_draw_buf_init(&draw_buf, buf1, NULL, DISP_HOR_RES * DISP_VER_RES * 4);  /*Initialize the display buffer.*/
+	for(int i=0; i<LVGL_MODE_NUM; i++) {
+		disp_mode_t *m = &disp_mode[i];
+		lv_disp_draw_buf_init(&m->draw_buf, m->buf1, m->buf2, DRAW_BUF_SIZE(m->hor_res, m->ver_res));  /*Initialize the display buffer.*/
+	}
 
 	lv_disp_drv_init(&disp_drv);          /*Basic initialization*/
 	disp_drv.flush_cb = my_disp_flush;    /*Set your driver function*/
-	disp_drv.draw_buf = &draw_buf;        /*Assign the buffer to the display*/
-	disp_drv.hor_res = DISP_HOR_RES;   /*Set the horizontal resolution of the display*/
-	disp_drv.ver_res = DISP_VER_RES;   /*Set the vertical resolution of the display*/
+	disp_drv.draw_buf = &disp_mode[cur_mode].draw_buf;        /*Assign the buffer to the display*/
+	disp_drv.hor_res = disp_mode[cur_mode].hor_res;   /*Set the horizontal resolution of the display*/
+	disp_drv.ver_res = disp_mode[cur_mode].ver_res;   /*Set the vertical resolution of the display*/
 	disp = lv_disp_drv_register(&disp_drv);      /*Finally register the driver*/
 
 #if 0
@@ -76,31 +113,36 @@ int lvgl_init_porting(void)
 
 
 
-int lvgl_switch_to_720p(void)
+// Switching between timings with the same geometry (720p60/50/90 video)
+// keeps the current buffers and does not invalidate anything.
+int lvgl_switch_mode(lvgl_mode_t mode)
 {
-	lv_disp_draw_buf_init(&draw_buf, buf1, NULL, 1280* 720* 4);  /*Initialize the display buffer.*/
-	disp_drv.draw_buf = &draw_buf;        /*Assign the buffer to the display*/
+	disp_mode_t *m;
+
+	if(mode >= LVGL_MODE_NUM)
+		return -1;
+	if(mode == cur_mode)
+		return 0;
 
-	disp_drv.hor_res = 1280;   /*Set the horizontal resolution of the display*/
-	disp_drv.ver_res = 720;   /*Set the vertical resolution of the display*/
+	m = &disp_mode[mode];
+	disp_drv.draw_buf = &m->draw_buf;        /*Assign the buffer to the display*/
+	disp_drv.hor_res = m->hor_res;   /*Set the horizontal resolution of the display*/
+	disp_drv.ver_res = m->ver_res;   /*Set the vertical resolution of the display*/
 	lv_disp_drv_update(disp, &disp_drv);      /*Finally register the driver*/
 
-	h_resolution = 1280;
+	h_resolution = m->hor_res;
+	cur_mode = mode;
 	return 0;
 }
 
+int lvgl_switch_to_720p(void)
+{
+	return lvgl_switch_mode(LVGL_MODE_720P);
+}
 
 int lvgl_switch_to_1080p(void)
 {
-	lv_disp_draw_buf_init(&draw_buf, buf1, NULL, 1920* 1080* 4);  /*Initialize the display buffer.*/
-	disp_drv.draw_buf = &draw_buf;        /*Assign the buffer to the display*/
-
-	disp_drv.hor_res = 1920;   /*Set the horizontal resolution of the display*/
-	disp_drv.ver_res = 1080;   /*Set the vertical resolution of the display*/
-	lv_disp_drv_update(disp, &disp_drv);      /*Finally register the driver*/
-
-	h_resolution = 1920;
-	return 0;
+	return lvgl_switch_mode(LVGL_MODE_1080P);
 }
 
 
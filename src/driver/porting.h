@@ -2,7 +2,14 @@
 #define _PORTING_H
 #include <stdbool.h>
 
+typedef enum {
+	LVGL_MODE_1080P = 0,	//UI
+	LVGL_MODE_720P,			//video overlay, 720p60/50/90
+	LVGL_MODE_NUM
+} lvgl_mode_t;
+
 int lvgl_init_porting(void);
+int lvgl_switch_mode(lvgl_mode_t mode);
 int lvgl_switch_to_720p(void);
 int lvgl_switch_to_1080p(void);
 
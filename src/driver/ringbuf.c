@@ -0,0 +1,79 @@
+#include "ringbuf.h"
+#include <string.h>
+
+int ringbuf_init(ringbuf_t *rb, uint8_t *mem, uint32_t size, uint32_t spill)
+{
+	if(!size || (size & (size - 1)))
+		return -1;
+
+	rb->buf = mem;
+	rb->size = size;
+	rb->spill = spill;
+	rb->overflow = 0;
+	atomic_init(&rb->head, 0);
+	atomic_init(&rb->tail, 0);
+	return 0;
+}
+
+uint32_t ringbuf_count(ringbuf_t *rb)
+{
+	return atomic_load_explicit(&rb->head, memory_order_acquire) -
+		   atomic_load_explicit(&rb->tail, memory_order_acquire);
+}
+
+// Contiguous free space at head; fill it and ringbuf_commit() what was written
+uint32_t ringbuf_write_span(ringbuf_t *rb, uint8_t **p)
+{
+	uint32_t head = atomic_load_explicit(&rb->head, memory_order_relaxed);
+	uint32_t tail = atomic_load_explicit(&rb->tail, memory_order_acquire);
+	uint32_t pos = head & (rb->size - 1);
+	uint32_t free = rb->size - (head - tail);
+
+	*p = &rb->buf[pos];
+	return free < rb->size - pos ? free : rb->size - pos;
+}
+
+void ringbuf_commit(ringbuf_t *rb, uint32_t n)
+{
+	atomic_fetch_add_explicit(&rb->head, n, memory_order_release);
+}
+
+// Contiguous readable bytes at tail
+uint32_t ringbuf_read_span(ringbuf_t *rb, uint8_t **p)
+{
+	uint32_t tail = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+	uint32_t head = atomic_load_explicit(&rb->head, memory_order_acquire);
+	uint32_t pos = tail & (rb->size - 1);
+	uint32_t used = head - tail;
+
+	*p = &rb->buf[pos];
+	return used < rb->size - pos ? used : rb->size - pos;
+}
+
+// off must be below ringbuf_count()
+uint8_t ringbuf_at(ringbuf_t *rb, uint32_t off)
+{
+	uint32_t tail = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+
+	return rb->buf[(tail + off) & (rb->size - 1)];
+}
+
+// Pointer to len readable bytes starting off bytes after tail. Only a view
+// that crosses the end of the ring is copied, into the spill area.
+uint8_t *ringbuf_view(ringbuf_t *rb, uint32_t off, uint32_t len)
+{
+	uint32_t tail = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+	uint32_t pos = (tail + off) & (rb->size - 1);
+
+	if(pos + len > rb->size) {
+		if(pos + len > rb->size + rb->spill)
+			return NULL;
+		memcpy(&rb->buf[rb->size], rb->buf, pos + len - rb->size);
+	}
+	return &rb->buf[pos];
+}
+
+void ringbuf_consume(ringbuf_t *rb, uint32_t n)
+{
+	atomic_fetch_add_explicit(&rb->tail, n, memory_order_release);
+}
@@ -0,0 +1,35 @@
+#ifndef _RINGBUF_H
+#define _RINGBUF_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+// Single-producer/single-consumer byte ring. head and tail run freely and
+// are masked on access, so size must be a power of two. mem holds
+// size + spill bytes; the spill area lets a view that wraps the end be
+// handed out as one contiguous span.
+typedef struct {
+	uint8_t *buf;
+	uint32_t size;
+	uint32_t spill;
+	atomic_uint head;	//producer
+	atomic_uint tail;	//consumer
+	uint32_t overflow;	//bytes dropped because the ring was full
+} ringbuf_t;
+
+#define RINGBUF_MEM(size, spill) ((size) + (spill))
+
+int      ringbuf_init(ringbuf_t *rb, uint8_t *mem, uint32_t size, uint32_t spill);
+uint32_t ringbuf_count(ringbuf_t *rb);
+
+// producer
+uint32_t ringbuf_write_span(ringbuf_t *rb, uint8_t **p);
+void     ringbuf_commit(ringbuf_t *rb, uint32_t n);
+
+// consumer
+uint32_t ringbuf_read_span(ringbuf_t *rb, uint8_t **p);
+uint8_t  ringbuf_at(ringbuf_t *rb, uint32_t off);
+uint8_t *ringbuf_view(ringbuf_t *rb, uint32_t off, uint32_t len);
+void     ringbuf_consume(ringbuf_t *rb, uint32_t n);
+
+#endif
@@ -4,16 +4,16 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/ioctl.h>
 #include <fcntl.h>
-#include <termios.h>
 #include <errno.h>
 #include <stdlib.h>
-#include <stdio.h>
-#include <fcntl.h>   /* File Control Definitions           */
-#include <termios.h> /* POSIX Terminal Control Definitions */
-#include <unistd.h>  /* UNIX Standard Definitions 	   */
-#include <errno.h>   /* ERROR Number Definitions           */
+#include <stdatomic.h>
+#include <poll.h>
+#include <asm/termbits.h>	/* termios2, BOTHER; not mixable with <termios.h> */
+#include <linux/serial.h>	/* ASYNC_LOW_LATENCY, serial_icounter_struct */
 #include "uart.h"
+#include "../core/common.hh"
 
 static char* uart_ports[UART_PORTS] = {
     "/dev/ttyS0",
@@ -22,108 +22,118 @@ static char* uart_ports[UART_PORTS] = {
     "/dev/ttyS3",
 };
 
-static int set_opt(int fd,int nSpeed, int nBits, char nEvent, int nStop)
+typedef struct {
+	int fd;
+	uart_cfg_t cfg;
+	atomic_uint rx_bytes;
+	atomic_uint tx_bytes;
+	atomic_uint frames;
+	atomic_uint bad_frames;
+	atomic_uint io_errors;
+} uart_port_t;
+
+static uart_port_t uart_port[UART_PORTS] = {
+	{.fd = -1}, {.fd = -1}, {.fd = -1}, {.fd = -1},
+};
+
+static uart_port_t *uart_port_of(int fd)
 {
-	struct termios newtio,oldtio;
-	if  ( tcgetattr( fd,&oldtio)  !=  0) { 
+	for(int i=0; i<UART_PORTS; i++)
+		if(uart_port[i].fd == fd)
+			return &uart_port[i];
+	return NULL;
+}
+
+// Raw mode through termios2, so any baud rate the divider can reach works,
+// not just the Bxxx constants. VMIN/VTIME only matter for blocking readers.
+static int set_opt(int fd, const uart_cfg_t *cfg)
+{
+	struct termios2 tio;
+	struct serial_struct ser;
+
+	if(ioctl(fd, TCGETS2, &tio) != 0) {
 		perror("SetupSerial 1");
 		return -1;
 	}
-	bzero( &newtio, sizeof( newtio ) );
-	newtio.c_cflag  |=  CLOCAL | CREAD;
-	newtio.c_cflag &= ~CSIZE;
+	memset(&tio, 0, sizeof(tio));
+	tio.c_cflag = CLOCAL | CREAD | BOTHER | (BOTHER << IBSHIFT);
+	tio.c_ispeed = cfg->baud;
+	tio.c_ospeed = cfg->baud;
 
-	switch( nBits )
-	{
-	case 7:
-		newtio.c_cflag |= CS7;
-		break;
-	case 8:
-		newtio.c_cflag |= CS8;
-		break;
-	}
+	tio.c_cflag |= (cfg->bits == 7) ? CS7 : CS8;
 
-	switch( nEvent )
+	switch(cfg->parity)
 	{
 	case 'O':
-		newtio.c_cflag |= PARENB;
-		newtio.c_cflag |= PARODD;
-		newtio.c_iflag |= (INPCK | ISTRIP);
+		tio.c_cflag |= PARENB | PARODD;
+		tio.c_iflag |= (INPCK | ISTRIP);
 		break;
-	case 'E': 
-		newtio.c_iflag |= (INPCK | ISTRIP);
-		newtio.c_cflag |= PARENB;
-		newtio.c_cflag &= ~PARODD;
-		break;
-	case 'N':  
-		newtio.c_cflag &= ~PARENB;
+	case 'E':
+		tio.c_cflag |= PARENB;
+		tio.c_iflag |= (INPCK | ISTRIP);
 		break;
 	}
 
-	switch( nSpeed )
-	{
-	case 2400:
-		cfsetispeed(&newtio, B2400);
-		cfsetospeed(&newtio, B2400);
-		break;
-	case 4800:
-		cfsetispeed(&newtio, B4800);
-		cfsetospeed(&newtio, B4800);
-		break;
-	case 9600:
-		cfsetispeed(&newtio, B9600);
-		cfsetospeed(&newtio, B9600);
-		break;
-	case 115200:
-		cfsetispeed(&newtio, B115200);
-		cfsetospeed(&newtio, B115200);
-		break;
-	case 460800:
-		cfsetispeed(&newtio, B460800);
-		cfsetospeed(&newtio, B460800);
-		break;
-	default:
-		cfsetispeed(&newtio, B9600);
-		cfsetospeed(&newtio, B9600);
-		break;
-	}
-	if( nStop == 1 )
-		newtio.c_cflag &=  ~CSTOPB;
-	else if ( nStop == 2 )
-	newtio.c_cflag |=  CSTOPB;
-	newtio.c_cc[VTIME]  = 0;
-	newtio.c_cc[VMIN] = 0;
-	tcflush(fd,TCIFLUSH);
-	if((tcsetattr(fd,TCSANOW,&newtio))!=0)
-	{
+	if(cfg->stop == 2)
+		tio.c_cflag |= CSTOPB;
+
+	tio.c_cc[VMIN]  = cfg->vmin;
+	tio.c_cc[VTIME] = cfg->vtime;
+
+	ioctl(fd, TCFLSH, TCIFLUSH);
+	if(ioctl(fd, TCSETS2, &tio) != 0) {
 		perror("com set error");
 		return -1;
 	}
+
+	// Skips the tty layer's flip-buffer delay on drivers that honour it
+	if(cfg->low_latency && ioctl(fd, TIOCGSERIAL, &ser) == 0) {
+		ser.flags |= ASYNC_LOW_LATENCY;
+		ioctl(fd, TIOCSSERIAL, &ser);
+	}
 	return 0;
 }
 
 int uart_read(int fd, uint8_t* data, int len)
 {
-
+    uart_port_t *up = uart_port_of(fd);
     int  bytes_read = 0;    /* Number of bytes read by the read() system call */
 
     bytes_read = read(fd, data, len); /* Read the data                   */
+    if(up) {
+        if(bytes_read > 0)
+            atomic_fetch_add_explicit(&up->rx_bytes, bytes_read, memory_order_relaxed);
+        else if(bytes_read < 0 && errno != EAGAIN && errno != EINTR)
+            atomic_fetch_add_explicit(&up->io_errors, 1, memory_order_relaxed);
+    }
     return bytes_read;
 }
 
 static int uart_write(int fd, uint8_t* data, int len)
 {
+    uart_port_t *up = uart_port_of(fd);
     int bytes_written  = 0;  	/* Value for storing the number of bytes written to the port */
 
     bytes_written = write(fd, data, len); /* use write() to send data to port */
+    if(up) {
+        if(bytes_written > 0)
+            atomic_fetch_add_explicit(&up->tx_bytes, bytes_written, memory_order_relaxed);
+        else if(bytes_written < 0 && errno != EAGAIN && errno != EINTR)
+            atomic_fetch_add_explicit(&up->io_errors, 1, memory_order_relaxed);
+    }
     return bytes_written;
 }
 
 void uart_close(int fd)
 {
+	uart_port_t *up = uart_port_of(fd);
+
+	if(up)
+		up->fd = -1;
 	close(fd);
 }
-int uart_open(int port_num)
+
+int uart_open_cfg(int port_num, const uart_cfg_t *cfg)
 {
     char* port = uart_ports[port_num];
 	int fd = open(port,O_RDWR);
@@ -131,10 +141,70 @@ int uart_open(int port_num)
 	{
 		return -1;
 	}
-	set_opt(fd, 115200, 8, 'N', 1); 
+	set_opt(fd, cfg);
+	uart_port[port_num].cfg = *cfg;
+	uart_port[port_num].fd = fd;
     return fd;
 }
 
+int uart_open(int port_num)
+{
+	static const uart_cfg_t cfg = UART_CFG_DEFAULT;
+
+	return uart_open_cfg(port_num, &cfg);
+}
+
+// Called by protocol parsers once per frame, ok=false for rejected ones
+void uart_count_frame(int fd, bool ok)
+{
+	uart_port_t *up = uart_port_of(fd);
+
+	if(up)
+		atomic_fetch_add_explicit(ok ? &up->frames : &up->bad_frames, 1, memory_order_relaxed);
+}
+
+int uart_get_stats(int port_num, uart_stats_t *st)
+{
+	uart_port_t *up = &uart_port[port_num];
+	struct serial_icounter_struct ic;
+
+	if(up->fd < 0)
+		return -1;
+
+	memset(st, 0, sizeof(*st));
+	st->baud       = up->cfg.baud;
+	st->rx_bytes   = atomic_load(&up->rx_bytes);
+	st->tx_bytes   = atomic_load(&up->tx_bytes);
+	st->frames     = atomic_load(&up->frames);
+	st->bad_frames = atomic_load(&up->bad_frames);
+	st->io_errors  = atomic_load(&up->io_errors);
+	if(ioctl(up->fd, TIOCGICOUNT, &ic) == 0) {
+		st->frame_err   = ic.frame;
+		st->parity_err  = ic.parity;
+		st->overrun     = ic.overrun;
+		st->buf_overrun = ic.buf_overrun;
+	}
+	return 0;
+}
+
+// One line per open port, counters since open
+void uart_stats_dump(void)
+{
+	uart_stats_t st;
+	char line[96];
+
+	Printf("uart     baud   rx_bytes tx_bytes  frames  bad io frm par ovr bovr\n");
+	for(int i=0; i<UART_PORTS; i++)
+	{
+		if(uart_get_stats(i, &st) < 0)
+			continue;
+		snprintf(line, sizeof(line), "ttyS%d %7u %10u %8u %7u %4u %2u %3u %3u %3u %4u", i,
+				st.baud, st.rx_bytes, st.tx_bytes, st.frames, st.bad_frames,
+				st.io_errors, st.frame_err, st.parity_err, st.overrun, st.buf_overrun);
+		Printf("%s\n", line);
+	}
+}
+
 int uart_read_byte(int fd, uint8_t *data)
 {
     return uart_read(fd, data, 1);
@@ -144,3 +214,27 @@ int uart_write_byte(int fd, uint8_t data)
 {
     return uart_write(fd, &data, 1);
 }
+
+// Writes the whole buffer, waiting for room if fd is non-blocking.
+// Returns the bytes written, short only if the port stays full for 100ms.
+int uart_write_all(int fd, uint8_t* data, int len)
+{
+	struct pollfd pfd = {.fd = fd, .events = POLLOUT};
+	int done = 0, n;
+
+	while(done < len)
+	{
+		n = uart_write(fd, data + done, len - done);
+		if(n > 0)
+			done += n;
+		else if(n < 0 && errno == EINTR)
+			continue;
+		else if(n < 0 && errno == EAGAIN) {
+			if(poll(&pfd, 1, 100) <= 0)
+				break;
+		}
+		else
+			break;
+	}
+	return done;
+}
@@ -2,12 +2,44 @@
 #define __UART_H_
 
 #include <stdint.h>
+#include <stdbool.h>
 #define UART_PORTS  4
 
-int     uart_open(int port);
+typedef struct {
+	uint32_t baud;		//any rate, set through termios2
+	uint8_t  bits;		//7 or 8
+	char     parity;	//'N', 'O' or 'E'
+	uint8_t  stop;		//1 or 2
+	uint8_t  vmin;		//blocking read returns after vmin bytes
+	uint8_t  vtime;		//or after vtime*100ms of idle line
+	bool     low_latency;
+} uart_cfg_t;
+
+#define UART_CFG_DEFAULT {115200, 8, 'N', 1, 0, 0, true}
+
+typedef struct {
+	uint32_t baud;
+	uint32_t rx_bytes;
+	uint32_t tx_bytes;
+	uint32_t frames;		//counted by the protocol parser
+	uint32_t bad_frames;
+	uint32_t io_errors;		//failed read()/write()
+	uint32_t frame_err;		//from the driver
+	uint32_t parity_err;
+	uint32_t overrun;
+	uint32_t buf_overrun;
+} uart_stats_t;
+
+int     uart_open(int port);		//UART_CFG_DEFAULT
+int     uart_open_cfg(int port, const uart_cfg_t *cfg);
 int 	uart_read_byte(int fd, uint8_t *data);
 int     uart_write_byte(int fd, uint8_t data);
+int     uart_write_all(int fd, uint8_t* data, int len);
 void	uart_close(int fd);
 
 int uart_read(int fd, uint8_t* data, int len);
+
+void uart_count_frame(int fd, bool ok);
+int  uart_get_stats(int port, uart_stats_t *st);
+void uart_stats_dump(void);
 #endif // __UART_H_
@@ -8,9 +8,6 @@
 setting_t g_setting;
 
 op_level_t g_menu_op = OPLEVEL_MAINMENU;
-bool g_sdcard_enable = false;
-bool g_sdcard_det_req = false;
-int  g_sdcard_size = 0;
 bool g_autoscan_exit = true;
 bool g_scanning = false;
 bool g_showRXOSD = true;
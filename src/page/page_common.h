@@ -9,10 +9,10 @@
 #define AUDIO_SEL_SH    "/mnt/app/script/audio_sel.sh" 
 #define SETTING_INI 	"/mnt/app/setting.ini"
 #define TEST_INI 	    "/mnt/extsd/test.ini"
-#define REC_START   	"/mnt/app/app/record/gogglecmd -rec start"
-#define REC_STOP    	"/mnt/app/app/record/gogglecmd -rec stop"
+#define DM5680_CAPTURE  "/mnt/extsd/dm5680_uart1.bin"
 #define REC_CONF    	"/mnt/app/app/record/confs/record.conf"
 #define OSD_FILE    	"/mnt/app/OSD_FONT_BTFL_montserrant.bmp"   /*  "/mnt/app/betaflight_OSD512.bmp" */
+#define OSD_FILE_SD 	"/mnt/extsd/resource/OSD/FC/%s.bmp"   //user font, %s is the FC variant
 
 #define RESOURCE_PATH   "A:/mnt/app/app/resource/"
 #define recording_bmp   "recording.bmp"
@@ -158,9 +158,6 @@ typedef uint8_t lv_menu_builder_variant_t;
 
 extern setting_t g_setting;
 extern op_level_t g_menu_op;
-extern bool g_sdcard_enable;
-extern bool g_sdcard_det_req;
-extern int  g_sdcard_size;
 extern bool g_autoscan_exit;
 extern bool g_scanning;
 extern bool g_showRXOSD;
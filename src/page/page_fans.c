@@ -11,6 +11,7 @@
 #include "../driver/fans.h"
 #include "ui_attribute.h"
 #include "../core/common.hh"
+#include "../core/telemetry.h"
 
 typedef enum {
 	FANS_MODE_TOP = 0,
@@ -272,13 +273,13 @@ void fans_auto_ctrl_core(bool is_left,int tempe, bool binit)
 	}
 }
 
-bool rescue_from_hot()
+bool rescue_from_hot(const sys_temperature_t *temp)
 {
 	static uint8_t speeds_saved[3];
 	static bool    respeeding[3] = {false,false,false};
 
 	//Right
-	if(g_temperature.right > SIDE_TEMPERATURE_RISKH) {
+	if(temp->right > SIDE_TEMPERATURE_RISKH) {
 		if(!respeeding[0]) {
 			speeds_saved[0] = fan_speeds[0];
 			respeeding[0] = true;
@@ -286,14 +287,14 @@ bool rescue_from_hot()
 			Printf("Right fan: rescue ON.\n");
 		}
 	}
-	else if(respeeding[0] &&(g_temperature.right < FAN_TEMPERATURE_THR_L)) {
+	else if(respeeding[0] &&(temp->right < FAN_TEMPERATURE_THR_L)) {
 		fans_right_setspeed(speeds_saved[0]);
 		respeeding[0] = false;
 		Printf("Right fan: rescue OFF.\n");
 	}
 
 	//Left
-	if(g_temperature.left > SIDE_TEMPERATURE_RISKH) {
+	if(temp->left > SIDE_TEMPERATURE_RISKH) {
 		if(!respeeding[1]) {
 			speeds_saved[1] = fan_speeds[1];
 			respeeding[1] = true;
@@ -301,14 +302,14 @@ bool rescue_from_hot()
 			Printf("Left fan: rescue ON.\n");
 		}
 	}
-	else if(respeeding[1] &&(g_temperature.left < FAN_TEMPERATURE_THR_L)) {
+	else if(respeeding[1] &&(temp->left < FAN_TEMPERATURE_THR_L)) {
 		fans_left_setspeed(speeds_saved[1]);
 		respeeding[1] = false;
 		Printf("Left fan: rescue OFF.\n");
 	}
 
 	//Top 
-	if(g_temperature.top > TOP_TEMPERATURE_RISKH) {
+	if(temp->top > TOP_TEMPERATURE_RISKH) {
 		if(!respeeding[2]) {
 			speeds_saved[2] = fan_speeds[2];
 			respeeding[2] = true;
@@ -316,7 +317,7 @@ bool rescue_from_hot()
 			Printf("Top fan: rescue ON.\n");
 		}
 	}
-	else if(respeeding[2] &&(g_temperature.top < TOP_TEMPERATURE_NORM)) {
+	else if(respeeding[2] &&(temp->top < TOP_TEMPERATURE_NORM)) {
 		fans_top_setspeed(speeds_saved[2]);
 		respeeding[2] = false;
 		Printf("Top fan: rescue OFF.\n");
@@ -331,16 +332,18 @@ void fans_auto_ctrl()
 	static uint8_t auto_mode_d;
 	static uint8_t speeds[3];
 	uint8_t binit_r,binit_f;
+	tlm_power_t power;
 
-	if(rescue_from_hot()) return;
+	tlm_read(TLM_POWER, &power);
+	if(rescue_from_hot(&power.temperature)) return;
 
 	binit_r = (auto_mode_d == 0) && (g_setting.fans.auto_mode == 1);  //Manual mode -> Auto
 	binit_f = (auto_mode_d == 1) && (g_setting.fans.auto_mode == 0);  //Auto   mode -> manual
 	auto_mode_d = g_setting.fans.auto_mode;
 	
 	if(g_setting.fans.auto_mode) {
-		fans_auto_ctrl_core(false, g_temperature.right, binit_r);
-		fans_auto_ctrl_core(true, g_temperature.left, binit_r);
+		fans_auto_ctrl_core(false, power.temperature.right, binit_r);
+		fans_auto_ctrl_core(true, power.temperature.left, binit_r);
 	}
 	else {
 		if(binit_f) 
@@ -22,6 +22,7 @@
 #include "msp_displayport.h"
 #include "../driver/uart.h"
 #include "../core/main_menu.h"
+#include "../core/rx_scan.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 //local
@@ -283,39 +284,24 @@ static void user_clear_signal(void)
 
 }
 
-uint8_t max4(uint8_t a1,uint8_t a2,uint8_t a3,uint8_t a4)
+static void scan_progress(uint8_t ch, const rx_scan_result_t *res, void *arg)
 {
-	uint8_t b1 = (a1 > a2)? a1 : a2;
-	uint8_t b2 = (a3 > a4)? a3 : a4;
-	return       (b1 > b2)? b1 : b2;
-}
-
-void scan_channel(uint8_t channel, uint8_t *gain_ret, bool *valid)
-{
-	uint8_t vld0,vld1;
-    uint8_t gain[4];
+	int *done = arg;
 
-	DM6302_SetChannel(channel);
+	(*done)++;
+	channel_status_tb[ch].is_valid = res->valid;
+	channel_status_tb[ch].gain = res->gain;
 
-	usleep(100000);
-    DM5680_clear_vldflg(); 
-    DM5680_req_vldflg(); 
-
-	DM6302_get_gain(gain);
-	*gain_ret = max4(gain[0],gain[1],gain[2],gain[3]);
-	
-   	vld0 = rx_status[0].rx_valid;
-	vld1 = rx_status[1].rx_valid;
-	*valid = vld0 | vld1;
-  
-    Printf("Scan channel%d: valid:%d, gain:%d\n", channel, *valid, *gain_ret);
+	lv_bar_set_value(progressbar, 10 + *done * 90 / FREQ_NUM, LV_ANIM_OFF);
+	set_signal(&channel_tb[ch], res->valid, res->gain);
+	lv_timer_handler();
 }
 
 int8_t scan_now(void)
 {
-	uint8_t ch,gain;
-	bool 	valid;
 	uint8_t valid_index = 0;
+	uint16_t boot_mask;
+	int done = 0;
 
    	lv_label_set_text(label, "Scanning...");
     lv_bar_set_value(progressbar, 0, LV_ANIM_OFF);
@@ -334,24 +320,23 @@ int8_t scan_now(void)
 	for(int i=0; i<10; i++)
 	{
 		valid_channel_tb[i] = -1;
+		channel_status_tb[i].is_valid = false;
+		channel_status_tb[i].gain = 0;
 	}
-	
-    for(ch=0; ch<FREQ_NUM; ch++)
-	{
-		scan_channel(ch, &gain, &valid);
-
-		if(valid){
-			valid_channel_tb[valid_index++] = ch;
-		}
-
-		channel_status_tb[ch].is_valid = valid;
-		channel_status_tb[ch].gain = gain;
+	user_clear_signal();
 
-    	lv_bar_set_value(progressbar, 10 + ch*10, LV_ANIM_OFF);
-		lv_timer_handler();
-		set_signal(&channel_tb[ch], valid, gain);
+	// first scan after boot: recheck last session's channels, sweep only if none is back
+	boot_mask = rx_scan_boot_mask();
+	if(!boot_mask || rx_scan_quick(boot_mask, scan_progress, &done) == 0) {
+		done = 0;
+		rx_scan_full(scan_progress, &done);
 	}
 
+	for(int ch=0; ch<FREQ_NUM; ch++)
+		if(channel_status_tb[ch].is_valid)
+			valid_channel_tb[valid_index++] = ch;
+	lv_bar_set_value(progressbar, 100, LV_ANIM_OFF);
+
 	user_select_signal();
 
    	lv_label_set_text(label, "Scanning done");
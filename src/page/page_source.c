@@ -8,6 +8,7 @@
 #include "../driver/oled.h"
 #include "../core/common.hh"
 #include "../core/main_menu.h"
+#include "../core/evloop.h"
 #include "page_scannow.h"
 
 /////////////////////////////////////////////////////////////////////////
@@ -60,6 +61,7 @@ lv_obj_t *page_source_create(lv_obj_t *parent, struct panel_arr *arr)
 		create_label_item(cont, "<Back", 1, 4,3);
 	}
 
+	evloop_register(EV_TASK_SOURCE, "source", source_status_timer, 1000);
 	return page;
 }
 
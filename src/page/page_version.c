@@ -28,11 +28,6 @@ static btn_group_t btn_group1;
 static slider_group_t slider_group0;
 static slider_group_t slider_group1;
 
-#define ADDR_AL 0x65
-#define ADDR_FPGA 0x64
-#define I2C_Write(s, a, d)  i2c_write(2, s, a, d)
-#define I2C_Read(s, a)      i2c_read(2, s, a)
-
 static bool is_need_update_progress = false;
 static bool reboot_flag = false;
 static lv_obj_t* cur_ver_label;
@@ -181,11 +176,20 @@ void version_update(int sel)
 		fp = fopen("/tmp/rd_reg","r");
 		if(!fp) return;
 		while(fgets(buf,80,fp)) {
+			dm5680_req_t rd[2];
+			uint8_t addr[2];
+
 			sscanf(buf,"%x %x",&dat[0],&dat[1]);
-			DM5680_ReadReg(dat[0], dat[1]);
-			sleep(1);
-			Printf("DM5680_0 REG[%02x,%02x]-> %02x\n", dat[0], dat[1], rx_status[0].rx_regval);
-			Printf("DM5680_1 REG[%02x,%02x]-> %02x\n", dat[0], dat[1], rx_status[1].rx_regval);
+			addr[0] = dat[0];
+			addr[1] = dat[1];
+			DM5680_request(&rd[0], 0, 0x19, addr, 2, 1000);
+			DM5680_request(&rd[1], 1, 0x19, addr, 2, 1000);
+			for(int i=0; i<2; i++) {
+				if(DM5680_req_wait(&rd[i]) == DM5680_REQ_DONE)
+					Printf("DM5680_%d REG[%02x,%02x]-> %02x\n", i, dat[0], dat[1], rd[i].data[0]);
+				else
+					Printf("DM5680_%d REG[%02x,%02x]-> timeout\n", i, dat[0], dat[1]);
+			}
 		}
 		fclose(fp);
 		//system("rm /tmp/rd_reg");
@@ -19,6 +19,7 @@ typedef enum
     MTYPE_NONE   = 0,
     MTYPE_RECORD = 1,
     MTYPE_PLAYER = 2,
+    MTYPE_RECORD_ACK = 3,	//recorder replies to REC_cmdSTARTP/STOP/STATUS
     MTYPE_BUT,
 } GoggleMsgType_e;
 
@@ -33,10 +34,39 @@ typedef enum {
 
 typedef enum {
 	REC_cmdSAVE = MSG_cmdBUTT,
+	REC_cmdSTARTAO,
+	REC_cmdSTOPAO,
+	REC_cmdSTARTP,	//start with RecordMsgParam_t, no record.conf
+	REC_cmdSTATUS,
 
 	REC_cmdBUTT,
 } RecordMsgCommand_e;
 
+typedef enum {
+	REC_stIDLE = 0,
+	REC_stRECORDING,
+	REC_stFAILED,
+} RecordMsgState_e;
+
+// Data of REC_cmdSTARTP
+typedef struct
+{
+	long format_ts;	//1=ts, 0=mp4
+	long vi_fps;
+	long venc_fps;
+	long kbps;
+	long h265;
+	long audio;
+} RecordMsgParam_t;
+
+// Data of MTYPE_RECORD_ACK; the message cmd is the command acknowledged.
+// Sent once the command took effect.
+typedef struct
+{
+	long state;		//RecordMsgState_e
+	long error;		//0 or errno
+} RecordMsgAck_t;
+
 typedef enum {
 	PLAY_cmdPAUSE = MSG_cmdBUTT,
 	PLAY_cmdSEEK,
@@ -14,6 +14,8 @@ extern "C" {
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <time.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <sys/msg.h>
@@ -23,7 +25,7 @@ extern "C" {
 #define GoggleMSG_KEY	    0x5680	//goggle message key
 
 #define CommandMSG_SIZE()	(sizeof(CommandMsg_t)-sizeof(long))
-#define DataMSG_SIZE(n)	    ((n)-sizeof(long))
+#define GoggleMSG_SIZE(len)	(sizeof(long)+(len))	//cmd and payload
 
 #if(THIS_MTYPE == MTYPE_NONE)
 #define aloge printf
@@ -41,6 +43,7 @@ extern "C" {
 /** @} */
 
 int gGoggleMsg = -1;
+int gGoggleMsgKey = GoggleMSG_KEY;
 
 /**
 * @ingroup functions implementation
@@ -51,17 +54,17 @@ int gGoggleMsg = -1;
 */
 int gogglemsg_init( int r )
 {
-	gGoggleMsg = msgget(GoggleMSG_KEY, 0);
+	gGoggleMsg = msgget(gGoggleMsgKey, 0);
 	if( !r )
 	{
 		if( gGoggleMsg < 0 )
 		{
-			gGoggleMsg = msgget(GoggleMSG_KEY, IPC_CREAT|0666);
+			gGoggleMsg = msgget(gGoggleMsgKey, IPC_CREAT|0666);
 		}
 	}
 	if( gGoggleMsg < 0 )
 	{
-		aloge("failed to require %x\n", GoggleMSG_KEY);
+		aloge("failed to require %x\n", gGoggleMsgKey);
 		return -1;
 	}
 
@@ -87,74 +90,240 @@ int gogglemsg_send( GoggleMsgType_e mtype, GoggleMsgCommand_e cmd )
 	return msgsnd( gGoggleMsg, &msg, CommandMSG_SIZE(), 0 );
 }
 
-bool gogglemsg_seek(int qid, GoggleMsgType_e mtype)
+int gogglemsg_sendMsg( GoggleMsg_t* msg, int len )
 {
-    int ret;
+	if( len < 0 || len > GOGGLEMSG_DATA_MAX ) {
+		return -1;
+	}
+
+	return msgsnd( gGoggleMsg, msg, GoggleMSG_SIZE(len), 0 );
+}
+
+int gogglemsg_sendData( GoggleMsgType_e mtype, GoggleMsgCommand_e cmd, void* data, int len )
+{
+	GoggleMsg_t msg;
+
+	if( len < 0 || len > GOGGLEMSG_DATA_MAX ) {
+		return -1;
+	}
 
-    if( (ret=msgrcv(qid, NULL, 0, mtype, IPC_NOWAIT)) == -1 ) {
-        return (errno == E2BIG);
-    }
+	msg.mtype = mtype;
+	msg.cmd = cmd;
+	memcpy(msg.u.raw, data, len);
 
-    return false;
+	return gogglemsg_sendMsg( &msg, len );
 }
 
-int gogglemsg_recv( GoggleMsgType_e mtype )
+/**
+* Mailboxes
+* gogglemsg_listen() starts a thread blocked in msgrcv() on one message type,
+* receiving straight into the free slots of that type's mailbox. Receivers
+* then sleep in gogglemsg_wait() and wake as soon as a message arrives.
+* A full mailbox is left to back up in the queue, nothing is dropped.
+*/
+#define MAILBOX_SLOTS	8
+
+typedef struct
 {
-	CommandMsg_t msg = {0, 0};
+	pthread_mutex_t lock;
+	pthread_cond_t  cond;	//message in or slot out
+	pthread_t       thread;
+	bool            running;
+	uint32_t        head;
+	uint32_t        tail;
+	GoggleMsg_t     slot[MAILBOX_SLOTS];
+	int             len[MAILBOX_SLOTS];	//payload bytes
+} Mailbox_t;
+
+static Mailbox_t gMailbox[MTYPE_BUT];
+static pthread_mutex_t gMailboxLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Payload bytes of a message msgrcv() returned n bytes of. A sender can
+// queue less than a whole cmd; the missing bytes of cmd read as zero.
+static int gogglemsg_payload( GoggleMsg_t* msg, ssize_t n )
+{
+	if( n < (ssize_t)sizeof(long) ) {
+		memset((uint8_t*)&msg->cmd + n, 0, sizeof(long) - n);
+		return 0;
+	}
+	return n - sizeof(long);
+}
+
+static void* mailbox_thread( void* arg )
+{
+	Mailbox_t* mb = (Mailbox_t*)arg;
+	long mtype = mb - gMailbox;
+	GoggleMsg_t* msg;
+	ssize_t n;
 
-	if( msgrcv(gGoggleMsg, &msg, CommandMSG_SIZE(), mtype, IPC_NOWAIT) < 0 )
+	for( ;; )
 	{
-		return MSG_none;
+		pthread_mutex_lock(&mb->lock);
+		while( mb->head - mb->tail == MAILBOX_SLOTS ) {
+			pthread_cond_wait(&mb->cond, &mb->lock);
+		}
+		msg = &mb->slot[mb->head % MAILBOX_SLOTS];
+		pthread_mutex_unlock(&mb->lock);
+
+		// the slot at head is not visible to readers until head moves
+		n = msgrcv( gGoggleMsg, msg, GoggleMSG_SIZE(GOGGLEMSG_DATA_MAX), mtype, MSG_NOERROR );
+		if( n < 0 ) {
+			if( errno == EINTR ) {
+				continue;
+			}
+			break;	//queue removed
+		}
+
+		pthread_mutex_lock(&mb->lock);
+		mb->len[mb->head % MAILBOX_SLOTS] = gogglemsg_payload(msg, n);
+		mb->head++;
+		pthread_cond_broadcast(&mb->cond);
+		pthread_mutex_unlock(&mb->lock);
 	}
 
-	return msg.cmd;
+	aloge("mailbox %ld: %s\n", mtype, strerror(errno));
+	pthread_mutex_lock(&mb->lock);
+	mb->running = false;
+	pthread_cond_broadcast(&mb->cond);
+	pthread_mutex_unlock(&mb->lock);
+	return NULL;
 }
 
-int gogglemsg_sendData( GoggleMsgType_e mtype, GoggleMsgCommand_e cmd, void* data, int len )
+int gogglemsg_listen( GoggleMsgType_e mtype )
 {
-    size_t nSize = sizeof(CommandMsg_t) + len;
-    uint8_t* msgBuff = (uint8_t*)malloc(nSize);
-    if( msgBuff == NULL ) {
-        return -1;
-    }
+	Mailbox_t* mb;
+	pthread_condattr_t attr;
+	static bool inited[MTYPE_BUT];
+	int ret = 0;
 
-    DataMsg_t* msgData = (DataMsg_t*)msgBuff;
-    msgData->msg.mtype = mtype;
-    msgData->msg.cmd = cmd;
-    memcpy(msgData->data, data, len);
+	if( mtype <= MTYPE_NONE || mtype >= MTYPE_BUT ) {
+		return -1;
+	}
+	mb = &gMailbox[mtype];
+
+	pthread_mutex_lock(&gMailboxLock);
+	if( !inited[mtype] ) {
+		pthread_mutex_init(&mb->lock, NULL);
+		pthread_condattr_init(&attr);
+		pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+		pthread_cond_init(&mb->cond, &attr);
+		pthread_condattr_destroy(&attr);
+		inited[mtype] = true;
+	}
+	if( !mb->running ) {
+		mb->head = mb->tail = 0;
+		mb->running = true;
+		ret = pthread_create(&mb->thread, NULL, mailbox_thread, mb);
+		if( ret ) {
+			mb->running = false;
+		}
+		else {
+			pthread_detach(mb->thread);
+		}
+	}
+	pthread_mutex_unlock(&gMailboxLock);
 
-    //alogd("send: %d, %d, %d\n", len, DataMSG_SIZE(nSize), nSize);
+	return ret ? -1 : 0;
+}
 
-	nSize = msgsnd( gGoggleMsg, msgBuff, DataMSG_SIZE(nSize), 0 );
-	free(msgBuff);
+/**
+* Next message of mtype into *msg, waiting up to timeout_ms (<0: forever,
+* 0: don't wait). Returns its cmd, MSG_none on timeout or -1 if the queue
+* is gone.
+*/
+int gogglemsg_wait( GoggleMsgType_e mtype, GoggleMsg_t* msg, int timeout_ms )
+{
+	Mailbox_t* mb = &gMailbox[mtype];
+	struct timespec ts;
+	int ret = 0;
 
-	return nSize;
+	if( mtype <= MTYPE_NONE || mtype >= MTYPE_BUT ) {
+		return -1;
+	}
+	if( !mb->running && gogglemsg_listen(mtype) ) {
+		return -1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	ts.tv_sec += timeout_ms / 1000;
+	ts.tv_nsec += (timeout_ms % 1000) * 1000000;
+	if( ts.tv_nsec >= 1000000000 ) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+
+	pthread_mutex_lock(&mb->lock);
+	while( mb->head == mb->tail && mb->running && ret == 0 && timeout_ms != 0 ) {
+		if( timeout_ms < 0 ) {
+			pthread_cond_wait(&mb->cond, &mb->lock);
+		}
+		else {
+			ret = pthread_cond_timedwait(&mb->cond, &mb->lock, &ts);
+		}
+	}
+
+	if( mb->head == mb->tail ) {
+		ret = mb->running ? MSG_none : -1;
+	}
+	else {
+		GoggleMsg_t* slot = &mb->slot[mb->tail % MAILBOX_SLOTS];
+		int len = mb->len[mb->tail % MAILBOX_SLOTS];
+
+		msg->mtype = slot->mtype;
+		msg->cmd = slot->cmd;
+		memcpy(msg->u.raw, slot->u.raw, len);
+		memset(msg->u.raw + len, 0, GOGGLEMSG_DATA_MAX - len);
+		mb->tail++;
+		pthread_cond_broadcast(&mb->cond);
+		ret = msg->cmd;
+	}
+	pthread_mutex_unlock(&mb->lock);
+
+	return ret;
 }
 
-int gogglemsg_recvData( GoggleMsgType_e mtype, void* data, int len )
+// Non-blocking receive, through the mailbox once one listens on mtype
+static int gogglemsg_take( GoggleMsgType_e mtype, GoggleMsg_t* msg )
 {
-	if( !gogglemsg_seek(gGoggleMsg, mtype) ) {
-        return MSG_none;
-	}
+	ssize_t n;
+	int len;
 
-    size_t nSize = sizeof(CommandMsg_t) + len;
-    uint8_t* msgBuff = (uint8_t*)malloc(nSize);
-    if( msgBuff == NULL ) {
-        return -1;
-    }
-    memset(msgBuff, 0, nSize);
+	if( mtype > MTYPE_NONE && mtype < MTYPE_BUT && gMailbox[mtype].running ) {
+		return gogglemsg_wait(mtype, msg, 0);
+	}
 
-	if( msgrcv(gGoggleMsg, msgBuff, DataMSG_SIZE(nSize), mtype, IPC_NOWAIT) < 0 )
-	{
-	    free(msgBuff);
+	n = msgrcv( gGoggleMsg, msg, GoggleMSG_SIZE(GOGGLEMSG_DATA_MAX), mtype, IPC_NOWAIT|MSG_NOERROR );
+	if( n < 0 ) {
 		return MSG_none;
 	}
+	len = gogglemsg_payload(msg, n);
+	memset(msg->u.raw + len, 0, GOGGLEMSG_DATA_MAX - len);
+
+	return msg->cmd;
+}
+
+int gogglemsg_recv( GoggleMsgType_e mtype )
+{
+	GoggleMsg_t msg;
+
+	return gogglemsg_take( mtype, &msg );
+}
+
+int gogglemsg_recvData( GoggleMsgType_e mtype, void* data, int len )
+{
+	GoggleMsg_t msg;
+	int cmd;
+
+	if( len < 0 || len > GOGGLEMSG_DATA_MAX ) {
+		return -1;
+	}
+
+	cmd = gogglemsg_take( mtype, &msg );
+	if( cmd > 0 ) {
+		memcpy(data, msg.u.raw, len);
+	}
 
-    DataMsg_t* msgData = (DataMsg_t*)msgBuff;
-    memcpy(data, msgData->data, len);
-    nSize = msgData->msg.cmd;
-    free(msgBuff);
-	return nSize;
+	return cmd;
 }
 
 #if defined (__cplusplus)
@@ -27,6 +27,21 @@ typedef struct
 	uint8_t data[1];
 } DataMsg_t;
 
+#define GOGGLEMSG_DATA_MAX	64	//largest payload
+
+// Any message on the queue, with the payloads typed by command
+typedef struct
+{
+	long mtype;
+	long cmd;
+	union {
+		uint8_t          raw[GOGGLEMSG_DATA_MAX];
+		PlayerMsgData_t  player;
+		RecordMsgParam_t rec_param;
+		RecordMsgAck_t   rec_ack;
+	} u;
+} GoggleMsg_t;
+
 /** @} */
 
 /**
@@ -36,12 +51,18 @@ typedef struct
 * This is the place to declare functions.
 * @{
 */
+extern int gGoggleMsgKey;	//queue key, tests set it before gogglemsg_init()
+
 int gogglemsg_init( int r );
 int gogglemsg_uninit( void );
 int gogglemsg_send( GoggleMsgType_e mtype, GoggleMsgCommand_e cmd );
 int gogglemsg_recv( GoggleMsgType_e mtype );
 int gogglemsg_sendData( GoggleMsgType_e mtype, GoggleMsgCommand_e cmd, void* data, int len );
 int gogglemsg_recvData( GoggleMsgType_e mtype, void* data, int len );
+int gogglemsg_sendMsg( GoggleMsg_t* msg, int len );
+int gogglemsg_listen( GoggleMsgType_e mtype );
+int gogglemsg_wait( GoggleMsgType_e mtype, GoggleMsg_t* msg, int timeout_ms );
+
 /** @} */
 
 #if defined (__cplusplus)
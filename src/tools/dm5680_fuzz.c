@@ -0,0 +1,460 @@
+// Host fuzz test and benchmark of the DM5680 receive path: the byte ring
+// (driver/ringbuf.c) and the frame parser in driver/dm5680.c.
+//
+//   cc -O2 -Isrc -Isrc/core -Isrc/driver -Isrc/page -o dm5680_fuzz src/tools/dm5680_fuzz.c
+//      src/driver/dm5680.c src/driver/uart.c src/driver/ringbuf.c
+//      src/core/reactor.c src/core/telemetry.c -lpthread
+//   ./dm5680_fuzz [-s seed] [-r rounds] [-m MB]
+//
+// ringbuf: random spans, commits, consumes, ringbuf_at() and ringbuf_view()
+// at any offset, on small rings so nearly every view wraps, checked against
+// a flat copy of the stream; then a producer and a consumer thread pushing
+// -m MB of numbered bytes through a ring in random pieces.
+//
+// parser: random streams for both UARTs, each a mix of well formed frames
+// of every command, frames shorter than their command needs, runs of
+// garbage rich in CC and 33 bytes, and frames cut off part way. They are
+// written in random pieces into socketpairs handed to DM5680_attach(), so
+// the reactor reads them exactly as it reads the UARTs, as fast as it takes
+// them. A plain byte-at-a-time parser run over the same stream says what
+// must come out: the OSD payloads (UART1, compared by count and hash),
+// right button presses (UART2) and bad frames per UART.
+// Exits non-zero if anything differs.
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "common.hh"
+#include "dm5680.h"
+#include "ringbuf.h"
+#include "reactor.h"
+#include "evloop.h"
+#include "../page/page_common.h"
+
+#define FUZZ_STREAM		(1 << 20)		//bytes per UART per round
+#define FUZZ_VER		0xEE			//version reply closing a stream
+
+typedef struct {
+	uint32_t osd, osd_hash;			//UART1 0x15 payloads
+	uint32_t keys;					//UART2 0x20
+	uint32_t bad;
+} fuzz_out_t;
+
+static int failed;
+static uint32_t rng = 1;
+
+static fuzz_out_t got[2];
+static uint8_t  *stream[2];
+static uint32_t  stream_len[2];
+static int       uart_fd[2];
+
+///////////////////////////////////////////////////////////////////////////////
+// Stubs for what dm5680.c reaches outside the driver
+op_level_t g_menu_op = OPLEVEL_VIDEO;
+
+void Printf(const char *fmt, ...)
+{
+	va_list ap;
+	int sel;
+
+	// the parser's only report of a bad frame
+	if(strstr(fmt, "bad command")) {
+		va_start(ap, fmt);
+		sel = va_arg(ap, int);
+		va_end(ap);
+		if(sel == 1 || sel == 2)
+			got[sel - 1].bad++;
+	}
+}
+
+static uint32_t fnv1a(uint32_t h, const uint8_t *p, uint32_t len)
+{
+	while(len--)
+		h = (h ^ *p++) * 16777619u;
+	return h;
+}
+
+void recive_one_frame(uint8_t *uart_buf, uint8_t uart_buf_len)
+{
+	got[0].osd++;
+	got[0].osd_hash = fnv1a(got[0].osd_hash ^ uart_buf_len, uart_buf, uart_buf_len);
+}
+
+void input_queue_put(uint8_t key) { got[1].keys++; }
+void evloop_notify(ev_task_id_t id) {}
+void thread_loop_begin(void) {}
+void thread_loop_end(void) {}
+void lqStatistics(void) {}
+void DM6302_shadow_reset(void) {}
+
+///////////////////////////////////////////////////////////////////////////////
+static uint32_t rnd(void)
+{
+	// xorshift32
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+	return rng;
+}
+
+static uint8_t rnd_byte(void)
+{
+	static const uint8_t hot[] = {0xCC, 0x33, 0x00, 0xFF, 0x15};
+	uint8_t b = rnd() % 4 ? rnd() : hot[rnd() % sizeof(hot)];
+
+	return b == FUZZ_VER ? FUZZ_VER + 1 : b;
+}
+
+static void check(bool ok, const char *fmt, ...)
+{
+	va_list ap;
+
+	printf("%s ", ok ? "ok  " : "FAIL");
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+	putchar('\n');
+	if(!ok)
+		failed++;
+}
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ringbuf against a copy of everything written, kept in a larger ring
+static uint8_t ref[4096];
+
+static bool ref_cmp(const uint8_t *p, uint32_t from, uint32_t len)
+{
+	for(uint32_t i=0; i<len; i++) {
+		if(p[i] != ref[(from + i) % sizeof(ref)])
+			return false;
+	}
+	return true;
+}
+
+static bool ring_op(ringbuf_t *rb, uint32_t *wr, uint32_t *rd)
+{
+	uint32_t queued = *wr - *rd, size = rb->size, n, span, off, len;
+	uint8_t *p;
+
+	switch(rnd() % 4) {
+		case 0:		//produce
+			span = ringbuf_write_span(rb, &p);
+			if(span > size - queued || (queued < size && span == 0))
+				return printf("write span %u with %u queued\n", span, queued), false;
+			n = span ? rnd() % (span + 1) : 0;
+			for(uint32_t i=0; i<n; i++)
+				p[i] = ref[(*wr + i) % sizeof(ref)] = rnd();
+			ringbuf_commit(rb, n);
+			*wr += n;
+			break;
+
+		case 1:		//consume
+			span = ringbuf_read_span(rb, &p);
+			if(span > queued || (queued && span == 0) || !ref_cmp(p, *rd, span))
+				return printf("read span %u with %u queued\n", span, queued), false;
+			n = span ? rnd() % (span + 1) : 0;
+			ringbuf_consume(rb, n);
+			*rd += n;
+			break;
+
+		case 2:		//peek
+			if(!queued)
+				break;
+			off = rnd() % queued;
+			if(ringbuf_at(rb, off) != ref[(*rd + off) % sizeof(ref)])
+				return printf("ringbuf_at(%u)\n", off), false;
+			break;
+
+		case 3:		//view, wrapping whenever it can
+			if(!queued)
+				break;
+			off = rnd() % queued;
+			len = 1 + rnd() % (queued - off);
+			p = ringbuf_view(rb, off, len);
+			if(!p) {
+				if(((*rd + off) & (size - 1)) + len <= size + rb->spill)
+					return printf("ringbuf_view(%u, %u) refused\n", off, len), false;
+			}
+			else if(!ref_cmp(p, *rd + off, len))
+				return printf("ringbuf_view(%u, %u) wrong\n", off, len), false;
+			break;
+	}
+	if(ringbuf_count(rb) != *wr - *rd)
+		return printf("count %u, expected %u\n", ringbuf_count(rb), *wr - *rd), false;
+	return true;
+}
+
+static bool ring_ops(uint32_t size, uint32_t spill, int ops)
+{
+	uint8_t *mem = malloc(RINGBUF_MEM(size, spill));
+	uint32_t wr = 0, rd = 0;
+	ringbuf_t rb;
+	bool ok = true;
+
+	ringbuf_init(&rb, mem, size, spill);
+	for(int i=0; i<ops && ok; i++)
+		ok = ring_op(&rb, &wr, &rd);
+	free(mem);
+	return ok;
+}
+
+typedef struct {
+	ringbuf_t rb;
+	uint64_t  bytes;
+	uint64_t  errors;
+} spsc_t;
+
+static void *spsc_producer(void *arg)
+{
+	spsc_t *s = arg;
+	uint32_t seed = 12345, n, span;
+	uint8_t *p, next = 0;
+
+	for(uint64_t done=0; done<s->bytes; done+=n) {
+		span = ringbuf_write_span(&s->rb, &p);
+		seed = seed * 1103515245 + 12345;
+		n = span ? 1 + (seed >> 16) % span : 0;
+		if(n > s->bytes - done)
+			n = s->bytes - done;
+		for(uint32_t i=0; i<n; i++)
+			p[i] = next++;
+		ringbuf_commit(&s->rb, n);
+		if(!n)
+			sched_yield();
+	}
+	return NULL;
+}
+
+static void test_ring(uint64_t bytes)
+{
+	static uint8_t mem[RINGBUF_MEM(1024, 256)];
+	uint32_t sizes[] = {1, 2, 16, 64, 1024};
+	spsc_t s = {.bytes = bytes};
+	pthread_t tid;
+	uint8_t *p, next = 0;
+	uint32_t n;
+	bool ok = true;
+	double t;
+
+	for(int i=0; i<5 && ok; i++)
+		ok = ring_ops(sizes[i], sizes[i] / 2 + 1, 200000);
+	check(ok, "ringbuf: 1M random operations on 1..1024 byte rings");
+
+	ringbuf_init(&s.rb, mem, 1024, 256);
+	t = now_s();
+	pthread_create(&tid, NULL, spsc_producer, &s);
+	for(uint64_t done=0; done<bytes; done+=n) {
+		n = ringbuf_read_span(&s.rb, &p);
+		for(uint32_t i=0; i<n; i++)
+			s.errors += p[i] != next++;
+		ringbuf_consume(&s.rb, n);
+		if(!n)
+			sched_yield();
+	}
+	pthread_join(tid, NULL);
+	t = now_s() - t;
+	check(s.errors == 0, "ringbuf: %llu MB across threads, %llu bytes out of order, %.0f MB/s",
+		  (unsigned long long)(bytes >> 20), (unsigned long long)s.errors, bytes / t / 1e6);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Streams and the reference parser
+static uint8_t min_len(uint8_t cmd)
+{
+	switch(cmd) {
+		case 0x01: return 2;
+		case 0x11: return 2;
+		case 0x12: return 6;
+		case 0x14: return 5;
+		case 0x15: return 1;
+		case 0x19: return 2;
+		case 0x20: return 2;
+		default:   return 0xFF;
+	}
+}
+
+static uint32_t gen_frame(uint8_t *p, uint32_t room)
+{
+	static const uint8_t cmds[] = {0x01, 0x11, 0x12, 0x14, 0x15, 0x15, 0x15, 0x15, 0x19, 0x20, 0x02, 0x7F};
+	uint8_t cmd = cmds[rnd() % sizeof(cmds)];
+	uint32_t len, n = 0, kind = rnd() % 16;
+
+	if(kind == 0)							//too short for its command
+		len = rnd() % (min_len(cmd) < 0xFF ? min_len(cmd) : 8);
+	else if(cmd == 0x15)					//OSD rows, mostly short
+		len = 1 + (rnd() % 4 ? rnd() % 64 : rnd() % 255);
+	else
+		len = min_len(cmd) == 0xFF ? rnd() % 256 : min_len(cmd) + rnd() % 4;
+	if(room < 3 + len)
+		return 0;
+
+	p[n++] = 0xCC;
+	p[n++] = 0x33;
+	p[n++] = len;
+	if(len)
+		p[n++] = cmd;
+	for(uint32_t i=1; i<len; i++)
+		p[n++] = rnd_byte();
+	if(kind == 1)							//cut off part way
+		n = 1 + rnd() % n;
+	return n;
+}
+
+static uint32_t gen_stream(uint8_t *p, uint32_t size)
+{
+	uint32_t n = 0, k;
+
+	while(n < size - 300) {
+		if(rnd() % 8) {
+			n += gen_frame(p + n, size - 300 - n);
+			continue;
+		}
+		k = rnd() % 24;						//garbage
+		for(uint32_t i=0; i<k; i++)
+			p[n++] = rnd() % 3 ? rnd_byte() : 0xCC;
+	}
+	// finishes a frame left open, then the end marker
+	memset(p + n, 0, 258);
+	n += 258;
+	memcpy(p + n, (uint8_t[]){0xCC, 0x33, 0x02, 0x01, FUZZ_VER}, 5);
+	return n + 5;
+}
+
+static void ref_parse(int sel, const uint8_t *p, uint32_t n, fuzz_out_t *out)
+{
+	uint32_t i = 0, len;
+
+	memset(out, 0, sizeof(*out));
+	while(i < n) {
+		if(p[i] != 0xCC) {
+			i++;
+			continue;
+		}
+		if(i + 3 > n)
+			break;
+		if(p[i+1] != 0x33) {
+			i++;
+			continue;
+		}
+		len = p[i+2];
+		if(i + 3 + len > n)
+			break;
+		if(len == 0 || len < min_len(p[i+3]))
+			out->bad++;
+		else if(sel == 0 && p[i+3] == 0x15) {
+			out->osd++;
+			out->osd_hash = fnv1a(out->osd_hash ^ (len - 1), &p[i+4], len - 1);
+		}
+		else if(sel == 1 && p[i+3] == 0x20)
+			out->keys++;
+		i += 3 + len;
+	}
+}
+
+static void *feed(void *arg)
+{
+	int sel = (intptr_t)arg;
+	uint32_t seed = sel + 1, n;
+
+	for(uint32_t pos=0; pos<stream_len[sel]; pos+=n) {
+		seed = seed * 1103515245 + 12345;
+		n = 1 + (seed >> 16) % 512;
+		if(n > stream_len[sel] - pos)
+			n = stream_len[sel] - pos;
+		if(write(uart_fd[sel], stream[sel] + pos, n) != n) {
+			printf("feed UART%d: %s\n", sel + 1, strerror(errno));
+			exit(1);
+		}
+	}
+	return NULL;
+}
+
+static void test_parser(int rounds)
+{
+	fuzz_out_t want[2];
+	pthread_t tid[2];
+	uint64_t bytes = 0;
+	double t = 0, t0;
+
+	for(int r=0; r<rounds; r++) {
+		for(int s=0; s<2; s++) {
+			stream_len[s] = gen_stream(stream[s], FUZZ_STREAM);
+			ref_parse(s, stream[s], stream_len[s], &want[s]);
+			rx_status[s].rx_ver = 0;
+			bytes += stream_len[s];
+		}
+		memset(got, 0, sizeof(got));
+
+		t0 = now_s();
+		for(int s=0; s<2; s++)
+			pthread_create(&tid[s], NULL, feed, (void *)(intptr_t)s);
+		for(int s=0; s<2; s++)
+			pthread_join(tid[s], NULL);
+		while(rx_status[0].rx_ver != FUZZ_VER || rx_status[1].rx_ver != FUZZ_VER)
+			usleep(100);
+		t += now_s() - t0;
+
+		check(!memcmp(&got[0], &want[0], sizeof(want[0])),
+			  "round %d UART1: %u/%u OSD frames, hash %08x/%08x, %u/%u bad", r,
+			  got[0].osd, want[0].osd, got[0].osd_hash, want[0].osd_hash, got[0].bad, want[0].bad);
+		check(!memcmp(&got[1], &want[1], sizeof(want[1])),
+			  "round %d UART2: %u/%u keys, %u/%u bad", r, got[1].keys, want[1].keys, got[1].bad, want[1].bad);
+	}
+	printf("parser: %.1f MB in %.3f s, %.2f MB/s, %.0fx 115200 baud per UART\n",
+		   bytes / 1e6, t, bytes / t / 1e6, bytes / 2 * 10.0 / t / 115200);
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t tid;
+	int sv[2][2], opt, rounds = 4, mb = 256;
+
+	while((opt = getopt(argc, argv, "s:r:m:")) != -1) {
+		switch(opt) {
+			case 's': rng = strtoul(optarg, NULL, 0) | 1; break;
+			case 'r': rounds = atoi(optarg); break;
+			case 'm': mb = atoi(optarg); break;
+			default:
+				fprintf(stderr, "usage: %s [-s seed] [-r rounds] [-m MB]\n", argv[0]);
+				return 2;
+		}
+	}
+	printf("seed %u\n", rng);
+
+	test_ring((uint64_t)mb << 20);
+
+	for(int s=0; s<2; s++) {
+		if(socketpair(AF_UNIX, SOCK_STREAM, 0, sv[s]) < 0) {
+			perror("socketpair");
+			return 1;
+		}
+		uart_fd[s] = sv[s][1];
+		stream[s] = malloc(FUZZ_STREAM);
+	}
+	// the driver perror()s every 0x12/0x14 frame whose CRC doesn't add up
+	freopen("/dev/null", "w", stderr);
+
+	// receive sel 0 (UART1 data, the OSD) is the left fd, see DM5680_attach()
+	reactor_init();
+	DM5680_attach(sv[1][0], sv[0][0]);
+	pthread_create(&tid, NULL, thread_reactor, NULL);
+	test_parser(rounds);
+
+	printf("%s\n", failed ? "FAILED" : "passed");
+	return failed ? 1 : 0;
+}
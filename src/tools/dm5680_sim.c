@@ -0,0 +1,286 @@
+// Host test of the DM5680 request path (driver/dm5680.c) against two
+// simulated DM5680s.
+//
+//   cc -O2 -Isrc -Isrc/core -Isrc/driver -Isrc/page -o dm5680_sim src/tools/dm5680_sim.c
+//      src/driver/dm5680.c src/driver/uart.c src/driver/ringbuf.c
+//      src/core/reactor.c src/core/telemetry.c src/core/rx_scan.c src/core/input_queue.c -lpthread
+//   ./dm5680_sim
+//
+// Each UART is a socketpair: the goggle end goes to DM5680_attach() and is
+// served by a real reactor thread, the other end by a thread playing the
+// DM5680, which counts the frames it gets and answers them only while its
+// side is set to answer. Replies carry a per-side marker, so a reply
+// credited to the wrong link shows up in the data as well as in the
+// timeouts.
+//
+// The channel scan (core/rx_scan.c) then runs against a VTX parked on each
+// channel in turn. The DM6302 is stubbed: a receiver tuned to the VTX
+// channel sees gain and reports a valid link, the other one, tuned
+// elsewhere, sees nothing. Only the VTX channel may come out valid.
+// Exits non-zero if any check failed.
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "common.hh"
+#include "dm5680.h"
+#include "reactor.h"
+#include "evloop.h"
+#include "rx_scan.h"
+#include "../minIni/minIni.h"
+#include "../page/page_common.h"
+
+#define SIM_RIGHT		0	//UART1, transmit sel 0
+#define SIM_LEFT		1	//UART2, transmit sel 1
+#define SIM_REQ_MS		50
+#define SIM_POLLS		10
+#define SIM_POLL_GAP_MS	10
+#define SIM_SETTLE_MS	250	//past DM5680_POLL_MS, so nothing is still owed
+
+typedef struct {
+	const char *name;
+	int fd;
+	volatile bool answer;
+	volatile uint32_t frames[256];	//per command
+} sim_dev_t;
+
+static sim_dev_t dev[2] = {
+	{"right", -1},
+	{"left",  -1},
+};
+static int failed;
+
+static volatile int vtx_ch = -1;		//-1: answer 0x11 with the side marker
+static volatile int tuned[2] = {-1, -1};
+static int scan_final = -1;
+
+///////////////////////////////////////////////////////////////////////////////
+// Stubs for what dm5680.c reaches outside the driver
+op_level_t g_menu_op = OPLEVEL_VIDEO;
+setting_t g_setting;
+
+void Printf(const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+}
+
+void evloop_notify(ev_task_id_t id) {}
+void thread_loop_begin(void) {}
+void thread_loop_end(void) {}
+void recive_one_frame(uint8_t *uart_buf, uint8_t uart_buf_len) {}
+void lqStatistics(void) {}
+void DM6302_shadow_reset(void) {}
+
+// sel 1 is the right DM6302, the one behind UART1
+void DM6302_SetChannelRF(uint8_t sel, uint8_t ch)
+{
+	tuned[sel - 1] = ch;
+}
+
+void DM6302_SetChannel(uint8_t ch)
+{
+	tuned[0] = tuned[1] = ch;
+	scan_final = ch;
+}
+
+// gain[0]/[2] are the right receiver's antennas, [1]/[3] the left's
+void DM6302_get_gain(uint8_t *gain)
+{
+	for(int i=0; i<4; i++)
+		gain[i] = tuned[i & 1] == vtx_ch ? 40 : 0;
+}
+
+long ini_getl(const mTCHAR *Section, const mTCHAR *Key, long DefValue, const mTCHAR *Filename)
+{
+	return DefValue;
+}
+
+int ini_putl(const mTCHAR *Section, const mTCHAR *Key, long Value, const mTCHAR *Filename)
+{
+	return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Simulated DM5680
+static void sim_reply(sim_dev_t *d, uint8_t cmd)
+{
+	uint8_t out[16] = {0xCC, 0x33};
+	uint8_t marker = d == &dev[SIM_RIGHT] ? 0xA0 : 0xB0;
+	int n = 4;
+
+	out[3] = cmd;
+	switch(cmd) {
+		case 0x11:	//valid flag
+			if(vtx_ch < 0)
+				out[n++] = marker;
+			else
+				out[n++] = tuned[d - dev] == vtx_ch;
+			break;
+		case 0x14:	//vtx_type vtx_ver vtx_stat crc
+			out[n++] = marker;
+			out[n++] = 1;
+			out[n++] = 0;
+			out[n] = out[n-3] + out[n-2] + out[n-1];
+			n++;
+			break;
+		default:
+			out[n++] = marker;
+			break;
+	}
+	out[2] = n - 3;
+	write(d->fd, out, n);
+}
+
+static void *sim_thread(void *arg)
+{
+	sim_dev_t *d = arg;
+	uint8_t buf[256];
+	int len = 0, n, i;
+
+	for(;;)
+	{
+		n = read(d->fd, buf + len, sizeof(buf) - len);
+		if(n <= 0)
+			return NULL;
+		len += n;
+
+		// AA 55 <len> <cmd> <args>
+		i = 0;
+		while(len - i >= 4) {
+			if(buf[i] != 0xAA || buf[i+1] != 0x55) {
+				i++;
+				continue;
+			}
+			if(len - i < 3 + buf[i+2])
+				break;
+			d->frames[buf[i+3]]++;
+			if(d->answer)
+				sim_reply(d, buf[i+3]);
+			i += 3 + buf[i+2];
+		}
+		memmove(buf, buf + i, len - i);
+		len -= i;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+static void check(bool ok, const char *fmt, ...)
+{
+	va_list ap;
+
+	printf("%s ", ok ? "ok  " : "FAIL");
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+	putchar('\n');
+	if(!ok)
+		failed++;
+}
+
+static void sim_reset(bool right, bool left)
+{
+	usleep(SIM_SETTLE_MS * 1000);
+	for(int s=0; s<2; s++)
+		memset((void *)dev[s].frames, 0, sizeof(dev[s].frames));
+	dev[SIM_RIGHT].answer = right;
+	dev[SIM_LEFT].answer = left;
+}
+
+// A request to the answering side completes with its own reply; one to the
+// silent side times out.
+static void test_request(int on)
+{
+	dm5680_req_t req;
+	int status;
+
+	for(int s=0; s<2; s++) {
+		DM5680_request(&req, s, 0x11, NULL, 0, SIM_REQ_MS);
+		status = DM5680_req_wait(&req);
+		if(s == on)
+			check(status == DM5680_REQ_DONE && req.len == 1 && req.data[0] == (s ? 0xB0 : 0xA0),
+				  "%s answers: request to %s done, data %02x", dev[on].name, dev[s].name, req.data[0]);
+		else
+			check(status == DM5680_REQ_TIMEOUT,
+				  "%s answers: request to %s times out (status %d)", dev[on].name, dev[s].name, status);
+	}
+}
+
+// Polls to the answering side all go out, each being answered before the
+// next; polls to the silent side are held back after the first.
+static void test_poll(int on)
+{
+	uint32_t sent;
+
+	for(int i=0; i<SIM_POLLS; i++) {
+		DM5680_req_vtxinfo(SIM_RIGHT);
+		DM5680_req_vtxinfo(SIM_LEFT);
+		usleep(SIM_POLL_GAP_MS * 1000);
+	}
+	for(int s=0; s<2; s++) {
+		sent = dev[s].frames[0x14];
+		if(s == on)
+			check(sent == SIM_POLLS, "%s answers: %d/%d polls sent to %s", dev[on].name, sent, SIM_POLLS, dev[s].name);
+		else
+			check(sent == 1, "%s answers: %d poll sent to %s", dev[on].name, sent, dev[s].name);
+	}
+	check(rx_status[on ? 0 : 1].rx_vtx_type == (on ? 0xB0 : 0xA0),
+		  "%s answers: vtx info lands in its rx_status", dev[on].name);
+}
+
+// Every channel has to be qualified by the receiver that was tuned to it
+static void test_scan(void)
+{
+	uint16_t mask;
+	int found;
+
+	for(int ch=0; ch<FREQ_NUM; ch++) {
+		vtx_ch = ch;
+		scan_final = -1;
+		found = rx_scan_full(NULL, NULL);
+		mask = rx_scan_valid_mask();
+		check(found == 1 && mask == (1 << ch) && scan_final == ch,
+			  "vtx on channel %d: %d found, mask %03x, tuned to %d", ch, found, mask, scan_final);
+	}
+	vtx_ch = -1;
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t tid;
+	int sv[2][2];
+
+	for(int s=0; s<2; s++) {
+		if(socketpair(AF_UNIX, SOCK_STREAM, 0, sv[s]) < 0) {
+			perror("socketpair");
+			return 1;
+		}
+		dev[s].fd = sv[s][1];
+		pthread_create(&tid, NULL, sim_thread, &dev[s]);
+	}
+
+	reactor_init();
+	DM5680_attach(sv[SIM_RIGHT][0], sv[SIM_LEFT][0]);
+	pthread_create(&tid, NULL, thread_reactor, NULL);
+
+	for(int on=0; on<2; on++) {
+		sim_reset(on == SIM_RIGHT, on == SIM_LEFT);
+		test_request(on);
+		sim_reset(on == SIM_RIGHT, on == SIM_LEFT);
+		test_poll(on);
+	}
+
+	sim_reset(true, true);
+	test_scan();
+
+	printf("%s\n", failed ? "FAILED" : "passed");
+	return failed ? 1 : 0;
+}
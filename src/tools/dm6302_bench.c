@@ -0,0 +1,221 @@
+// Host replay of DM6302 SPI traffic (driver/dm6302.c) over the fake I2C bus,
+// one I2C write per FPGA register against SPI bursts.
+//
+//   cc -O2 -Isrc -Isrc/core -Isrc/driver -o dm6302_bench src/tools/dm6302_bench.c
+//      src/tools/fake_i2c.c src/driver/dm6302.c src/driver/i2c.c
+//      -Wl,--wrap=open,--wrap=close,--wrap=ioctl,--wrap=usleep
+//   ./dm6302_bench [-n loops] [-u us] [-r trace]
+//
+// The sequence replayed is what DM6302_SetChannel() writes for each channel,
+// recorded at the FPGA bridge, or a trace such as dm6302_ref.trace or one
+// written by dm6302_check -w. It is sent twice:
+//   single  7 I2C_Write()s per word, 3 + 8 single transfers per read, the
+//           way dm6302.c did before SPI bursts;
+//   burst   SPI_Burst_Write()s in one burst, SPI_Read() per read.
+// Both have to put the same words on the SPI bus, in the same order, as
+// the recording. -u adds that many microseconds of sleep to every
+// I2C_RDWR ioctl, as a stand-in for the kernel and the bus.
+// Exits non-zero if a replay doesn't match.
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "i2c.h"
+#include "dm6302.h"
+#include "fake_i2c.h"
+
+#define SEQ_MAX		65536
+
+typedef struct {
+	char     op;		//'W' write, 'R' read
+	uint8_t  sel;		//W: 0=both, 1=right, 2=left
+	uint8_t  page;
+	uint16_t addr;
+	uint32_t dat;
+} word_t;
+
+static word_t seq[SEQ_MAX], got[SEQ_MAX];
+static int    seq_num, got_num;
+
+///////////////////////////////////////////////////////////////////////////////
+// Stubs for what dm6302.c reaches outside the driver
+void Printf(const char *fmt, ...) {}
+void DM5680_ResetRF(uint8_t on) {}
+int __wrap_usleep(unsigned int us) { return 0; }
+
+// a write to both DM6302s reaches the hook as right then left
+static void spi_hook(uint8_t sel, uint8_t page, uint16_t addr, uint32_t dat)
+{
+	word_t *last = got_num ? &got[got_num - 1] : NULL;
+
+	if(sel == 2 && last && last->op == 'W' && last->sel == 1 &&
+	   last->page == page && last->addr == addr && last->dat == dat) {
+		last->sel = 0;
+		return;
+	}
+	if(got_num == SEQ_MAX) {
+		fprintf(stderr, "sequence too long\n");
+		exit(1);
+	}
+	got[got_num++] = (word_t){sel ? 'W' : 'R', sel, page, addr, dat};
+}
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void record_setchannel(void)
+{
+	DM6302_shadow_reset();
+	got_num = 0;
+	for(int ch=0; ch<FREQ_NUM; ch++)
+		DM6302_SetChannel(ch);
+	memcpy(seq, got, got_num * sizeof(word_t));
+	seq_num = got_num;
+}
+
+static void record_load(const char *path)
+{
+	FILE *fp = fopen(path, "r");
+	unsigned sel, page, addr, dat;
+	char line[128], op;
+
+	if(!fp) {
+		perror(path);
+		exit(1);
+	}
+	got_num = 0;
+	while(fgets(line, sizeof(line), fp)) {
+		if(line[0] == '#' || sscanf(line, " %c %u %x %x %x", &op, &sel, &page, &addr, &dat) != 5)
+			continue;
+		if(op == 'W')
+			spi_hook(sel, page, addr, dat);
+		else if(op == 'R')
+			spi_hook(0, page, addr, 0);
+	}
+	fclose(fp);
+	memcpy(seq, got, got_num * sizeof(word_t));
+	seq_num = got_num;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Replays
+static void replay_single(void)
+{
+	for(int i=0; i<seq_num; i++) {
+		const word_t *w = &seq[i];
+
+		I2C_Write(ADDR_FPGA, 0x91, w->addr & 0xFF);
+		I2C_Write(ADDR_FPGA, 0x92, (w->page << 4) | (w->addr >> 8));
+		if(w->op == 'R') {
+			I2C_Write(ADDR_FPGA, 0x90, 0x10);
+			for(int r=0; r<8; r++)
+				I2C_Read(ADDR_FPGA, 0x98 + r);
+			continue;
+		}
+		I2C_Write(ADDR_FPGA, 0x93, w->dat & 0xFF);
+		I2C_Write(ADDR_FPGA, 0x94, (w->dat >> 8) & 0xFF);
+		I2C_Write(ADDR_FPGA, 0x95, (w->dat >> 16) & 0xFF);
+		I2C_Write(ADDR_FPGA, 0x96, (w->dat >> 24) & 0xFF);
+		I2C_Write(ADDR_FPGA, 0x90, w->sel ? w->sel : 0x03);
+	}
+}
+
+static void replay_burst(void)
+{
+	spi_burst_t burst;
+	uint32_t r0, r1;
+
+	SPI_Burst_Begin(&burst);
+	for(int i=0; i<seq_num; i++) {
+		const word_t *w = &seq[i];
+
+		if(w->op == 'R') {
+			SPI_Burst_End(&burst);
+			SPI_Read(w->page, w->addr, &r0, &r1);
+			SPI_Burst_Begin(&burst);
+		}
+		else
+			SPI_Burst_Write(&burst, w->sel, w->page, w->addr, w->dat);
+	}
+	SPI_Burst_End(&burst);
+}
+
+static bool run(const char *name, void (*replay)(void), int loops)
+{
+	fake_i2c_stats_t st;
+	double t;
+
+	got_num = 0;
+	replay();
+	if(got_num != seq_num || memcmp(got, seq, seq_num * sizeof(word_t))) {
+		for(int i=0; i<seq_num && i<got_num; i++) {
+			if(memcmp(&got[i], &seq[i], sizeof(word_t))) {
+				printf("FAIL %-6s word %d: %c %d %x %03x %08x, recorded %c %d %x %03x %08x\n", name, i,
+					   got[i].op, got[i].sel, got[i].page, got[i].addr, got[i].dat,
+					   seq[i].op, seq[i].sel, seq[i].page, seq[i].addr, seq[i].dat);
+				return false;
+			}
+		}
+		printf("FAIL %-6s %d words, recorded %d\n", name, got_num, seq_num);
+		return false;
+	}
+
+	memset(&fake_i2c_stats, 0, sizeof(fake_i2c_stats));
+	t = now_s();
+	for(int i=0; i<loops; i++) {
+		got_num = 0;
+		replay();
+	}
+	t = now_s() - t;
+	st = fake_i2c_stats;
+
+	printf("%-6s %5.1f ioctls/seq %5.2f ioctls/word %10.0f transactions/s %10.0f words/s %8.1f us/seq\n",
+		   name, (double)st.ioctls / loops, (double)st.ioctls / loops / seq_num,
+		   st.ioctls / t, (double)seq_num * loops / t, t / loops * 1e6);
+	return true;
+}
+
+static void usage(const char *me)
+{
+	fprintf(stderr, "usage: %s [-n loops] [-u us] [-r trace]\n", me);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	const char *path = NULL;
+	int loops = 2000, opt;
+	bool ok;
+
+	while((opt = getopt(argc, argv, "n:u:r:")) != -1) {
+		switch(opt) {
+			case 'n': loops = atoi(optarg); break;
+			case 'u': fake_ioctl_us = atoi(optarg); break;
+			case 'r': path = optarg; break;
+			default:  usage(argv[0]);
+		}
+	}
+	if(optind != argc || loops <= 0)
+		usage(argv[0]);
+
+	fake_spi_hook = spi_hook;
+	if(path)
+		record_load(path);
+	else
+		record_setchannel();
+	printf("%d SPI accesses from %s, %d loops, %u us per ioctl\n",
+		   seq_num, path ? path : "DM6302_SetChannel(0..9)", loops, fake_ioctl_us);
+
+	ok = run("single", replay_single, loops);
+	ok &= run("burst", replay_burst, loops);
+	printf("%s\n", ok ? "passed" : "FAILED");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,294 @@
+// Host check of the DM6302 register programs (driver/dm6302.c): the words
+// they write against those of the hand-written sequences they replaced.
+//
+//   cc -O2 -Isrc -Isrc/core -Isrc/driver -o dm6302_check src/tools/dm6302_check.c
+//      src/tools/fake_i2c.c src/driver/dm6302.c src/driver/i2c.c
+//      -Wl,--wrap=open,--wrap=close,--wrap=ioctl,--wrap=usleep
+//   ./dm6302_check src/tools/dm6302_ref.trace
+//   ./dm6302_check -w new.trace
+//
+// The scenario (init, channel changes, gain reads with the M0 started and
+// stopped in between) runs over fake_i2c, tracing every SPI word the FPGA
+// bridge forwards, per DM6302. dm6302_ref.trace is the same scenario
+// recorded from the hand-written sequences the register programs replaced,
+// which wrote every word of every sequence; it can't be recorded again, so
+// the scenario must not change. The new trace is checked against it, per
+// DM6302:
+//   - the new words are the old ones in the same order, some left out,
+//     and reads and resets line up exactly;
+//   - a word left out may only write the value the register already holds.
+// The register model used for the second point knows nothing after a reset,
+// forgets everything but the bank select (0xFF0) and 0x7FC when the M0
+// starts or stops, and learns nothing from writes made while it runs.
+// Exits non-zero if the check fails.
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include "dm6302.h"
+#include "dm5680.h"
+#include "fake_i2c.h"
+
+#define TRACE_MAX	65536
+
+typedef struct {
+	char     op;		//'W' write, 'R' read, 'X' reset
+	uint8_t  sel;		//W: 1=right, 2=left
+	uint8_t  page;
+	uint16_t addr;
+	uint32_t dat;
+} trace_t;
+
+typedef struct {
+	uint32_t val[8][1024], bval[256][1024];
+	bool     known[8][1024], bknown[256][1024];
+	bool     m0_run;
+} model_t;
+
+static trace_t trace[TRACE_MAX];
+static int     trace_num;
+static model_t model;
+
+void DM6302_shadow_reset(void) __attribute__((weak));
+
+///////////////////////////////////////////////////////////////////////////////
+// Stubs for what dm6302.c reaches outside the driver
+void Printf(const char *fmt, ...) {}
+
+int __wrap_usleep(unsigned int us) { return 0; }
+
+static void trace_add(char op, uint8_t sel, uint8_t page, uint16_t addr, uint32_t dat)
+{
+	if(trace_num == TRACE_MAX) {
+		fprintf(stderr, "trace full\n");
+		exit(1);
+	}
+	trace[trace_num++] = (trace_t){op, sel, page, addr, dat};
+}
+
+// the DM6302s are held in reset with the DM5680's resetb line
+void DM5680_ResetRF(uint8_t on)
+{
+	if(on)
+		return;
+	if(DM6302_shadow_reset)
+		DM6302_shadow_reset();
+	fake_i2c_reset();
+	trace_add('X', 0, 0, 0, 0);
+}
+
+static void spi_hook(uint8_t sel, uint8_t page, uint16_t addr, uint32_t dat)
+{
+	trace_add(sel ? 'W' : 'R', sel, page, addr, dat);
+}
+
+static void scenario(void)
+{
+	uint8_t gain[4];
+
+	DM6302_init(0);
+	for(int ch=0; ch<FREQ_NUM; ch++)
+		DM6302_SetChannel(ch);
+	DM6302_SetChannel(5);
+	DM6302_SetChannel(5);
+	DM6302_get_gain(gain);
+
+	// scanning with the M0 running, get_gain stops it
+	DM6302_openM0(1);
+	DM6302_SetChannel(2);
+	DM6302_get_gain(gain);
+	DM6302_SetChannel(2);
+	DM6302_SetChannel(7);
+
+	DM6302_openM0(1);
+	DM6302_openM0(0);
+	DM6302_SetChannel(7);
+	DM6302_SetChannel(7);
+
+	DM6302_init(3);
+	DM6302_SetChannel(3);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Trace files
+static void trace_save(const char *path)
+{
+	FILE *fp = fopen(path, "w");
+
+	if(!fp) {
+		perror(path);
+		exit(1);
+	}
+	for(int i=0; i<trace_num; i++)
+		fprintf(fp, "%c %d %x %03x %08x\n", trace[i].op, trace[i].sel, trace[i].page, trace[i].addr, trace[i].dat);
+	fclose(fp);
+}
+
+static trace_t *trace_load(const char *path, int *num)
+{
+	FILE *fp = fopen(path, "r");
+	trace_t *t = malloc(TRACE_MAX * sizeof(trace_t));
+	unsigned sel, page, addr, dat;
+	char line[128], op;
+
+	if(!fp) {
+		perror(path);
+		exit(1);
+	}
+	*num = 0;
+	while(*num < TRACE_MAX && fgets(line, sizeof(line), fp)) {
+		if(line[0] != '#' && sscanf(line, " %c %u %x %x %x", &op, &sel, &page, &addr, &dat) == 5)
+			t[(*num)++] = (trace_t){op, sel, page, addr, dat};
+	}
+	fclose(fp);
+	return t;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Register model of one DM6302
+static bool model_reg(uint8_t page, uint16_t addr, uint32_t **val, bool **known)
+{
+	uint16_t reg = (addr >> 2) & 1023;
+	uint32_t bank = model.val[6][0xFF0 >> 2];
+
+	if(page != 0x3) {
+		*val = &model.val[page & 7][reg];
+		*known = &model.known[page & 7][reg];
+		return true;
+	}
+	if(!model.known[6][0xFF0 >> 2])
+		return false;
+	*val = &model.bval[bank & 0xFF][reg];
+	*known = &model.bknown[bank & 0xFF][reg];
+	return true;
+}
+
+static bool model_noop(const trace_t *w)
+{
+	uint32_t *val;
+	bool *known;
+
+	return model_reg(w->page, w->addr, &val, &known) && *known && *val == w->dat;
+}
+
+static void model_write(const trace_t *w)
+{
+	bool keep = w->page == 0x6 && (w->addr == 0xFF0 || w->addr == 0x7FC);
+	uint32_t *val;
+	bool *known;
+
+	if(w->page == 0x6 && w->addr == 0x7FC && (bool)(w->dat & 1) != model.m0_run) {
+		bool bank = model.known[6][0xFF0 >> 2];
+
+		memset(model.known, 0, sizeof(model.known));
+		memset(model.bknown, 0, sizeof(model.bknown));
+		model.known[6][0xFF0 >> 2] = bank;
+		model.m0_run = w->dat & 1;
+	}
+
+	if(model_reg(w->page, w->addr, &val, &known)) {
+		*val = w->dat;
+		*known = !model.m0_run || keep;
+	}
+	else {
+		// unknown bank: either one may have changed
+		for(int b=0; b<256; b++)
+			model.bknown[b][(w->addr >> 2) & 1023] = false;
+	}
+}
+
+static bool same(const trace_t *a, const trace_t *b)
+{
+	return a->op == b->op && a->page == b->page && a->addr == b->addr &&
+		   (a->op != 'W' || a->dat == b->dat);
+}
+
+static const trace_t *next(const trace_t *t, int num, int *i, int sel)
+{
+	for(; *i<num; (*i)++) {
+		if(t[*i].op != 'W' || t[*i].sel == sel)
+			return &t[(*i)++];
+	}
+	return NULL;
+}
+
+static bool check_one(int sel, const trace_t *old, int old_num)
+{
+	const char *name = sel == 1 ? "right" : "left";
+	const trace_t *o, *n;
+	int oi = 0, ni = 0, words = 0, dropped = 0;
+
+	memset(&model, 0, sizeof(model));
+	n = next(trace, trace_num, &ni, sel);
+	while((o = next(old, old_num, &oi, sel)) != NULL) {
+		if(n && same(o, n)) {
+			if(o->op == 'X')
+				memset(&model, 0, sizeof(model));
+			else if(o->op == 'W') {
+				model_write(o);
+				words++;
+			}
+			n = next(trace, trace_num, &ni, sel);
+			continue;
+		}
+		if(o->op != 'W') {
+			printf("FAIL %s: reference word %d, %c %x %03x not matched\n", name, oi, o->op, o->page, o->addr);
+			return false;
+		}
+		if(!model_noop(o)) {
+			printf("FAIL %s: reference word %d, %x %03x <- %08x left out but not known to hold it\n",
+				   name, oi, o->page, o->addr, o->dat);
+			return false;
+		}
+		model_write(o);
+		dropped++;
+	}
+	if(n) {
+		printf("FAIL %s: new trace has %c %x %03x %08x past the end of the old one\n",
+			   name, n->op, n->page, n->addr, n->dat);
+		return false;
+	}
+	printf("ok   %s: %d words written, %d left out\n", name, words, dropped);
+	return true;
+}
+
+static void usage(const char *me)
+{
+	fprintf(stderr, "usage: %s [-w trace] [ref.trace]\n", me);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	const char *out = NULL;
+	trace_t *old;
+	int old_num, opt;
+	bool ok;
+
+	while((opt = getopt(argc, argv, "w:")) != -1) {
+		switch(opt) {
+			case 'w': out = optarg; break;
+			default:  usage(argv[0]);
+		}
+	}
+	if(optind < argc - 1 || (!out && optind == argc))
+		usage(argv[0]);
+
+	fake_spi_hook = spi_hook;
+	scenario();
+	printf("%d SPI accesses, %u I2C ioctls, %u messages\n",
+		   trace_num, fake_i2c_stats.ioctls, fake_i2c_stats.msgs);
+	if(out)
+		trace_save(out);
+	if(optind == argc)
+		return 0;
+
+	old = trace_load(argv[optind], &old_num);
+	ok = check_one(1, old, old_num);
+	ok &= check_one(2, old, old_num);
+	printf("%s\n", ok ? "passed" : "FAILED");
+	return ok ? 0 : 1;
+}
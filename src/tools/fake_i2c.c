@@ -0,0 +1,206 @@
+// Fake I2C adapters for the host tools, see fake_i2c.h.
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include "fake_i2c.h"
+#include "i2c.h"
+
+#define FAKE_FDS		1024
+#define FAKE_SLAVES		128
+
+typedef struct {
+	uint8_t reg[256];
+	uint8_t ptr;				//register address of the next read
+} fake_dev_t;
+
+typedef struct {
+	uint32_t reg[8][1024];		//page, 12-bit byte address
+	uint32_t bank[256][1024];	//page 3, by the 0xFF0 bank select
+} fake_dm6302_t;
+
+fake_i2c_stats_t fake_i2c_stats;
+fake_spi_fn_t    fake_spi_hook;
+uint32_t         fake_ioctl_us;
+bool             fake_i2c_fail;
+
+static int8_t        fd_port[FAKE_FDS];	//port + 1, 0 for other fds
+static fake_dev_t    dev[IIC_PORTS][FAKE_SLAVES];
+static fake_dm6302_t dm6302[2];			//0=right, 1=left
+
+int __real_open(const char *path, int flags, ...);
+int __real_close(int fd);
+int __real_ioctl(int fd, unsigned long req, ...);
+
+///////////////////////////////////////////////////////////////////////////////
+// DM6302s behind the FPGA SPI bridge
+static uint32_t *dm6302_reg(int chip, uint8_t page, uint16_t addr)
+{
+	fake_dm6302_t *d = &dm6302[chip];
+
+	addr = (addr >> 2) & 1023;
+	if((page & 7) == 0x3)
+		return &d->bank[d->reg[0x6][0xFF0 >> 2] & 0xFF][addr];
+	return &d->reg[page & 7][addr];
+}
+
+uint32_t fake_dm6302_reg(int chip, uint8_t page, uint16_t addr)
+{
+	return *dm6302_reg(chip, page, addr);
+}
+
+static void bridge_cmd(uint8_t *reg, uint8_t cmd)
+{
+	uint16_t addr = reg[0x91] | ((reg[0x92] & 0x0F) << 8);
+	uint8_t  page = reg[0x92] >> 4;
+	uint32_t dat = reg[0x93] | (reg[0x94] << 8) | (reg[0x95] << 16) | ((uint32_t)reg[0x96] << 24);
+	uint32_t v;
+
+	if(cmd == 0x10) {
+		fake_i2c_stats.spi_reads++;
+		if(fake_spi_hook)
+			fake_spi_hook(0, page, addr, 0);
+		for(int chip=0; chip<2; chip++) {
+			v = *dm6302_reg(chip, page, addr);
+			for(int i=0; i<4; i++)
+				reg[0x98 + chip*4 + i] = v >> (i * 8);
+		}
+		return;
+	}
+
+	for(int chip=0; chip<2; chip++) {
+		if(!(cmd & (1 << chip)))
+			continue;
+		*dm6302_reg(chip, page, addr) = dat;
+		fake_i2c_stats.spi_writes++;
+		if(fake_spi_hook)
+			fake_spi_hook(chip + 1, page, addr, dat);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// I2C_RDWR
+static void dev_write(int port, uint16_t slave, const uint8_t *buf, uint16_t len)
+{
+	fake_dev_t *d = &dev[port][slave & (FAKE_SLAVES - 1)];
+
+	if(len == 0)
+		return;
+	d->ptr = buf[0];
+	for(int i=1; i<len; i++) {
+		d->reg[d->ptr] = buf[i];
+		if(port == I2C_PORT_MAIN && slave == ADDR_FPGA && d->ptr == 0x90)
+			bridge_cmd(d->reg, buf[i]);
+		d->ptr++;
+	}
+}
+
+static void dev_read(int port, uint16_t slave, uint8_t *buf, uint16_t len)
+{
+	fake_dev_t *d = &dev[port][slave & (FAKE_SLAVES - 1)];
+
+	for(int i=0; i<len; i++)
+		buf[i] = d->reg[d->ptr++];
+}
+
+static int fake_rdwr(int port, struct i2c_rdwr_ioctl_data *q)
+{
+	struct timespec t = {fake_ioctl_us / 1000000, fake_ioctl_us % 1000000 * 1000};
+
+	__atomic_add_fetch(&fake_i2c_stats.ioctls, 1, __ATOMIC_RELAXED);	//buses run in parallel
+	if(fake_ioctl_us)
+		nanosleep(&t, NULL);	//waiting on the adapter, like a real transfer
+	if(fake_i2c_fail) {
+		errno = EIO;
+		return -1;
+	}
+	if(q->nmsgs > I2C_RDWR_IOCTL_MAX_MSGS) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	for(uint32_t i=0; i<q->nmsgs; i++) {
+		struct i2c_msg *m = &q->msgs[i];
+
+		__atomic_add_fetch(&fake_i2c_stats.msgs, 1, __ATOMIC_RELAXED);
+		if(m->flags & I2C_M_RD)
+			dev_read(port, m->addr, m->buf, m->len);
+		else
+			dev_write(port, m->addr, m->buf, m->len);
+	}
+	return q->nmsgs;
+}
+
+uint8_t fake_i2c_reg(int port, uint8_t slave, uint8_t reg)
+{
+	return dev[port][slave & (FAKE_SLAVES - 1)].reg[reg];
+}
+
+void fake_i2c_reset(void)
+{
+	memset(dev, 0, sizeof(dev));
+	memset(dm6302, 0, sizeof(dm6302));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Wrapped libc calls
+int __wrap_open(const char *path, int flags, ...)
+{
+	va_list ap;
+	mode_t mode = 0;
+	int fd, port;
+
+	if(strncmp(path, "/dev/i2c-", 9) == 0) {
+		port = atoi(path + 9);
+		if(port < 0 || port >= IIC_PORTS) {
+			errno = ENOENT;
+			return -1;
+		}
+		fd = __real_open("/dev/null", O_RDONLY);
+		if(fd >= 0 && fd < FAKE_FDS) {
+			fd_port[fd] = port + 1;
+			fake_i2c_stats.opens++;
+		}
+		return fd;
+	}
+
+	if(flags & O_CREAT) {
+		va_start(ap, flags);
+		mode = va_arg(ap, int);
+		va_end(ap);
+	}
+	return __real_open(path, flags, mode);
+}
+
+int __wrap_close(int fd)
+{
+	if(fd >= 0 && fd < FAKE_FDS)
+		fd_port[fd] = 0;
+	return __real_close(fd);
+}
+
+int __wrap_ioctl(int fd, unsigned long req, ...)
+{
+	va_list ap;
+	void *arg;
+
+	va_start(ap, req);
+	arg = va_arg(ap, void *);
+	va_end(ap);
+
+	if(fd >= 0 && fd < FAKE_FDS && fd_port[fd]) {
+		if(req == I2C_RDWR)
+			return fake_rdwr(fd_port[fd] - 1, arg);
+		errno = ENOTTY;
+		return -1;
+	}
+	return __real_ioctl(fd, req, arg);
+}
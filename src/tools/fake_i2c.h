@@ -0,0 +1,33 @@
+#ifndef _FAKE_I2C_H
+#define _FAKE_I2C_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Fake I2C adapters for the host tools. Link with
+//   -Wl,--wrap=open,--wrap=close,--wrap=ioctl
+// and /dev/i2c-N opens get a stand-in fd whose I2C_RDWR ioctls are served
+// here. Every device is a 256 byte register file, except ADDR_FPGA on the
+// main bus: the FPGA SPI bridge in front of the two DM6302s, each with its
+// own register file.
+typedef struct {
+	uint32_t opens;
+	uint32_t ioctls;
+	uint32_t msgs;
+	uint32_t spi_writes;	//words, counted once per DM6302 written
+	uint32_t spi_reads;
+} fake_i2c_stats_t;
+
+// sel 1/2: a word written to the right/left DM6302, 0: a read of both
+typedef void (*fake_spi_fn_t)(uint8_t sel, uint8_t page, uint16_t addr, uint32_t dat);
+
+extern fake_i2c_stats_t fake_i2c_stats;
+extern fake_spi_fn_t    fake_spi_hook;		//every SPI access the bridge forwards
+extern uint32_t         fake_ioctl_us;		//each ioctl sleeps that long
+extern bool             fake_i2c_fail;		//every ioctl fails with EIO
+
+uint8_t  fake_i2c_reg(int port, uint8_t slave, uint8_t reg);
+uint32_t fake_dm6302_reg(int chip, uint8_t page, uint16_t addr);	//chip 0=right, 1=left
+void     fake_i2c_reset(void);		//all registers back to 0, stats kept
+
+#endif
@@ -0,0 +1,264 @@
+// Host test and benchmark of the I2C layer (driver/i2c.c) on fake adapters.
+//
+//   cc -O2 -Isrc -Isrc/core -Isrc/driver -o i2c_bench src/tools/i2c_bench.c
+//      src/tools/fake_i2c.c src/driver/i2c.c -Wl,--wrap=open,--wrap=close,--wrap=ioctl -lpthread
+//   ./i2c_bench [-n regs] [-u us]
+//
+// /dev/i2c-N and its I2C_RDWR ioctl come from tools/fake_i2c.c. The checks
+// cover the transaction queue: message order, reads landing on submit, the
+// automatic submit at I2C_XFER_MAX_MSGS without splitting a read, errors
+// zeroing reads and sticking until i2c_xfer_init(), and each adapter being
+// opened only once.
+//
+// The benchmark writes the same registers three ways:
+//   reopen  open/ioctl/close per register, as i2c_write() used to
+//   single  i2c_write() per register
+//   xfer    i2c_xfer_write() per register, one i2c_xfer_submit()
+// and then runs single on two buses from two threads at once, which the
+// per-bus locks let overlap. -u adds that many microseconds of sleep to
+// every ioctl, as a stand-in for the kernel and the bus.
+// Exits non-zero if a check failed.
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <linux/i2c-dev.h>
+#include "i2c.h"
+#include "fake_i2c.h"
+
+#define TEST_SLAVE	0x50
+
+static int failed;
+static int regs = 4096;
+
+///////////////////////////////////////////////////////////////////////////////
+// Stubs for what i2c.c reaches outside the driver
+void Printf(const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+}
+
+static void check(bool ok, const char *fmt, ...)
+{
+	va_list ap;
+
+	printf("%s ", ok ? "ok  " : "FAIL");
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+	putchar('\n');
+	if(!ok)
+		failed++;
+}
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Checks
+static void test_order(void)
+{
+	i2c_xfer_t xfer;
+	uint8_t rd[4] = {0xEE, 0xEE, 0xEE, 0xEE};
+	uint32_t ioctls = fake_i2c_stats.ioctls;
+	int ret;
+
+	i2c_xfer_init(&xfer, I2C_PORT_R);
+	i2c_xfer_write(&xfer, TEST_SLAVE, 0x10, 0x11);
+	i2c_xfer_read(&xfer, TEST_SLAVE, 0x10, &rd[0]);
+	i2c_xfer_write(&xfer, TEST_SLAVE, 0x10, 0x22);
+	i2c_xfer_read(&xfer, TEST_SLAVE, 0x10, &rd[1]);
+	i2c_xfer_write(&xfer, TEST_SLAVE + 1, 0x10, 0x33);
+	i2c_xfer_read(&xfer, TEST_SLAVE, 0x10, &rd[2]);
+	i2c_xfer_read(&xfer, TEST_SLAVE + 1, 0x10, &rd[3]);
+	check(rd[0] == 0xEE && fake_i2c_stats.ioctls == ioctls, "nothing sent before submit");
+
+	ret = i2c_xfer_submit(&xfer);
+	check(ret == 0 && fake_i2c_stats.ioctls == ioctls + 1, "one ioctl for the queue");
+	check(rd[0] == 0x11 && rd[1] == 0x22 && rd[2] == 0x22 && rd[3] == 0x33,
+		  "reads see the writes queued before them: %02x %02x %02x %02x", rd[0], rd[1], rd[2], rd[3]);
+	check(i2c_read(I2C_PORT_R, TEST_SLAVE, 0x10) == 0x22, "i2c_read sees the last write");
+}
+
+static void test_full(void)
+{
+	i2c_xfer_t xfer;
+	uint8_t rd = 0;
+	uint32_t ioctls = fake_i2c_stats.ioctls;
+	int i;
+
+	i2c_xfer_init(&xfer, I2C_PORT_L);
+	for(i=0; i<I2C_XFER_MAX_MSGS; i++)
+		i2c_xfer_write(&xfer, TEST_SLAVE, i, i + 1);
+	check(fake_i2c_stats.ioctls == ioctls, "%d writes fit in one queue", I2C_XFER_MAX_MSGS);
+	i2c_xfer_write(&xfer, TEST_SLAVE, i, i + 1);
+	check(fake_i2c_stats.ioctls == ioctls + 1 && xfer.nmsgs == 1, "write %d submits the full queue", i + 1);
+	i2c_xfer_submit(&xfer);
+	for(i=0; i<=I2C_XFER_MAX_MSGS; i++) {
+		if(fake_i2c_reg(I2C_PORT_L, TEST_SLAVE, i) != i + 1)
+			break;
+	}
+	check(i == I2C_XFER_MAX_MSGS + 1, "all %d writes arrived", I2C_XFER_MAX_MSGS + 1);
+
+	ioctls = fake_i2c_stats.ioctls;
+	i2c_xfer_init(&xfer, I2C_PORT_L);
+	for(i=0; i<I2C_XFER_MAX_MSGS - 1; i++)
+		i2c_xfer_write(&xfer, TEST_SLAVE, 0x80, 0x5A);
+	i2c_xfer_read(&xfer, TEST_SLAVE, 0x80, &rd);
+	check(fake_i2c_stats.ioctls == ioctls + 1 && xfer.nmsgs == 2, "a read one message short of full goes to the next queue");
+	i2c_xfer_submit(&xfer);
+	check(rd == 0x5A, "and reads %02x", rd);
+}
+
+static void test_error(void)
+{
+	i2c_xfer_t xfer;
+	uint8_t rd = 0xEE;
+	int ret;
+
+	i2c_xfer_init(&xfer, I2C_PORT_R);
+	i2c_xfer_write(&xfer, TEST_SLAVE, 0x20, 0x44);
+	i2c_xfer_read(&xfer, TEST_SLAVE, 0x20, &rd);
+	fake_i2c_fail = true;
+	ret = i2c_xfer_submit(&xfer);
+	fake_i2c_fail = false;
+	check(ret == -1 && rd == 0, "failed submit returns -1 and zeroes reads (%d %02x)", ret, rd);
+
+	i2c_xfer_write(&xfer, TEST_SLAVE, 0x20, 0x44);
+	ret = i2c_xfer_submit(&xfer);
+	check(ret == -1, "the error sticks until i2c_xfer_init");
+	i2c_xfer_init(&xfer, I2C_PORT_R);
+	ret = i2c_xfer_submit(&xfer);
+	check(ret == 0, "and is cleared by it");
+
+	i2c_xfer_init(&xfer, IIC_PORTS);
+	i2c_xfer_write(&xfer, TEST_SLAVE, 0x20, 0x44);
+	check(i2c_xfer_submit(&xfer) == -1, "a bad port fails");
+}
+
+static void test_rw_n(void)
+{
+	uint8_t out[16], in[16];
+
+	for(int i=0; i<16; i++)
+		out[i] = 0xA0 + i;
+	memset(in, 0, sizeof(in));
+	i2c_write_n(I2C_PORT_MAIN, ADDR_AL, 0x40, out, sizeof(out));
+	i2c_read_n(I2C_PORT_MAIN, ADDR_AL, 0x40, in, sizeof(in));
+	check(!memcmp(in, out, sizeof(in)), "i2c_read_n reads back i2c_write_n");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Benchmark
+static void bench_reopen(int port)
+{
+	char dev[16];
+	struct i2c_rdwr_ioctl_data q;
+	struct i2c_msg msg;
+	uint8_t buf[2];
+	int fd;
+
+	snprintf(dev, sizeof(dev), "/dev/i2c-%d", port);
+	for(int i=0; i<regs; i++) {
+		fd = open(dev, O_RDONLY);
+		buf[0] = i;
+		buf[1] = i >> 8;
+		msg = (struct i2c_msg){TEST_SLAVE, 0, 2, buf};
+		q = (struct i2c_rdwr_ioctl_data){&msg, 1};
+		ioctl(fd, I2C_RDWR, (unsigned long)&q);
+		close(fd);
+	}
+}
+
+static void bench_single(int port)
+{
+	for(int i=0; i<regs; i++)
+		i2c_write(port, TEST_SLAVE, i, i >> 8);
+}
+
+static void bench_xfer(int port)
+{
+	i2c_xfer_t xfer;
+
+	i2c_xfer_init(&xfer, port);
+	for(int i=0; i<regs; i++)
+		i2c_xfer_write(&xfer, TEST_SLAVE, i, i >> 8);
+	i2c_xfer_submit(&xfer);
+}
+
+static void *bench_thread(void *arg)
+{
+	bench_single((intptr_t)arg);
+	return NULL;
+}
+
+static void bench_two_buses(int port)
+{
+	pthread_t tid;
+
+	pthread_create(&tid, NULL, bench_thread, (void *)(intptr_t)I2C_PORT_L);
+	bench_single(port);
+	pthread_join(tid, NULL);
+}
+
+static void bench(const char *name, void (*fn)(int), int writes)
+{
+	fake_i2c_stats_t st;
+	double t;
+
+	memset(&fake_i2c_stats, 0, sizeof(fake_i2c_stats));
+	t = now_s();
+	fn(I2C_PORT_MAIN);
+	t = now_s() - t;
+	st = fake_i2c_stats;
+	printf("%-7s %8d writes %8u ioctls %6u opens %12.0f writes/s %10.0f ioctls/s\n",
+		   name, writes, st.ioctls, st.opens, writes / t, st.ioctls / t);
+}
+
+int main(int argc, char **argv)
+{
+	int opt;
+
+	while((opt = getopt(argc, argv, "n:u:")) != -1) {
+		switch(opt) {
+			case 'n': regs = atoi(optarg); break;
+			case 'u': fake_ioctl_us = atoi(optarg); break;
+			default:
+				fprintf(stderr, "usage: %s [-n regs] [-u us]\n", argv[0]);
+				return 2;
+		}
+	}
+
+	iic_init();
+	check(fake_i2c_stats.opens == IIC_PORTS, "iic_init opens %d adapters", fake_i2c_stats.opens);
+	test_order();
+	test_full();
+	test_error();
+	test_rw_n();
+	check(fake_i2c_stats.opens == IIC_PORTS, "and nothing opens them again (%d opens)", fake_i2c_stats.opens);
+
+	printf("%u us per ioctl\n", fake_ioctl_us);
+	bench("reopen", bench_reopen, regs);
+	bench("single", bench_single, regs);
+	bench("xfer", bench_xfer, regs);
+	bench("2 buses", bench_two_buses, regs * 2);
+
+	printf("%s\n", failed ? "FAILED" : "passed");
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,145 @@
+// Host benchmark for the goggle message queue (player/gogglemsg.c).
+//
+//   cc -O2 -Isrc/player -o msg_bench src/tools/msg_bench.c src/player/gogglemsg.c -lpthread
+//   ./msg_bench [round trips]
+//
+// Forks an echo process and measures round trips with both ends blocked in
+// gogglemsg_wait(), the same with the receivers polling every 1 ms as they
+// used to, and one-way throughput of RecordMsgParam_t messages.
+// Uses the live queue; don't run it next to a goggle app or recorder.
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/wait.h>
+#include "gogglemsg.h"
+
+#define PING		MTYPE_PLAYER
+#define PONG		MTYPE_RECORD
+#define CMD_ECHO	MSG_cmdSTART
+#define CMD_POLL	MSG_cmdSTOP		//switch the echo to polling
+#define CMD_COUNT	PLAY_cmdPAUSE	//counted, acked every THRU_BATCH
+#define THRU_BATCH	1000
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec * 1e-3;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static int recv_poll(GoggleMsgType_e mtype, GoggleMsg_t *msg)
+{
+	int cmd;
+
+	while((cmd = gogglemsg_recvData(mtype, msg->u.raw, GOGGLEMSG_DATA_MAX)) == MSG_none)
+		usleep(1000);
+	msg->cmd = cmd;
+	return cmd;
+}
+
+static void echo(void)
+{
+	GoggleMsg_t msg;
+	bool poll = false;
+	long count = 0;
+	int cmd;
+
+	for(;;)
+	{
+		cmd = poll ? recv_poll(PING, &msg) : gogglemsg_wait(PING, &msg, -1);
+		if(cmd == MSG_cmdQUIT || cmd < 0)
+			exit(0);
+		if(cmd == CMD_POLL)
+			poll = true;
+		if(cmd == CMD_COUNT && ++count % THRU_BATCH)
+			continue;
+		msg.mtype = PONG;
+		gogglemsg_sendMsg(&msg, sizeof(msg.u.rec_param));
+	}
+}
+
+static void round_trips(const char *name, int n, bool poll)
+{
+	GoggleMsg_t msg;
+	double *lat = malloc(n * sizeof(double)), t, sum = 0;
+
+	for(int i=0; i<n; i++) {
+		msg.mtype = PING;
+		msg.cmd = CMD_ECHO;
+		msg.u.rec_param.kbps = i;
+		t = now_us();
+		gogglemsg_sendMsg(&msg, sizeof(msg.u.rec_param));
+		if(poll)
+			recv_poll(PONG, &msg);
+		else
+			gogglemsg_wait(PONG, &msg, -1);
+		lat[i] = now_us() - t;
+		sum += lat[i];
+		if(msg.u.rec_param.kbps != i) {
+			printf("%s: out of order reply\n", name);
+			exit(1);
+		}
+	}
+	qsort(lat, n, sizeof(double), cmp_double);
+	printf("%-8s %6d round trips: avg %.1f us, p50 %.1f us, p99 %.1f us\n",
+		   name, n, sum / n, lat[n / 2], lat[n * 99 / 100]);
+	free(lat);
+}
+
+int main(int argc, char **argv)
+{
+	GoggleMsg_t msg;
+	int n = argc > 1 ? atoi(argv[1]) : 20000;
+	int batches = n / THRU_BATCH > 0 ? n / THRU_BATCH : 1;
+	double t;
+	pid_t pid;
+
+	if(gogglemsg_init(0))
+		return 1;
+	// stale messages from an aborted run
+	while(gogglemsg_recv(PING) != MSG_none || gogglemsg_recv(PONG) != MSG_none)
+		;
+
+	pid = fork();
+	if(pid == 0)
+		echo();
+
+	round_trips("blocking", n, false);
+
+	memset(&msg, 0, sizeof(msg));
+	msg.mtype = PING;
+	msg.cmd = CMD_COUNT;
+	t = now_us();
+	for(int b=0; b<batches; b++) {
+		for(int i=0; i<THRU_BATCH; i++)
+			gogglemsg_sendMsg(&msg, sizeof(msg.u.rec_param));
+		gogglemsg_wait(PONG, &msg, -1);
+		msg.mtype = PING;
+		msg.cmd = CMD_COUNT;
+	}
+	t = now_us() - t;
+	printf("%-8s %6d messages: %.0f msg/s, %.1f us/msg\n", "one-way",
+		   batches * THRU_BATCH, batches * THRU_BATCH / t * 1e6, t / (batches * THRU_BATCH));
+
+	// the echo's mailbox thread keeps receiving; hand it over to polling
+	gogglemsg_send(PING, CMD_POLL);
+	gogglemsg_wait(PONG, &msg, -1);
+	round_trips("1ms poll", n / 100 > 10 ? n / 100 : 10, true);
+
+	gogglemsg_send(PING, MSG_cmdQUIT);
+	waitpid(pid, NULL, 0);
+	gogglemsg_uninit();
+	return 0;
+}
@@ -0,0 +1,258 @@
+// Host micro-benchmark for the displayport decoder (core/msp_decode.c).
+//
+//   cc -O2 -Isrc/core src/tools/msp_bench.c src/core/msp_decode.c -o msp_bench
+//   ./msp_bench [capture] [passes]
+//
+// capture is the raw displayport byte stream as handed to recive_one_frame(),
+// i.e. the payload of consecutive DM5680 0x15 packets. Without one, a stream
+// of random HD/SD rows and config frames is generated. Every frame is checked
+// against the old byte-at-a-time decoder before timing.
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "msp_decode.h"
+
+#define GEN_FRAMES	20000
+#define CHUNK		64		//bytes per DM5680 OSD packet, roughly
+
+typedef struct {
+	uint32_t frames;
+	uint32_t sum;
+} bench_acc_t;
+
+///////////////////////////////////////////////////////////////////////////////
+// Reference: the previous decoder, bitwise CRC-8 poly 0xD5
+static uint8_t ref_crc8(uint8_t crc, uint8_t b)
+{
+	crc ^= b;
+	for(int i=0; i<8; i++)
+		crc = (crc & 0x80) ? (crc << 1) ^ 0xD5 : crc << 1;
+	return crc;
+}
+
+static void ref_osd_line(const uint8_t *rx_buf, bool hd, uint16_t *line_buf)
+{
+	uint8_t hmax = hd ? HD_HMAX : SD_HMAX;
+	uint8_t len_mask = hd ? 7 : 4;
+	uint8_t ptr = hd ? 8 : 9;
+	uint8_t mask[7] = {0}, page_buf[7];
+	uint32_t loc_buf = 0;
+	uint8_t chNum = 0, pageNum, waddr = 0, j = 0;
+	uint16_t ch;
+
+	for(int i=0; i<SD_HMAX_EXT; i++)
+		line_buf[i] = 0x20;
+	for(int i=0; i<len_mask; i++)
+		mask[i] = rx_buf[i+1];
+	if(!hd)
+		loc_buf = rx_buf[5] | rx_buf[6] << 8 | rx_buf[7] << 16 | (uint32_t)rx_buf[8] << 24;
+	for(int i=0; i<hmax; i++)
+		chNum += (mask[i>>3] >> (i&7)) & 1;
+	pageNum = (chNum + 7) >> 3;
+	for(int i=0; i<pageNum; i++)
+		page_buf[i] = rx_buf[ptr+chNum+i];
+
+	for(int i=0; i<hmax; i++) {
+		if((mask[i>>3] >> (i&7)) & 1) {
+			ch = rx_buf[ptr++];
+			if((page_buf[j>>3] >> (j&7)) & 1) {
+				ch += 256;
+				j++;
+			}
+		}
+		else
+			ch = 0x20;
+		if((loc_buf >> i) & 1)
+			waddr = ((uint16_t)i * 904) >> 9;
+		else
+			waddr++;
+		line_buf[waddr] = ch;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Generated traffic
+static int gen_frame(uint8_t *out, int config)
+{
+	uint8_t *p = out;
+	uint8_t len, x = 0, c = 0;
+	int hd = rand() & 1;
+	uint64_t mask = 0;
+	int num, i, n;
+
+	*p++ = HEADER0;
+	*p++ = HEADER1;
+	if(config) {
+		*p++ = 0xFF;
+		len = 13;
+		*p++ = len;
+		for(i=0; i<len; i++)
+			*p++ = rand();
+	}
+	else {
+		*p++ = (hd ? HD_5018 << 5 : SD_3016 << 5) | (rand() % 16);
+		for(i=0; i<(hd ? HD_HMAX : SD_HMAX); i++)
+			if(rand() % 3 == 0)
+				mask |= 1ULL << i;
+		num = __builtin_popcountll(mask);
+		len = (hd ? 7 : 8) + num + ((num + 7) >> 3);
+		if(len >= RXBUF_SIZE)
+			return gen_frame(out, config);
+		*p++ = len;
+		for(i=0; i<(hd ? 7 : 4); i++)
+			*p++ = mask >> (8 * i);
+		if(!hd)
+			for(i=0; i<4; i++)
+				*p++ = (rand() % 4) ? 0 : rand();
+		for(i=0; i<num; i++)
+			*p++ = 0x21 + rand() % 0x5E;
+		for(i=0; i<((num + 7) >> 3); i++)
+			*p++ = rand();
+	}
+
+	n = p - out;
+	for(i=0; i<n; i++) {
+		x ^= out[i];
+		c = ref_crc8(c, out[i]);
+	}
+	*p++ = x;
+	*p++ = c;
+	// some line noise between frames
+	if(rand() % 8 == 0)
+		*p++ = rand();
+	return p - out;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+static uint8_t  *ref_frames;
+static uint32_t  ref_num, ref_cnt, mismatch;
+
+static void check_frame(uint8_t function, uint8_t index, uint8_t *rx_buf, void *arg)
+{
+	uint16_t a[SD_HMAX_EXT], b[SD_HMAX_EXT];
+	uint8_t *ref = &ref_frames[ref_cnt++ * (RXBUF_SIZE + 1)];
+
+	if(ref_cnt > ref_num || ref[0] != index || memcmp(&ref[1], rx_buf, rx_buf[0] + 1)) {
+		mismatch++;
+		return;
+	}
+	if(!function) {
+		msp_osd_line(rx_buf, (index >> 5) == HD_5018, a);
+		ref_osd_line(rx_buf, (index >> 5) == HD_5018, b);
+		if(memcmp(a, b, sizeof(a)))
+			mismatch++;
+	}
+}
+
+// Frames the old state machine accepts, one RXBUF_SIZE+1 record each
+static uint32_t ref_decode(const uint8_t *data, uint32_t len, uint8_t *out)
+{
+	uint32_t i = 0, n = 0, l;
+	uint8_t x, c;
+
+	while(i + 4 <= len) {
+		if(data[i] != HEADER0 || data[i+1] != HEADER1 || data[i+3] >= RXBUF_SIZE) {
+			i++;
+			continue;
+		}
+		l = 4 + data[i+3];
+		if(i + l + 2 > len)
+			break;
+		x = 0;
+		c = 0;
+		for(uint32_t k=0; k<l; k++) {
+			x ^= data[i+k];
+			c = ref_crc8(c, data[i+k]);
+		}
+		if(x != data[i+l] || c != data[i+l+1]) {
+			i++;
+			continue;
+		}
+		out[n * (RXBUF_SIZE + 1)] = data[i+2];
+		memcpy(&out[n * (RXBUF_SIZE + 1) + 1], &data[i+3], l - 3);
+		n++;
+		i += l + 2;
+	}
+	return n;
+}
+
+static void bench_frame(uint8_t function, uint8_t index, uint8_t *rx_buf, void *arg)
+{
+	bench_acc_t *acc = arg;
+	uint16_t line[SD_HMAX_EXT];
+
+	acc->frames++;
+	if(!function) {
+		msp_osd_line(rx_buf, (index >> 5) == HD_5018, line);
+		acc->sum += line[1];
+	}
+}
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv)
+{
+	static msp_decoder_t dec;
+	bench_acc_t acc = {0};
+	uint8_t *data;
+	uint32_t len = 0, n;
+	int passes = argc > 2 ? atoi(argv[2]) : 50;
+	double t;
+	FILE *fp;
+
+	if(argc > 1 && strcmp(argv[1], "-")) {
+		fp = fopen(argv[1], "rb");
+		if(!fp) {
+			perror(argv[1]);
+			return 1;
+		}
+		fseek(fp, 0, SEEK_END);
+		len = ftell(fp);
+		fseek(fp, 0, SEEK_SET);
+		data = malloc(len);
+		if(fread(data, 1, len, fp) != len) {
+			perror("read");
+			return 1;
+		}
+		fclose(fp);
+	}
+	else {
+		data = malloc(GEN_FRAMES * (RXBUF_SIZE + 8));
+		srand(1);
+		for(int i=0; i<GEN_FRAMES; i++)
+			len += gen_frame(&data[len], i % 10 == 0);
+	}
+
+	ref_frames = malloc((len / 6 + 1) * (RXBUF_SIZE + 1));
+	ref_num = ref_decode(data, len, ref_frames);
+	for(uint32_t off=0; off<len; off+=n) {
+		n = len - off < CHUNK ? len - off : CHUNK;
+		msp_decode(&dec, &data[off], n, check_frame, NULL);
+	}
+	printf("%u bytes, %u frames, %u crc errors, %u skipped bytes\n",
+		   len, dec.frames, dec.crc_err, dec.skipped);
+	if(mismatch || ref_cnt != ref_num) {
+		printf("MISMATCH: %u frames differ, %u decoded vs %u reference\n", mismatch, ref_cnt, ref_num);
+		return 1;
+	}
+
+	t = now_s();
+	for(int p=0; p<passes; p++)
+		for(uint32_t off=0; off<len; off+=n) {
+			n = len - off < CHUNK ? len - off : CHUNK;
+			msp_decode(&dec, &data[off], n, bench_frame, &acc);
+		}
+	t = now_s() - t;
+
+	printf("%d passes: %.0f frames/s, %.1f ns/frame, %.1f MB/s (check %u)\n", passes,
+		   acc.frames / t, t * 1e9 / acc.frames, (double)len * passes / t / 1e6, acc.sum);
+	return 0;
+}
@@ -0,0 +1,364 @@
+// Host benchmark of the FC OSD render path (core/osd.c): thread_osd
+// invalidating the changed cells and LVGL redrawing them through
+// osd_layer_draw_cb, on a busy Betaflight HD screen.
+//
+//   cc -O2 -Isrc -Isrc/lvgl -Isrc/core -Isrc/driver -Isrc/page -o osd_bench src/tools/osd_bench.c
+//      src/core/osd.c src/core/telemetry.c $(find src/lvgl/src -name '*.c')
+//      -Wl,--wrap=open -lpthread -lm
+//   ./osd_bench [-n frames] [-f font.bmp]
+//
+// Run from the top of the tree, or pass -f: OSD_FILE is served from
+// mkapp/app/OSD_FONT_BTFL_montserrant.bmp. The screen is what a 5" quad
+// shows with most Betaflight elements enabled: craft name, warnings,
+// battery, current, mAh, RSSI/LQ, timers, altitude, speed, GPS, home arrow
+// and distance, heading bar, artificial horizon with sidebars. Each frame
+// moves the horizon and heading and ticks the numbers, as they change in
+// flight; displayport parsing is left out (see msp_bench).
+//
+// Each frame goes to the real thread_osd through osd_wait_dirty() /
+// osd_front_read(), and the main thread runs lv_refr_now() on a 1280x720
+// display with the goggle's two 1/10 screen draw buffers once thread_osd
+// asks for it. At the end the screen is redrawn from scratch and compared
+// with the incrementally drawn one. Exits non-zero if they differ.
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include "lvgl/lvgl.h"
+#include "osd.h"
+#include "evloop.h"
+#include "icons.h"
+#include "recorder.h"
+#include "msp_displayport.h"
+#include "../page/page_common.h"
+#include "../driver/hardware.h"
+
+#define BENCH_HOR	1280
+#define BENCH_VER	720
+#define BENCH_BUF	(BENCH_HOR * BENCH_VER / 10)
+
+static const char *font_path = "mkapp/app/OSD_FONT_BTFL_montserrant.bmp";
+
+static lv_color_t draw_buf[2][BENCH_BUF];
+static lv_color_t fb[BENCH_VER][BENCH_HOR];
+static lv_disp_draw_buf_t disp_buf;
+static lv_disp_drv_t disp_drv;
+
+static uint16_t grid[HD_VMAX][SD_HMAX_EXT];
+static uint32_t grid_rows;			//dirty rows not yet taken by thread_osd
+static bool     font_ready, refresh;
+static pthread_mutex_t bench_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  bench_cond = PTHREAD_COND_INITIALIZER;
+
+static uint64_t flush_px;
+static uint32_t flushes;
+
+///////////////////////////////////////////////////////////////////////////////
+// Stubs for what osd.c reaches outside the compositor
+pthread_mutex_t lvgl_mutex = PTHREAD_MUTEX_INITIALIZER;
+uint16_t osd_buf_shadow[HD_VMAX][SD_HMAX_EXT];
+lv_style_t style_osd;
+setting_t g_setting;
+hw_status_t g_hw_stat;
+source_info_t g_source_info;
+bool g_latency_locked, g_showRXOSD, g_test_en;
+uint8_t fan_speeds[3];
+
+void Printf(const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+}
+
+void clear_screen() {}
+void icon_init(void) {}
+void icon_set(lv_obj_t *img, icon_id_t id) {}
+bool rec_start(const RecordMsgParam_t *param) { return false; }
+void rec_stop(void) {}
+void sdcard_recording(bool on) {}
+void step_topfan() {}
+void thread_loop_begin(void) {}
+void thread_loop_end(void) {}
+void evloop_register(ev_task_id_t id, const char *name, ev_task_fn_t fn, uint32_t period_ms) {}
+
+uint32_t wk_tick_get(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int __real_open(const char *path, int flags, ...);
+
+int __wrap_open(const char *path, int flags, ...)
+{
+	if(strcmp(path, OSD_FILE) == 0)
+		path = font_path;
+	return __real_open(path, flags);
+}
+
+// the font thread publishing a font
+void osd_mark_dirty(uint32_t rows)
+{
+	pthread_mutex_lock(&bench_mutex);
+	font_ready = true;
+	pthread_cond_broadcast(&bench_cond);
+	pthread_mutex_unlock(&bench_mutex);
+}
+
+uint32_t osd_wait_dirty(void)
+{
+	uint32_t rows;
+
+	pthread_mutex_lock(&bench_mutex);
+	while(!grid_rows)
+		pthread_cond_wait(&bench_cond, &bench_mutex);
+	rows = grid_rows;
+	pthread_mutex_unlock(&bench_mutex);
+	return rows;
+}
+
+void osd_front_read(uint16_t (*dst)[SD_HMAX_EXT], uint32_t rows)
+{
+	pthread_mutex_lock(&bench_mutex);
+	for(int i=0; i<HD_VMAX; i++) {
+		if(rows & (1 << i))
+			memcpy(dst[i], grid[i], sizeof(grid[i]));
+	}
+	grid_rows &= ~rows;
+	pthread_mutex_unlock(&bench_mutex);
+}
+
+// thread_osd asking the main loop for a refresh
+void evloop_notify(ev_task_id_t id)
+{
+	pthread_mutex_lock(&bench_mutex);
+	refresh = true;
+	pthread_cond_broadcast(&bench_cond);
+	pthread_mutex_unlock(&bench_mutex);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Display
+static void bench_flush(lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *color_p)
+{
+	uint32_t w = lv_area_get_width(area);
+
+	for(int32_t y=area->y1; y<=area->y2; y++) {
+		memcpy(&fb[y][area->x1], color_p, w * sizeof(lv_color_t));
+		color_p += w;
+	}
+	flush_px += w * lv_area_get_height(area);
+	flushes++;
+	lv_disp_flush_ready(disp);
+}
+
+static void bench_disp_init(void)
+{
+	lv_init();
+	lv_disp_draw_buf_init(&disp_buf, draw_buf[0], draw_buf[1], BENCH_BUF);
+	lv_disp_drv_init(&disp_drv);
+	disp_drv.flush_cb = bench_flush;
+	disp_drv.draw_buf = &disp_buf;
+	disp_drv.hor_res = BENCH_HOR;
+	disp_drv.ver_res = BENCH_VER;
+	lv_disp_drv_register(&disp_drv);
+	lv_style_init(&style_osd);
+	lv_style_set_bg_opa(&style_osd, LV_OPA_TRANSP);
+	lv_style_set_border_width(&style_osd, 0);
+	lv_style_set_pad_all(&style_osd, 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Busy Betaflight HD screen
+static void put(int row, int col, const char *s)
+{
+	while(*s && col < HD_HMAX)
+		grid[row][col++] = (uint8_t)*s++;
+}
+
+static void put_sym(int row, int col, uint16_t sym)
+{
+	grid[row][col] = sym;
+}
+
+static void screen_static(void)
+{
+	for(int i=0; i<HD_VMAX; i++) {
+		for(int j=0; j<SD_HMAX_EXT; j++)
+			grid[i][j] = 0x20;
+	}
+	put(0, 1, "HDZERO 5IN");
+	put_sym(0, 20, 0x01); put(0, 21, "RSSI");
+	put(1, 19, "*** LOW BATTERY ***");
+	put_sym(15, 1, 0x7E); put(15, 2, "4S");
+	put_sym(16, 1, 0x9C);
+	put_sym(16, 14, 0x9B);
+	put_sym(2, 40, 0x11); put_sym(3, 40, 0x12);
+	put_sym(17, 40, 0x9F);
+	put_sym(8, 25, 0x72); put_sym(8, 26, 0x73);	//crosshair
+}
+
+static void screen_frame(int f)
+{
+	char s[24];
+	int roll = (f % 120) - 60, pitch = (f % 80) - 40;
+
+	// flight values
+	snprintf(s, sizeof(s), "%2d.%02dV", 15 - f / 3000 % 4, 99 - f / 30 % 100);
+	put(15, 4, s);
+	snprintf(s, sizeof(s), "%5.1fA", 10 + (f % 97) * 0.4);
+	put(16, 2, s);
+	snprintf(s, sizeof(s), "%4dMAH", f / 7 % 10000);
+	put(16, 9, s);
+	snprintf(s, sizeof(s), "%3d", 99 - f / 50 % 20);
+	put(0, 25, s);
+	snprintf(s, sizeof(s), "%02d:%02d", f / 3600 % 60, f / 60 % 60);
+	put_sym(0, 43, 0x9C); put(0, 44, s);
+	snprintf(s, sizeof(s), "%02d:%02d", f / 2400 % 60, f / 40 % 60);
+	put_sym(1, 43, 0x9B); put(1, 44, s);
+	snprintf(s, sizeof(s), "%4dM", 120 + (f % 300) - 150);
+	put_sym(15, 40, 0x7F); put(15, 41, s);
+	snprintf(s, sizeof(s), "%3dKM/H", 40 + f % 80);
+	put(16, 41, s);
+	snprintf(s, sizeof(s), "%4dM", f / 5 % 2000);
+	put_sym(14, 24, 0x60 + f / 10 % 16); put(14, 25, s);
+	snprintf(s, sizeof(s), "%9.6f", 47.123456 + f * 1e-6);
+	put(2, 41, s);
+	snprintf(s, sizeof(s), "%9.6f", 8.654321 + f * 1e-6);
+	put(3, 41, s);
+	snprintf(s, sizeof(s), "%2d", 12 + f / 500 % 6);
+	put(17, 41, s);
+
+	// heading bar, 13 cells scrolling
+	for(int i=0; i<13; i++) {
+		int h = (f + i * 8) % 96;
+		put_sym(2, 19 + i, h % 24 == 0 ? 0x18 + h / 24 : (h % 8 == 0 ? 0x1D : 0x1C));
+	}
+
+	// artificial horizon, 9 x 7 around the crosshair, and the sidebars
+	for(int row=5; row<=11; row++) {
+		for(int col=21; col<=29; col++)
+			put_sym(row, col, 0x20);
+	}
+	for(int col=21; col<=29; col++) {
+		int y = 8 * 9 + pitch / 2 + (col - 25) * roll / 20;	//ninths of a row
+		int row = y / 9;
+		if(row >= 5 && row <= 11 && !(row == 8 && (col == 25 || col == 26)))
+			put_sym(row, col, 0x80 + y % 9);
+	}
+	for(int row=5; row<=11; row++) {
+		put_sym(row, 19, row == 8 ? 0x02 : 0x13);
+		put_sym(row, 31, row == 8 ? 0x03 : 0x13);
+	}
+}
+
+static void post_frame(void)
+{
+	pthread_mutex_lock(&bench_mutex);
+	grid_rows = OSD_ALL_ROWS;
+	refresh = false;
+	pthread_cond_broadcast(&bench_cond);
+	while(!refresh)
+		pthread_cond_wait(&bench_cond, &bench_mutex);
+	pthread_mutex_unlock(&bench_mutex);
+}
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double refr(void)
+{
+	double t;
+
+	pthread_mutex_lock(&lvgl_mutex);
+	t = now_s();
+	lv_refr_now(NULL);
+	t = now_s() - t;
+	pthread_mutex_unlock(&lvgl_mutex);
+	return t;
+}
+
+int main(int argc, char **argv)
+{
+	static lv_color_t fb_inc[BENCH_VER][BENCH_HOR];
+	pthread_t tid;
+	int frames = 2000, opt;
+	double t, t_refr = 0, t_full;
+	uint32_t flushes0;
+	uint64_t px0;
+
+	while((opt = getopt(argc, argv, "n:f:")) != -1) {
+		switch(opt) {
+			case 'n': frames = atoi(optarg); break;
+			case 'f': font_path = optarg; break;
+			default:
+				fprintf(stderr, "usage: %s [-n frames] [-f font.bmp]\n", argv[0]);
+				return 2;
+		}
+	}
+	if(access(font_path, R_OK)) {
+		perror(font_path);
+		return 1;
+	}
+
+	bench_disp_init();
+	osd_init();
+	osd_show(true);
+	refr();
+
+	pthread_create(&tid, NULL, thread_osd_font, NULL);
+	pthread_mutex_lock(&bench_mutex);
+	while(!font_ready)
+		pthread_cond_wait(&bench_cond, &bench_mutex);
+	pthread_mutex_unlock(&bench_mutex);
+	pthread_create(&tid, NULL, thread_osd, NULL);
+
+	// first frame: the whole grid
+	screen_static();
+	screen_frame(0);
+	post_frame();
+	t_full = refr();
+
+	flushes0 = flushes;
+	px0 = flush_px;
+	t = now_s();
+	for(int f=1; f<=frames; f++) {
+		screen_frame(f);
+		post_frame();
+		t_refr += refr();
+	}
+	t = now_s() - t;
+
+	printf("first frame %.2f ms\n", t_full * 1e3);
+	printf("%d frames: %.1f frames/s, refresh %.1f us/frame, %.0f px and %.1f flushes/frame\n",
+		   frames, frames / t, t_refr / frames * 1e6,
+		   (double)(flush_px - px0) / frames, (double)(flushes - flushes0) / frames);
+
+	memcpy(fb_inc, fb, sizeof(fb));
+	pthread_mutex_lock(&lvgl_mutex);
+	lv_obj_invalidate(lv_scr_act());
+	pthread_mutex_unlock(&lvgl_mutex);
+	refr();
+	if(memcmp(fb_inc, fb, sizeof(fb))) {
+		printf("FAILED: incremental frame differs from a full redraw\n");
+		return 1;
+	}
+	printf("passed\n");
+	return 0;
+}
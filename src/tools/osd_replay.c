@@ -0,0 +1,191 @@
+// Host replay of a DM5680 UART capture through the displayport parser
+// (core/msp_displayport.c), for OSD regression checks.
+//
+//   cc -O2 -Isrc/core -Isrc/driver -o osd_replay src/tools/osd_replay.c
+//      src/core/msp_displayport.c src/core/msp_decode.c src/core/telemetry.c -lpthread
+//   ./osd_replay [-b baud] [-g] capture
+//
+// capture is the raw UART1 stream the goggle writes to DM5680_CAPTURE
+// (/mnt/extsd/dm5680_uart1.bin) when that file exists at boot. It is split
+// into CC 33 <len> <cmd> packets as on the goggle and every 0x15 payload is
+// handed to recive_one_frame(). -b replays in real time at that UART rate,
+// the default 0 as fast as possible. The parser clock (seconds) follows the
+// stream position at -b, or 115200 baud, so LQ statistics come out the same
+// at any speed.
+//
+// stdout carries the CAM_MODE / resolution / font / LQ transitions and, with
+// -g, every committed OSD frame, stamped with stream time; it is meant to
+// be diffed against the output of a known good build. The throughput summary
+// goes to stderr.
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "msp_displayport.h"
+
+#define REPLAY_BAUD		115200
+
+static uint16_t grid[HD_VMAX][SD_HMAX_EXT];
+static double   stream_t;		//s, stream time of the current packet
+
+static uint32_t fnv1a(const void *data, uint32_t len)
+{
+	const uint8_t *p = data;
+	uint32_t h = 2166136261u;
+
+	while(len--)
+		h = (h ^ *p++) * 16777619u;
+	return h;
+}
+
+// Stub of the compositor call the config parser makes on every config frame
+void osd_font_select(uint8_t variant)
+{
+	static int last = -1;
+
+	if(variant != last)
+		printf("[%9.3f] font %d\n", stream_t, variant);
+	last = variant;
+}
+
+static void dump_grid(uint32_t rows)
+{
+	int hmax = resolution == HD_5018 ? HD_HMAX : SD_HMAX;
+	int vmax = resolution == HD_5018 ? HD_VMAX : SD_VMAX;
+
+	printf("[%9.3f] frame rows %x hash %08x\n", stream_t, rows, fnv1a(grid, sizeof(grid)));
+	for(int i=0; i<vmax; i++) {
+		putchar('|');
+		for(int j=0; j<hmax; j++) {
+			uint16_t ch = grid[i][j];
+			putchar(ch >= 0x20 && ch < 0x7F ? ch : ch > 0xFF ? '#' : '.');
+		}
+		printf("|\n");
+	}
+}
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void usage(const char *me)
+{
+	fprintf(stderr, "usage: %s [-b baud] [-g] capture\n", me);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	uint8_t *data;
+	uint32_t len, i = 0, pkt_len, osd_pkts = 0, osd_bytes = 0, frames = 0, bad = 0;
+	int baud = 0, show_grid = 0, opt;
+	video_resolution_t cam_last;
+	osd_resolution_t res_last;
+	uint8_t lq_last;
+	uint32_t rows;
+	double t0, t_parse = 0, t;
+	FILE *fp;
+
+	while((opt = getopt(argc, argv, "b:g")) != -1) {
+		switch(opt) {
+			case 'b': baud = atoi(optarg); break;
+			case 'g': show_grid = 1; break;
+			default:  usage(argv[0]);
+		}
+	}
+	if(optind >= argc)
+		usage(argv[0]);
+
+	fp = fopen(argv[optind], "rb");
+	if(!fp) {
+		perror(argv[optind]);
+		return 1;
+	}
+	fseek(fp, 0, SEEK_END);
+	len = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	data = malloc(len);
+	if(fread(data, 1, len, fp) != len) {
+		perror("read");
+		return 1;
+	}
+	fclose(fp);
+
+	fc_init();
+	osd_take_dirty();
+	cam_last = CAM_MODE;
+	res_last = resolution;
+	lq_last = link_quality;
+	printf("[%9.3f] CAM_MODE %d resolution %d LQ %d\n", 0.0, cam_last, res_last, lq_last);
+
+	t0 = now_s();
+	while(i + 4 <= len)
+	{
+		// same framing as dm5680_parse()
+		if(data[i] != 0xCC || data[i+1] != 0x33) {
+			i++;
+			continue;
+		}
+		pkt_len = data[i+2];
+		if(i + 3 + pkt_len > len)
+			break;
+		i += 3 + pkt_len;
+		if(pkt_len == 0) {
+			bad++;
+			continue;
+		}
+		if(data[i-pkt_len] != 0x15)
+			continue;
+
+		stream_t = (double)i * 10 / (baud ? baud : REPLAY_BAUD);
+		seconds = (int)stream_t;
+		if(baud) {
+			t = now_s() - t0;
+			if(stream_t > t)
+				usleep((stream_t - t) * 1e6);
+		}
+
+		t = now_s();
+		recive_one_frame(&data[i-pkt_len+1], pkt_len - 1);
+		lqStatistics();
+		t_parse += now_s() - t;
+		osd_pkts++;
+		osd_bytes += pkt_len - 1;
+
+		if(CAM_MODE != cam_last || resolution != res_last) {
+			printf("[%9.3f] CAM_MODE %d -> %d, resolution %d -> %d\n",
+				   stream_t, cam_last, CAM_MODE, res_last, resolution);
+			cam_last = CAM_MODE;
+			res_last = resolution;
+		}
+		if(link_quality != lq_last) {
+			printf("[%9.3f] LQ %d -> %d\n", stream_t, lq_last, link_quality);
+			lq_last = link_quality;
+		}
+
+		rows = osd_take_dirty();
+		if(rows) {
+			frames++;
+			osd_front_read(grid, OSD_ALL_ROWS);
+			if(show_grid)
+				dump_grid(rows);
+		}
+	}
+
+	osd_front_read(grid, OSD_ALL_ROWS);
+	printf("[%9.3f] end, %u frames, final hash %08x\n", stream_t, frames, fnv1a(grid, sizeof(grid)));
+
+	t = now_s() - t0;
+	fprintf(stderr, "%u bytes, %u OSD packets (%u payload bytes), %u bad packets, %u frames\n",
+			len, osd_pkts, osd_bytes, bad, frames);
+	if(osd_pkts && t_parse > 0)
+		fprintf(stderr, "parse %.1f ns/packet, %.1f MB/s; wall %.3f s for %.3f s of stream\n",
+				t_parse * 1e9 / osd_pkts, osd_bytes / t_parse / 1e6, t, stream_t);
+	return 0;
+}
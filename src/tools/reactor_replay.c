@@ -0,0 +1,255 @@
+// Host replay of recorded goggle input through the I/O reactor
+// (core/reactor.c), the DM5680 receive path and the input key queue.
+//
+//   cc -O2 -Isrc -Isrc/core -Isrc/driver -Isrc/page -o reactor_replay src/tools/reactor_replay.c
+//      src/driver/dm5680.c src/driver/uart.c src/driver/ringbuf.c src/core/reactor.c
+//      src/core/telemetry.c src/core/input_queue.c -lpthread
+//   ./reactor_replay [-b baud] [-k dial.bin] capture
+//
+// capture is a DM5680_CAPTURE file, the raw OSD UART stream. dial.bin is a
+// copy of the dial's event device taken on the goggle
+// (cat /dev/input/event1 > dial.bin), i.e. 16 byte 32-bit struct
+// input_event records. The capture goes into a socketpair handed to
+// DM5680_attach() and the dial records into a pipe handed to
+// input_queue_add(), so the reactor thread reads them exactly as it reads
+// the devices. -b paces the capture at that UART rate and the dial at its
+// recorded times; the default 0 writes both as fast as the reactor takes
+// them.
+//
+// stdout lists the keys the reactor queued, in order, and the frame counts;
+// it is meant to be diffed against a known good build. Throughput and
+// reactor wakeups go to stderr.
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <linux/input.h>
+#include "common.hh"
+#include "dm5680.h"
+#include "reactor.h"
+#include "evloop.h"
+#include "input_queue.h"
+#include "../page/page_common.h"
+
+#define REPLAY_CHUNK	64
+#define REPLAY_VER		0xEE	//version reply closing the stream
+
+typedef struct {
+	uint32_t sec;
+	uint32_t usec;
+	uint16_t type;
+	uint16_t code;
+	int32_t  value;
+} event32_t;					//struct input_event on the goggle
+
+static uint8_t  *uart_data;
+static long      uart_len;
+static event32_t *dial;
+static long      dial_num;
+static int       baud;
+static int       uart_fd = -1, dial_fd = -1;
+
+static atomic_uint osd_frames, wakeups;
+
+///////////////////////////////////////////////////////////////////////////////
+// Stubs for what dm5680.c reaches outside the driver
+op_level_t g_menu_op = OPLEVEL_VIDEO;
+
+void Printf(const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+}
+
+void evloop_notify(ev_task_id_t id) {}
+void thread_loop_begin(void) { wakeups++; }
+void thread_loop_end(void) {}
+void recive_one_frame(uint8_t *uart_buf, uint8_t uart_buf_len) { osd_frames++; }
+void lqStatistics(void) {}
+void DM6302_shadow_reset(void) {}
+
+///////////////////////////////////////////////////////////////////////////////
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void *load(const char *path, long *len)
+{
+	FILE *fp = fopen(path, "rb");
+	void *data;
+
+	if(!fp) {
+		perror(path);
+		exit(1);
+	}
+	fseek(fp, 0, SEEK_END);
+	*len = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	data = malloc(*len + 1);
+	if(fread(data, 1, *len, fp) != *len) {
+		perror(path);
+		exit(1);
+	}
+	fclose(fp);
+	return data;
+}
+
+static void write_all(int fd, const void *data, long len)
+{
+	const uint8_t *p = data;
+	long n;
+
+	while(len > 0) {
+		n = write(fd, p, len);
+		if(n <= 0) {
+			perror("replay write");
+			exit(1);
+		}
+		p += n;
+		len -= n;
+	}
+}
+
+static void *uart_feed(void *arg)
+{
+	// completes any frame the capture ends inside, then marks the end
+	static const uint8_t tail[3] = {0xCC, 0x33, 0x02};
+	uint8_t pad[258] = {0}, end[2] = {0x01, REPLAY_VER};
+	double start = now_s(), due;
+	long n;
+
+	for(long pos=0; pos<uart_len; pos+=n) {
+		n = uart_len - pos < REPLAY_CHUNK ? uart_len - pos : REPLAY_CHUNK;
+		if(baud) {
+			due = start + (pos + n) * 10.0 / baud;
+			while(now_s() < due)
+				usleep((due - now_s()) * 1e6 + 1);
+		}
+		write_all(uart_fd, uart_data + pos, n);
+	}
+	write_all(uart_fd, pad, sizeof(pad));
+	write_all(uart_fd, tail, sizeof(tail));
+	write_all(uart_fd, end, sizeof(end));
+	return NULL;
+}
+
+static void *dial_feed(void *arg)
+{
+	struct input_event ev;
+	double start = now_s(), due;
+
+	for(long i=0; i<dial_num; i++) {
+		if(baud) {
+			due = start + (dial[i].sec - dial[0].sec) + (dial[i].usec - (double)dial[0].usec) * 1e-6;
+			while(now_s() < due)
+				usleep((due - now_s()) * 1e6 + 1);
+		}
+		memset(&ev, 0, sizeof(ev));
+		ev.type = dial[i].type;
+		ev.code = dial[i].code;
+		ev.value = dial[i].value;
+		write_all(dial_fd, &ev, sizeof(ev));
+	}
+	return NULL;
+}
+
+static const char *key_name(int key)
+{
+	switch(key) {
+		case DIAL_KEY_UP:     return "dial up";
+		case DIAL_KEY_DOWN:   return "dial down";
+		case DIAL_KEY_CLICK:  return "dial click";
+		case DIAL_KEY_PRESS:  return "dial press";
+		case RIGHT_KEY_CLICK: return "right click";
+		case RIGHT_KEY_PRESS: return "right press";
+		default:              return "?";
+	}
+}
+
+static void usage(const char *me)
+{
+	fprintf(stderr, "usage: %s [-b baud] [-k dial.bin] capture\n", me);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t tid, uart_tid, dial_tid;
+	const char *dial_path = NULL;
+	int sv[2][2], pv[2], opt, key, keys = 0;
+	bool done = false;
+	long dial_len;
+	double t;
+
+	while((opt = getopt(argc, argv, "b:k:")) != -1) {
+		switch(opt) {
+			case 'b': baud = atoi(optarg); break;
+			case 'k': dial_path = optarg; break;
+			default:  usage(argv[0]);
+		}
+	}
+	if(optind != argc - 1)
+		usage(argv[0]);
+
+	uart_data = load(argv[optind], &uart_len);
+	if(dial_path) {
+		dial = load(dial_path, &dial_len);
+		dial_num = dial_len / sizeof(event32_t);
+	}
+
+	// the capture is of receive sel 0, the left UART
+	if(socketpair(AF_UNIX, SOCK_STREAM, 0, sv[0]) < 0 ||
+	   socketpair(AF_UNIX, SOCK_STREAM, 0, sv[1]) < 0 || pipe(pv) < 0) {
+		perror("replay");
+		return 1;
+	}
+	uart_fd = sv[1][1];
+	dial_fd = pv[1];
+
+	reactor_init();
+	input_queue_init();
+	DM5680_attach(sv[0][0], sv[1][0]);
+	input_queue_add(pv[0]);
+	pthread_create(&tid, NULL, thread_reactor, NULL);
+
+	t = now_s();
+	pthread_create(&uart_tid, NULL, uart_feed, NULL);
+	pthread_create(&dial_tid, NULL, dial_feed, NULL);
+
+	pthread_join(dial_tid, NULL);
+	pthread_join(uart_tid, NULL);
+	for(;;) {
+		key = input_queue_get(done ? 100 : 0);
+		if(key >= 0)
+			printf("key %d: %s\n", ++keys, key_name(key));
+		else if(done)
+			break;
+		else if(rx_status[0].rx_ver == REPLAY_VER) {
+			t = now_s() - t;
+			done = true;
+		}
+		else
+			usleep(50);
+	}
+
+	printf("%ld bytes, %d OSD frames, %d keys\n", uart_len, osd_frames, keys);
+	printf("rx: rssi %d/%d DLQ %d vtx %x/%x/%x\n", rx_status[0].rx_rssi[0], rx_status[0].rx_rssi[1],
+		   rx_status[0].rx_DLQ, rx_status[0].rx_vtx_type, rx_status[0].rx_vtx_ver, rx_status[0].rx_vtx_stat);
+	fprintf(stderr, "%.3f s, %.2f MB/s (%.0fx 115200 baud), %d reactor wakeups, %.1f bytes/wakeup\n",
+			t, uart_len / t / 1e6, uart_len * 10.0 / t / 115200, wakeups,
+			(double)uart_len / (wakeups ? wakeups : 1));
+	return 0;
+}
@@ -0,0 +1,212 @@
+// Host check of the recorder control (core/recorder.c) against rec_stub.
+//
+//   cc -O2 -Isrc -Isrc/core -Isrc/player -o rec_check src/tools/rec_check.c
+//      src/core/recorder.c src/player/gogglemsg.c src/minIni/minIni.c -lpthread
+//   ./rec_check [rec_stub]
+//
+// Forks rec_stub on a message queue of its own, so a goggle app or
+// recorder on the same machine is left alone, and drives it through
+// rec_start()/rec_stop():
+//   - an acking recorder starting, stopping, starting slower than the old
+//     1.5 s ack timeout, starting slower than the ack timeout itself, which
+//     rec_start() has to settle with REC_cmdSTATUS, and failing a start;
+//   - a legacy recorder (-l) replacing it, which goes unanswered until
+//     rec_start() probes again, then starting, stopping and failing a start
+//     through /tmp/record.dat.
+// Each start takes a few seconds at most; the whole run about ten.
+// Exits non-zero if a check failed.
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/msg.h>
+#include <sys/wait.h>
+#include "recorder.h"
+#include "gogglemsg.h"
+
+#define STATUS_FILE		"/tmp/record.dat"
+
+static int failed;
+static const char *stub_path = "./rec_stub";
+static pid_t stub_pid = -1;
+static char log_buf[4096];
+
+///////////////////////////////////////////////////////////////////////////////
+// Stubs for what recorder.c reaches outside the driver
+void Printf(const char *fmt, ...)
+{
+	size_t n = strlen(log_buf);
+	va_list ap;
+
+	va_start(ap, fmt);
+	vsnprintf(log_buf + n, sizeof(log_buf) - n, fmt, ap);
+	va_end(ap);
+}
+
+static void check(bool ok, const char *fmt, ...)
+{
+	va_list ap;
+
+	printf("%s ", ok ? "ok  " : "FAIL");
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+	putchar('\n');
+	if(!ok) {
+		printf("     recorder.c said: %s", log_buf[0] ? log_buf : "nothing\n");
+		failed++;
+	}
+	fflush(stdout);
+}
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// "1" while rec_stub records, "0" otherwise, "" before it is up
+static char status_file(void)
+{
+	char c = 0;
+	FILE *fp = fopen(STATUS_FILE, "r");
+
+	if(fp) {
+		fread(&c, 1, 1, fp);
+		fclose(fp);
+	}
+	return c;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// rec_stub
+static void stub_stop(void)
+{
+	if(stub_pid < 0)
+		return;
+	kill(stub_pid, SIGTERM);
+	waitpid(stub_pid, NULL, 0);
+	stub_pid = -1;
+}
+
+// Starts rec_stub with the given options and waits until it serves the queue
+static void stub_start(const char *opts)
+{
+	char key[16], cmd[256];
+	double t;
+
+	stub_stop();
+	unlink(STATUS_FILE);
+	snprintf(key, sizeof(key), "%#x", gGoggleMsgKey);
+	snprintf(cmd, sizeof(cmd), "exec %s -k %s %s", stub_path, key, opts);
+	printf("rec_stub %s\n", opts);
+	fflush(stdout);
+
+	stub_pid = fork();
+	if(stub_pid == 0) {
+		execl("/bin/sh", "sh", "-c", cmd, (char *)NULL);
+		_exit(127);
+	}
+	for(t = now_s(); status_file() != '0'; usleep(1000)) {
+		if(stub_pid < 0 || waitpid(stub_pid, NULL, WNOHANG) || now_s() - t > 2) {
+			fprintf(stderr, "%s didn't start\n", stub_path);
+			exit(1);
+		}
+	}
+}
+
+static bool start(const char *what, bool want, double *secs)
+{
+	RecordMsgParam_t param = {.format_ts = 1, .vi_fps = 60, .venc_fps = 60, .kbps = 40000};
+	double t = now_s();
+	bool ok;
+
+	log_buf[0] = 0;
+	ok = rec_start(&param);
+	*secs = now_s() - t;
+	check(ok == want, "%s: rec_start() %s in %.2f s", what, ok ? "started" : "failed", *secs);
+	return ok;
+}
+
+static void stop(const char *what)
+{
+	log_buf[0] = 0;
+	rec_stop();
+	check(status_file() == '0', "%s: rec_stop() stopped it", what);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+static void test_ack(void)
+{
+	double t;
+
+	stub_start("");
+	start("acking", true, &t);
+	check(strstr(log_buf, "recorder: acked") != NULL, "acking: probed as acking");
+	check(status_file() == '1', "acking: recording");
+	stop("acking");
+
+	stub_start("-d 1800");
+	start("acking, 1.8 s start", true, &t);
+	check(!strstr(log_buf, "no ack"), "acking, 1.8 s start: acked in time");
+	stop("acking, 1.8 s start");
+
+	stub_start("-d 2500");
+	start("acking, 2.5 s start", true, &t);
+	check(strstr(log_buf, "asking for status") != NULL, "acking, 2.5 s start: settled by REC_cmdSTATUS");
+	stop("acking, 2.5 s start");
+
+	stub_start("-f");
+	start("acking, failing", false, &t);
+	check(strstr(log_buf, "rec_start failed: 5") != NULL && t < 1, "acking, failing: error from the ack");
+}
+
+static void test_legacy(void)
+{
+	double t;
+
+	// still taken for an acking one
+	stub_start("-l");
+	start("legacy, unprobed", false, &t);
+	check(strstr(log_buf, "no status") != NULL, "legacy, unprobed: neither ack nor status");
+	start("legacy", true, &t);
+	check(strstr(log_buf, "recorder: legacy") != NULL, "legacy: probed again, as legacy");
+	check(status_file() == '1', "legacy: recording");
+	stop("legacy");
+
+	stub_start("-l -f");
+	start("legacy, failing", false, &t);
+}
+
+int main(int argc, char **argv)
+{
+	if(argc > 2) {
+		fprintf(stderr, "usage: %s [rec_stub]\n", argv[0]);
+		return 2;
+	}
+	if(argc == 2)
+		stub_path = argv[1];
+
+	gGoggleMsgKey = 0x56800000 | (getpid() & 0xFFFF);
+	msgctl(msgget(gGoggleMsgKey, 0), IPC_RMID, NULL);	//left by a crashed run
+	if(rec_init()) {
+		fprintf(stderr, "no message queue\n");
+		return 1;
+	}
+
+	test_ack();
+	test_legacy();
+
+	stub_stop();
+	gogglemsg_uninit();
+	unlink(STATUS_FILE);
+	printf("%s\n", failed ? "FAILED" : "passed");
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,123 @@
+// Stand-in for the record process, to exercise core/recorder.c on a host.
+//
+//   cc -O2 -Isrc/player -o rec_stub src/tools/rec_stub.c src/player/gogglemsg.c -lpthread
+//   ./rec_stub [-l] [-d ms] [-f] [-k key]
+//
+// Serves MTYPE_RECORD on the goggle message queue like the recorder does,
+// keeping /tmp/record.dat up to date. REC_cmdSTATUS, REC_cmdSTARTP and
+// MSG_cmdSTOP are acknowledged on MTYPE_RECORD_ACK; with -l they are
+// ignored, as an older recorder does, and only MSG_cmdSTART/STOP work.
+// -d delays every start by that much, the encoder setup time; -f makes
+// every start fail, -k serves the queue with that key instead of the
+// goggle's (see rec_check). MSG_cmdQUIT exits and removes the queue.
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include "gogglemsg.h"
+
+#define STATUS_FILE		"/tmp/record.dat"
+
+static bool legacy = false, fail = false;
+static int  delay_ms = 0;
+static long state = REC_stIDLE;
+
+static void status_file(bool recording)
+{
+	FILE *fp = fopen(STATUS_FILE, "w");
+
+	if(fp) {
+		fputs(recording ? "1" : "0", fp);
+		fclose(fp);
+	}
+}
+
+static void ack(long cmd, long error)
+{
+	GoggleMsg_t msg;
+
+	if(legacy)
+		return;
+	msg.mtype = MTYPE_RECORD_ACK;
+	msg.cmd = cmd;
+	msg.u.rec_ack.state = state;
+	msg.u.rec_ack.error = error;
+	gogglemsg_sendMsg(&msg, sizeof(msg.u.rec_ack));
+}
+
+static void start(long cmd)
+{
+	usleep(delay_ms * 1000);
+	state = fail ? REC_stFAILED : REC_stRECORDING;
+	status_file(!fail);
+	if(cmd == REC_cmdSTARTP)
+		ack(cmd, fail ? 5 : 0);
+}
+
+int main(int argc, char **argv)
+{
+	GoggleMsg_t msg;
+	RecordMsgParam_t *p = &msg.u.rec_param;
+	int opt, cmd;
+
+	while((opt = getopt(argc, argv, "ld:fk:")) != -1) {
+		switch(opt) {
+			case 'l': legacy = true; break;
+			case 'd': delay_ms = atoi(optarg); break;
+			case 'f': fail = true; break;
+			case 'k': gGoggleMsgKey = strtol(optarg, NULL, 0); break;
+			default:
+				fprintf(stderr, "usage: %s [-l] [-d ms] [-f] [-k key]\n", argv[0]);
+				return 2;
+		}
+	}
+
+	if(gogglemsg_init(0))
+		return 1;
+	status_file(false);
+	printf("rec_stub: %s recorder\n", legacy ? "legacy" : "acking");
+
+	for(;;)
+	{
+		cmd = gogglemsg_wait(MTYPE_RECORD, &msg, -1);
+		if(cmd < 0)
+			return 1;
+
+		switch(cmd) {
+			case MSG_cmdQUIT:
+				printf("quit\n");
+				gogglemsg_uninit();
+				return 0;
+
+			case MSG_cmdSTART:
+				printf("start, record.conf\n");
+				start(cmd);
+				break;
+
+			case REC_cmdSTARTP:
+				if(legacy)
+					break;
+				printf("start, %s %ld/%ldfps %ldkbps h265:%ld audio:%ld\n", p->format_ts ? "ts" : "mp4",
+					   p->vi_fps, p->venc_fps, p->kbps, p->h265, p->audio);
+				start(cmd);
+				break;
+
+			case MSG_cmdSTOP:
+				printf("stop\n");
+				state = REC_stIDLE;
+				status_file(false);
+				ack(cmd, 0);
+				break;
+
+			case REC_cmdSTATUS:
+				ack(cmd, 0);
+				break;
+
+			default:
+				printf("cmd %d ignored\n", cmd);
+				break;
+		}
+		fflush(stdout);
+	}
+}